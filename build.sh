@@ -25,14 +25,15 @@
 #
 # For more information, please refer to <https://unlicense.org/>
 
-CFLAGS="-std=c17 -Wall -Wextra -Wpedantic -Wconversion -Wstrict-overflow=5 -Wno-missing-field-initializers"
+CFLAGS="-std=c17 -pthread -Wall -Wextra -Wpedantic -Wconversion -Wstrict-overflow=5 -Wno-missing-field-initializers"
 CFLAGS_Debug="-O0 -ggdb -fsanitize=address -fsanitize=undefined"
 CFLAGS_Release="-O2 -DNDEBUG"
+CFLAGS_Instrumented="-O2 -DNDEBUG -DSORT_INSTRUMENT"
 
 set -euo pipefail
 
 usage() {
-    echo "Usage: $0 (Debug|Release)"
+    echo "Usage: $0 (Debug|Release|Instrumented)"
     exit 1
 }
 
@@ -42,7 +43,7 @@ fi
 
 BUILD_TYPE="$1"
 shift
-if [ "$BUILD_TYPE" != Debug -a "$BUILD_TYPE" != Release ]; then
+if [ "$BUILD_TYPE" != Debug -a "$BUILD_TYPE" != Release -a "$BUILD_TYPE" != Instrumented ]; then
     usage
 fi
 
@@ -54,6 +55,10 @@ PLATFORM_CFLAGS=""
 if [ "$(uname)" = Linux -a -d /usr/include/bsd ]; then
     PLATFORM_CFLAGS="-DLIBBSD_OVERLAY -isystem /usr/include/bsd -lbsd"
 fi
+if [ "$(uname)" = Linux ]; then
+    # Interpose malloc and friends to count allocations (see src/instrument.c)
+    PLATFORM_CFLAGS="$PLATFORM_CFLAGS -DHAVE_MALLOC_WRAP -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free"
+fi
 
 BUILD_DIR="build/$BUILD_TYPE"
 CFLAGS_VARIANT_VAR="CFLAGS_${BUILD_TYPE}"
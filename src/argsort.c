@@ -0,0 +1,133 @@
+/*
+ * Written by Luke McCarthy <luke@iogopro.co.uk>, Oct-Nov 2025
+ * https://github.com/ljmccarthy/sorting_algorithms
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+ * this software, either in source code form or as a compiled binary, for any
+ * purpose, commercial or non-commercial, and by any means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors of
+ * this software dedicate any and all copyright interest in the software to the
+ * public domain. We make this dedication for the benefit of the public at
+ * large and to the detriment of our heirs and successors. We intend this
+ * dedication to be an overt act of relinquishment in perpetuity of all present
+ * and future rights to this software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org/>
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sort.h"
+#include "util.h"
+
+#define INDEX_TYPE uint16_t
+#define INDEX_SUFFIX u16
+#include "index_sort_impl.h"
+
+#define INDEX_TYPE uint32_t
+#define INDEX_SUFFIX u32
+#include "index_sort_impl.h"
+
+#define INDEX_TYPE uint64_t
+#define INDEX_SUFFIX u64
+#include "index_sort_impl.h"
+
+size_t sort_index_width(size_t nelems)
+{
+    if ((uint64_t) nelems <= UINT16_MAX) {
+        return sizeof(uint16_t);
+    } else if ((uint64_t) nelems <= UINT32_MAX) {
+        return sizeof(uint32_t);
+    }
+    return sizeof(uint64_t);
+}
+
+void *argsort(const void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, size_t *index_width)
+{
+    const size_t width = sort_index_width(nelems);
+    *index_width = width;
+    /* The second half is scratch space for the merge sort, given back once the sort is done */
+    void *perm = malloc((nelems ? nelems : 1) * 2 * width);
+    if (!perm) {
+        return NULL;
+    }
+    switch (width) {
+        case sizeof(uint16_t):
+            sort_indices_u16(base, nelems, size, compare, context, perm);
+            break;
+        case sizeof(uint32_t):
+            sort_indices_u32(base, nelems, size, compare, context, perm);
+            break;
+        default:
+            sort_indices_u64(base, nelems, size, compare, context, perm);
+            break;
+    }
+    void *shrunk = realloc(perm, (nelems ? nelems : 1) * width);
+    return shrunk ? shrunk : perm;
+}
+
+struct index_compare_context {
+    const char *base;
+    size_t size;
+    compare_fn_t compare;
+    void *context;
+};
+
+/* The sort may pass copies of indices kept in unaligned temporaries, so they are read with memcpy */
+#define INDEX_COMPARE_FUNCTION(type, suffix) \
+    static int compare_index_##suffix(const void *a_ptr, const void *b_ptr, void *context) \
+    { \
+        const struct index_compare_context *ctx = context; \
+        type a, b; \
+        memcpy(&a, a_ptr, sizeof(a)); \
+        memcpy(&b, b_ptr, sizeof(b)); \
+        return ctx->compare(ctx->base + ctx->size * (size_t) a, ctx->base + ctx->size * (size_t) b, ctx->context); \
+    }
+
+INDEX_COMPARE_FUNCTION(uint16_t, u16)
+INDEX_COMPARE_FUNCTION(uint32_t, u32)
+INDEX_COMPARE_FUNCTION(uint64_t, u64)
+
+#define FILL_INDICES(type, perm, nelems) \
+    for (size_t i = 0; i < (nelems); i++) { \
+        ((type *) (perm))[i] = (type) i; \
+    }
+
+void *argsort_unstable(const void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, size_t *index_width)
+{
+    const size_t width = sort_index_width(nelems);
+    *index_width = width;
+    void *perm = malloc((nelems ? nelems : 1) * width);
+    if (!perm) {
+        return NULL;
+    }
+    struct index_compare_context ctx = {base, size, compare, context};
+    switch (width) {
+        case sizeof(uint16_t):
+            FILL_INDICES(uint16_t, perm, nelems);
+            pdq_sort(perm, nelems, width, compare_index_u16, &ctx);
+            break;
+        case sizeof(uint32_t):
+            FILL_INDICES(uint32_t, perm, nelems);
+            pdq_sort(perm, nelems, width, compare_index_u32, &ctx);
+            break;
+        default:
+            FILL_INDICES(uint64_t, perm, nelems);
+            pdq_sort(perm, nelems, width, compare_index_u64, &ctx);
+            break;
+    }
+    return perm;
+}
@@ -0,0 +1,850 @@
+/*
+ * Written by Luke McCarthy <luke@iogopro.co.uk>, Oct-Nov 2025
+ * https://github.com/ljmccarthy/sorting_algorithms
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+ * this software, either in source code form or as a compiled binary, for any
+ * purpose, commercial or non-commercial, and by any means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors of
+ * this software dedicate any and all copyright interest in the software to the
+ * public domain. We make this dedication for the benefit of the public at
+ * large and to the detriment of our heirs and successors. We intend this
+ * dedication to be an overt act of relinquishment in perpetuity of all present
+ * and future rights to this software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org/>
+ */
+
+/*
+ * Stable in-place block merge sort, after Mike McFadden's WikiSort
+ * (https://github.com/BonzaiThePenguin/WikiSort), which implements "Ratio
+ * Based Stable In-Place Merging" by Pok-Son Kim and Arne Kutzner.
+ *
+ * It is a bottom-up merge sort. Levels whose runs fit in a small fixed cache
+ * are merged through the cache. Above that, each level pulls two internal
+ * buffers of about sqrt(A) unique values out of the array. The A run of each
+ * pair is split into blocks of about sqrt(A) elements whose first values are
+ * tagged by swapping them with the first buffer, so that the blocks can be
+ * rolled through the B run by block swaps and still be told apart. Each A
+ * block is dropped in front of the B values that go after it and merged with
+ * the B values before it, using the cache or the second buffer as scratch,
+ * or rotations if there weren't enough unique values for it. At the end of
+ * the level the buffers are sorted and merged back in by rotations.
+ *
+ * The only memory used is a fixed BLOCK_MERGE_CACHE_SIZE byte cache and a
+ * 1024 byte temporary element on the stack. Bigger elements take their
+ * temporary from the end of the cache, and elements bigger than the cache
+ * from malloc, leaving the array unsorted if that fails.
+ * block_merge_sort_buffer uses a caller-supplied buffer as the cache instead,
+ * which is faster: with room for sqrt(n) elements every A block fits in it,
+ * and with n/2 elements every level is an ordinary buffered merge.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sort.h"
+#include "util.h"
+
+#define BLOCK_MERGE_CACHE_SIZE 4096
+
+struct block_merge {
+    char *base;
+    size_t size;
+    compare_fn_t compare;
+    void *context;
+    char *cache;
+    size_t cache_nelems;
+    char *temp;
+};
+
+struct range {
+    size_t start;
+    size_t end;
+};
+
+static inline struct range make_range(size_t start, size_t end)
+{
+    struct range range = {start, end};
+    return range;
+}
+
+static inline size_t range_length(struct range range)
+{
+    return range.end - range.start;
+}
+
+static inline char *elem(const struct block_merge *m, size_t index)
+{
+    return m->base + index * m->size;
+}
+
+static inline bool less(const struct block_merge *m, const char *a, const char *b)
+{
+    return m->compare(a, b, m->context) < 0;
+}
+
+static inline void copy_elems(const struct block_merge *m, char *dst, const char *src, size_t nelems)
+{
+    if (nelems) {
+        copy(dst, src, nelems * m->size);
+    }
+}
+
+static inline void swap_elems(const struct block_merge *m, size_t a, size_t b)
+{
+    swap(elem(m, a), elem(m, b), m->temp, m->size);
+}
+
+static void block_swap(const struct block_merge *m, size_t start1, size_t start2, size_t block_size)
+{
+    for (size_t i = 0; i < block_size; i++) {
+        swap_elems(m, start1 + i, start2 + i);
+    }
+}
+
+/* Index of the first element in range not less than value */
+static size_t lower_bound(const struct block_merge *m, const char *value, struct range range)
+{
+    size_t lo = range.start;
+    size_t hi = range.end;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (less(m, elem(m, mid), value)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/* Index of the first element in range greater than value */
+static size_t upper_bound(const struct block_merge *m, const char *value, struct range range)
+{
+    size_t lo = range.start;
+    size_t hi = range.end;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (!less(m, value, elem(m, mid))) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static void insertion_sort_range(const struct block_merge *m, struct range range)
+{
+    for (size_t i = range.start + 1; i < range.end; i++) {
+        if (less(m, elem(m, i), elem(m, i - 1))) {
+            size_t j = i;
+            copy(m->temp, elem(m, i), m->size);
+            do {
+                copy(elem(m, j), elem(m, j - 1), m->size);
+                j--;
+            } while (j > range.start && less(m, m->temp, elem(m, j - 1)));
+            copy(elem(m, j), m->temp, m->size);
+        }
+    }
+}
+
+static void reverse(const struct block_merge *m, struct range range)
+{
+    for (size_t i = range.start, j = range.end; i + 1 < j; i++, j--) {
+        swap_elems(m, i, j - 1);
+    }
+}
+
+/* Rotates range left by amount, through the cache if the smaller side fits in cache_nelems */
+static void rotate(const struct block_merge *m, size_t amount, struct range range, size_t cache_nelems)
+{
+    if (range_length(range) == 0) {
+        return;
+    }
+    size_t size = m->size;
+    size_t split = range.start + amount;
+    struct range range1 = make_range(range.start, split);
+    struct range range2 = make_range(split, range.end);
+    if (range_length(range1) <= range_length(range2)) {
+        if (range_length(range1) <= cache_nelems) {
+            copy_elems(m, m->cache, elem(m, range1.start), range_length(range1));
+            memmove(elem(m, range1.start), elem(m, range2.start), range_length(range2) * size);
+            copy_elems(m, elem(m, range1.start + range_length(range2)), m->cache, range_length(range1));
+            return;
+        }
+    } else if (range_length(range2) <= cache_nelems) {
+        copy_elems(m, m->cache, elem(m, range2.start), range_length(range2));
+        memmove(elem(m, range2.end - range_length(range1)), elem(m, range1.start), range_length(range1) * size);
+        copy_elems(m, elem(m, range1.start), m->cache, range_length(range2));
+        return;
+    }
+    reverse(m, range1);
+    reverse(m, range2);
+    reverse(m, range);
+}
+
+/* Merges the non-empty runs a and b into a separate array */
+static void merge_into(const struct block_merge *m, const char *a, size_t a_nelems, const char *b, size_t b_nelems, char *into)
+{
+    size_t size = m->size;
+    const char *a_end = a + a_nelems * size;
+    const char *b_end = b + b_nelems * size;
+    while (1) {
+        if (!less(m, b, a)) {
+            copy(into, a, size);
+            a += size;
+            into += size;
+            if (a == a_end) {
+                copy_elems(m, into, b, (size_t) (b_end - b) / size);
+                break;
+            }
+        } else {
+            copy(into, b, size);
+            b += size;
+            into += size;
+            if (b == b_end) {
+                copy_elems(m, into, a, (size_t) (a_end - a) / size);
+                break;
+            }
+        }
+    }
+}
+
+/* Merges A, which has been copied into the cache, with B */
+static void merge_external(const struct block_merge *m, struct range a_range, struct range b_range)
+{
+    size_t size = m->size;
+    const char *a = m->cache;
+    const char *a_end = a + range_length(a_range) * size;
+    const char *b = elem(m, b_range.start);
+    const char *b_end = elem(m, b_range.end);
+    char *insert = elem(m, a_range.start);
+    if (range_length(a_range) > 0 && range_length(b_range) > 0) {
+        while (1) {
+            if (!less(m, b, a)) {
+                copy(insert, a, size);
+                a += size;
+                insert += size;
+                if (a == a_end) {
+                    break;
+                }
+            } else {
+                copy(insert, b, size);
+                b += size;
+                insert += size;
+                if (b == b_end) {
+                    break;
+                }
+            }
+        }
+    }
+    copy_elems(m, insert, a, (size_t) (a_end - a) / size);
+}
+
+/*
+ * Merges A, which has been block swapped into the internal buffer, with B.
+ * Every element is swapped into place, so the buffer keeps its contents but
+ * in a different order.
+ */
+static void merge_internal(const struct block_merge *m, struct range a, struct range b, struct range buffer)
+{
+    size_t a_count = 0;
+    size_t b_count = 0;
+    size_t insert = 0;
+    if (range_length(a) > 0 && range_length(b) > 0) {
+        while (1) {
+            if (!less(m, elem(m, b.start + b_count), elem(m, buffer.start + a_count))) {
+                swap_elems(m, a.start + insert, buffer.start + a_count);
+                a_count++;
+                insert++;
+                if (a_count >= range_length(a)) {
+                    break;
+                }
+            } else {
+                swap_elems(m, a.start + insert, b.start + b_count);
+                b_count++;
+                insert++;
+                if (b_count >= range_length(b)) {
+                    break;
+                }
+            }
+        }
+    }
+    block_swap(m, buffer.start + a_count, a.start + insert, range_length(a) - a_count);
+}
+
+/* Merges A and B without a buffer, by repeatedly finding where the first of A goes in B and rotating A there */
+static void merge_in_place(const struct block_merge *m, struct range a, struct range b)
+{
+    if (range_length(a) == 0 || range_length(b) == 0) {
+        return;
+    }
+    while (1) {
+        size_t mid = lower_bound(m, elem(m, a.start), b);
+        size_t amount = mid - a.end;
+        rotate(m, range_length(a), make_range(a.start, mid), m->cache_nelems);
+        if (b.end == mid) {
+            break;
+        }
+        b.start = mid;
+        a = make_range(a.start + amount, b.start);
+        a.start = upper_bound(m, elem(m, a.start), a);
+        if (range_length(a) == 0) {
+            break;
+        }
+    }
+}
+
+/* Merges A and B using the cache if A fits, otherwise the internal buffer if there is one, otherwise in place */
+static void merge_block(const struct block_merge *m, struct range a, struct range b, struct range buffer2)
+{
+    if (range_length(a) <= m->cache_nelems) {
+        merge_external(m, a, b);
+    } else if (range_length(buffer2) > 0) {
+        merge_internal(m, a, b, buffer2);
+    } else {
+        merge_in_place(m, a, b);
+    }
+}
+
+/*
+ * Splits the array into 2^k runs of equal length, give or take one, for each
+ * level of the merge sort. The run boundaries are computed with a fraction so
+ * that the runs at every level line up.
+ */
+struct run_iterator {
+    size_t size;
+    size_t numerator;
+    size_t decimal;
+    size_t denominator;
+    size_t decimal_step;
+    size_t numerator_step;
+};
+
+static void run_iterator_init(struct run_iterator *it, size_t nelems, size_t min_level)
+{
+    size_t power_of_two = 1;
+    while (power_of_two <= nelems / 2) {
+        power_of_two *= 2;
+    }
+    it->size = nelems;
+    it->denominator = power_of_two / min_level;
+    it->numerator_step = nelems % it->denominator;
+    it->decimal_step = nelems / it->denominator;
+    it->numerator = it->decimal = 0;
+}
+
+static void run_iterator_begin(struct run_iterator *it)
+{
+    it->numerator = it->decimal = 0;
+}
+
+static struct range run_iterator_next(struct run_iterator *it)
+{
+    size_t start = it->decimal;
+    it->decimal += it->decimal_step;
+    it->numerator += it->numerator_step;
+    if (it->numerator >= it->denominator) {
+        it->numerator -= it->denominator;
+        it->decimal++;
+    }
+    return make_range(start, it->decimal);
+}
+
+static bool run_iterator_finished(const struct run_iterator *it)
+{
+    return it->decimal >= it->size;
+}
+
+static bool run_iterator_next_level(struct run_iterator *it)
+{
+    it->decimal_step += it->decimal_step;
+    it->numerator_step += it->numerator_step;
+    if (it->numerator_step >= it->denominator) {
+        it->numerator_step -= it->denominator;
+        it->decimal_step++;
+    }
+    return it->decimal_step < it->size;
+}
+
+/* Length of the runs at this level, the shortest run may be one less */
+static size_t run_iterator_length(const struct run_iterator *it)
+{
+    return it->decimal_step;
+}
+
+/* Merges each pair of runs at this level when they fit in the cache */
+static void merge_level_cached(const struct block_merge *m, struct run_iterator *it)
+{
+    size_t size = m->size;
+    char *cache = m->cache;
+    run_iterator_begin(it);
+    while (!run_iterator_finished(it)) {
+        struct range a = run_iterator_next(it);
+        struct range b = run_iterator_next(it);
+        if (less(m, elem(m, b.end - 1), elem(m, a.start))) {
+            /* The runs are in reverse order, rotate them */
+            rotate(m, range_length(a), make_range(a.start, b.end), m->cache_nelems);
+        } else if (less(m, elem(m, b.start), elem(m, a.end - 1))) {
+            copy(cache, elem(m, a.start), range_length(a) * size);
+            merge_external(m, a, b);
+        }
+    }
+}
+
+/*
+ * Merges two levels at once when four runs fit in the cache: each pair of
+ * runs is merged into the cache and the two results are merged back.
+ */
+static void merge_two_levels_cached(const struct block_merge *m, struct run_iterator *it)
+{
+    size_t size = m->size;
+    char *cache = m->cache;
+    run_iterator_begin(it);
+    while (!run_iterator_finished(it)) {
+        struct range a1 = run_iterator_next(it);
+        struct range b1 = run_iterator_next(it);
+        struct range a2 = run_iterator_next(it);
+        struct range b2 = run_iterator_next(it);
+        if (less(m, elem(m, b1.end - 1), elem(m, a1.start))) {
+            copy(cache + range_length(b1) * size, elem(m, a1.start), range_length(a1) * size);
+            copy(cache, elem(m, b1.start), range_length(b1) * size);
+        } else if (less(m, elem(m, b1.start), elem(m, a1.end - 1))) {
+            merge_into(m, elem(m, a1.start), range_length(a1), elem(m, b1.start), range_length(b1), cache);
+        } else {
+            /* If all four runs are already in order there's nothing to do */
+            if (!less(m, elem(m, b2.start), elem(m, a2.end - 1)) && !less(m, elem(m, a2.start), elem(m, b1.end - 1))) {
+                continue;
+            }
+            copy(cache, elem(m, a1.start), range_length(a1) * size);
+            copy(cache + range_length(a1) * size, elem(m, b1.start), range_length(b1) * size);
+        }
+        a1 = make_range(a1.start, b1.end);
+
+        char *cache2 = cache + range_length(a1) * size;
+        if (less(m, elem(m, b2.end - 1), elem(m, a2.start))) {
+            copy(cache2 + range_length(b2) * size, elem(m, a2.start), range_length(a2) * size);
+            copy(cache2, elem(m, b2.start), range_length(b2) * size);
+        } else if (less(m, elem(m, b2.start), elem(m, a2.end - 1))) {
+            merge_into(m, elem(m, a2.start), range_length(a2), elem(m, b2.start), range_length(b2), cache2);
+        } else {
+            copy(cache2, elem(m, a2.start), range_length(a2) * size);
+            copy(cache2 + range_length(a2) * size, elem(m, b2.start), range_length(b2) * size);
+        }
+        a2 = make_range(a2.start, b2.end);
+
+        /* Merge the two halves in the cache back into the array */
+        size_t a3_nelems = range_length(a1);
+        size_t b3_nelems = range_length(a2);
+        if (less(m, cache2 + (b3_nelems - 1) * size, cache)) {
+            copy(elem(m, a1.start + b3_nelems), cache, a3_nelems * size);
+            copy(elem(m, a1.start), cache2, b3_nelems * size);
+        } else if (less(m, cache2, cache2 - size)) {
+            merge_into(m, cache, a3_nelems, cache2, b3_nelems, elem(m, a1.start));
+        } else {
+            copy(elem(m, a1.start), cache, a3_nelems * size);
+            copy(elem(m, a1.start + a3_nelems), cache2, b3_nelems * size);
+        }
+    }
+}
+
+/* Where the values of an internal buffer are pulled out from and to, so they can be put back afterwards */
+struct pull {
+    size_t from;
+    size_t to;
+    size_t count;
+    struct range range;
+};
+
+static void set_pull(struct pull *pull, struct range range, size_t count, size_t from, size_t to)
+{
+    pull->range = range;
+    pull->count = count;
+    pull->from = from;
+    pull->to = to;
+}
+
+/* Moves count unique values to the start (to < from) or end (to > from) of the pull range */
+static void pull_out(const struct block_merge *m, struct pull *pull)
+{
+    size_t length = pull->count;
+    if (pull->to < pull->from) {
+        size_t index = pull->from;
+        for (size_t count = 1; count < length; count++) {
+            index = lower_bound(m, elem(m, index - 1), make_range(pull->to, pull->from - (count - 1)));
+            struct range range = make_range(index + 1, pull->from + 1);
+            rotate(m, range_length(range) - count, range, m->cache_nelems);
+            pull->from = index + count;
+        }
+    } else if (pull->to > pull->from) {
+        size_t index = pull->from + 1;
+        for (size_t count = 1; count < length; count++) {
+            index = upper_bound(m, elem(m, index), make_range(index, pull->to));
+            struct range range = make_range(pull->from, index - 1);
+            rotate(m, count, range, m->cache_nelems);
+            pull->from = index - 1 - count;
+        }
+    }
+}
+
+/* Merges the sorted buffer of unique values back into the rest of the pull range */
+static void redistribute(const struct block_merge *m, const struct pull *pull)
+{
+    if (pull->from > pull->to) {
+        /* The values were pulled out to the left, merge them back to the right */
+        struct range buffer = make_range(pull->range.start, pull->range.start + pull->count);
+        while (range_length(buffer) > 0) {
+            size_t index = lower_bound(m, elem(m, buffer.start), make_range(buffer.end, pull->range.end));
+            size_t amount = index - buffer.end;
+            rotate(m, range_length(buffer), make_range(buffer.start, index), m->cache_nelems);
+            buffer.start += amount + 1;
+            buffer.end += amount;
+        }
+    } else if (pull->from < pull->to) {
+        /* The values were pulled out to the right, merge them back to the left */
+        struct range buffer = make_range(pull->range.end - pull->count, pull->range.end);
+        while (range_length(buffer) > 0) {
+            size_t index = upper_bound(m, elem(m, buffer.end - 1), make_range(pull->range.start, buffer.start));
+            size_t amount = buffer.start - index;
+            rotate(m, amount, make_range(index, buffer.end), m->cache_nelems);
+            buffer.start -= amount;
+            buffer.end -= amount + 1;
+        }
+    }
+}
+
+/* Merges A and B, tagging and rolling the A blocks through B as described above */
+static void merge_blocks(const struct block_merge *m, struct range a, struct range b, size_t block_size, struct range buffer1, struct range buffer2)
+{
+    size_t size = m->size;
+    size_t cache_nelems = m->cache_nelems;
+
+    /* Break A into blocks, the first of which is unevenly sized */
+    struct range block_a = a;
+    struct range first_a = make_range(a.start, a.start + range_length(block_a) % block_size);
+
+    /* Tag each A block by swapping its first value with a value in buffer1 */
+    for (size_t index_a = buffer1.start, index = first_a.end; index < block_a.end; index_a++, index += block_size) {
+        swap_elems(m, index_a, index);
+    }
+
+    /*
+     * Roll the A blocks through the B blocks. Whenever an A block is dropped
+     * behind, the previous A block is merged with the B values that follow it.
+     */
+    struct range last_a = first_a;
+    struct range last_b = make_range(0, 0);
+    struct range block_b = make_range(b.start, b.start + (block_size < range_length(b) ? block_size : range_length(b)));
+    block_a.start += range_length(first_a);
+    size_t index_a = buffer1.start;
+
+    /* Put the first A block where merge_block will look for it */
+    if (range_length(last_a) <= cache_nelems) {
+        copy_elems(m, m->cache, elem(m, last_a.start), range_length(last_a));
+    } else if (range_length(buffer2) > 0) {
+        block_swap(m, last_a.start, buffer2.start, range_length(last_a));
+    }
+
+    while (range_length(block_a) > 0) {
+        if ((range_length(last_b) > 0 && !less(m, elem(m, last_b.end - 1), elem(m, index_a))) || range_length(block_b) == 0) {
+            /*
+             * The smallest A block goes before the end of the previous B block,
+             * or there are no B blocks left: drop the smallest A block behind,
+             * splitting the previous B block where it goes.
+             */
+            size_t b_split = lower_bound(m, elem(m, index_a), last_b);
+            size_t b_remaining = last_b.end - b_split;
+
+            /* Swap the smallest A block, going by the tags, to the start of the rolling A blocks */
+            size_t min_a = block_a.start;
+            for (size_t find_a = min_a + block_size; find_a < block_a.end; find_a += block_size) {
+                if (less(m, elem(m, find_a), elem(m, min_a))) {
+                    min_a = find_a;
+                }
+            }
+            block_swap(m, block_a.start, min_a, block_size);
+
+            /* Swap the tag of the block back with its original first value */
+            swap_elems(m, block_a.start, index_a);
+            index_a++;
+
+            merge_block(m, last_a, make_range(last_a.end, b_split), buffer2);
+
+            if (range_length(buffer2) > 0 || block_size <= cache_nelems) {
+                /*
+                 * Move the A block to where it will be merged from, then block
+                 * swap the rest of the B block in front of it, which is like a
+                 * rotation since what's left behind doesn't need its order.
+                 */
+                if (block_size <= cache_nelems) {
+                    copy(m->cache, elem(m, block_a.start), block_size * size);
+                } else {
+                    block_swap(m, block_a.start, buffer2.start, block_size);
+                }
+                block_swap(m, b_split, block_a.start + block_size - b_remaining, b_remaining);
+            } else {
+                rotate(m, block_a.start - b_split, make_range(b_split, block_a.start + block_size), cache_nelems);
+            }
+
+            last_a = make_range(block_a.start - b_remaining, block_a.start - b_remaining + block_size);
+            last_b = make_range(last_a.end, last_a.end + b_remaining);
+            block_a.start += block_size;
+        } else if (range_length(block_b) < block_size) {
+            /*
+             * Move the last, unevenly sized B block in front of the remaining A
+             * blocks. The cache isn't used since it may hold the previous A block.
+             */
+            rotate(m, block_b.start - block_a.start, make_range(block_a.start, block_b.end), 0);
+            last_b = make_range(block_a.start, block_a.start + range_length(block_b));
+            block_a.start += range_length(block_b);
+            block_a.end += range_length(block_b);
+            block_b.end = block_b.start;
+        } else {
+            /* Roll the leftmost A block to the end by swapping it with the next B block */
+            block_swap(m, block_a.start, block_b.start, block_size);
+            last_b = make_range(block_a.start, block_a.start + block_size);
+            block_a.start += block_size;
+            block_a.end += block_size;
+            block_b.start += block_size;
+            if (block_b.end > b.end - block_size) {
+                block_b.end = b.end;
+            } else {
+                block_b.end += block_size;
+            }
+        }
+    }
+
+    /* Merge the last A block with the remaining B values */
+    merge_block(m, last_a, make_range(last_a.end, b.end), buffer2);
+}
+
+/* Merges each pair of runs at this level in place with internal buffers */
+static void merge_level_in_place(const struct block_merge *m, struct run_iterator *it)
+{
+    size_t length = run_iterator_length(it);
+    size_t block_size = isqrt(length);
+    size_t buffer_size = length / block_size + 1;
+    struct range buffer1 = make_range(0, 0);
+    struct range buffer2 = make_range(0, 0);
+    struct pull pull[2] = {{0}};
+    size_t pull_index = 0;
+
+    /*
+     * Find either one run with 2 sqrt(A) unique values for both buffers, or
+     * two runs with sqrt(A) each, or failing that the run with the most unique
+     * values. If every A block fits in the cache the second buffer isn't needed.
+     */
+    size_t find = buffer_size + buffer_size;
+    bool find_separately = false;
+    if (block_size <= m->cache_nelems) {
+        find = buffer_size;
+    } else if (find > length) {
+        find = buffer_size;
+        find_separately = true;
+    }
+
+    run_iterator_begin(it);
+    while (!run_iterator_finished(it)) {
+        struct range a = run_iterator_next(it);
+        struct range b = run_iterator_next(it);
+        size_t count, last, index;
+
+        /* Count unique values from the start of A, to be pulled out to the start of A */
+        for (last = a.start, count = 1; count < find; last = index, count++) {
+            index = upper_bound(m, elem(m, last), make_range(last + 1, a.end));
+            if (index == a.end) {
+                break;
+            }
+        }
+        index = last;
+
+        if (count >= buffer_size) {
+            set_pull(&pull[pull_index], make_range(a.start, b.end), count, index, a.start);
+            pull_index = 1;
+            if (count == buffer_size + buffer_size) {
+                buffer1 = make_range(a.start, a.start + buffer_size);
+                buffer2 = make_range(a.start + buffer_size, a.start + count);
+                break;
+            } else if (find == buffer_size + buffer_size) {
+                /* Enough for the first buffer but not both, still need to find the second */
+                buffer1 = make_range(a.start, a.start + count);
+                find = buffer_size;
+            } else if (block_size <= m->cache_nelems) {
+                buffer1 = make_range(a.start, a.start + count);
+                break;
+            } else if (find_separately) {
+                buffer1 = make_range(a.start, a.start + count);
+                find_separately = false;
+            } else {
+                buffer2 = make_range(a.start, a.start + count);
+                break;
+            }
+        } else if (pull_index == 0 && count > range_length(buffer1)) {
+            buffer1 = make_range(a.start, a.start + count);
+            set_pull(&pull[pull_index], make_range(a.start, b.end), count, index, a.start);
+        }
+
+        /* Count unique values from the end of B, to be pulled out to the end of B */
+        for (last = b.end - 1, count = 1; count < find; last = index - 1, count++) {
+            index = lower_bound(m, elem(m, last), make_range(b.start, last));
+            if (index == b.start) {
+                break;
+            }
+        }
+        index = last;
+
+        if (count >= buffer_size) {
+            set_pull(&pull[pull_index], make_range(a.start, b.end), count, index, b.end);
+            pull_index = 1;
+            if (count == buffer_size + buffer_size) {
+                buffer1 = make_range(b.end - count, b.end - buffer_size);
+                buffer2 = make_range(b.end - buffer_size, b.end);
+                break;
+            } else if (find == buffer_size + buffer_size) {
+                buffer1 = make_range(b.end - count, b.end);
+                find = buffer_size;
+            } else if (block_size <= m->cache_nelems) {
+                buffer1 = make_range(b.end - count, b.end);
+                break;
+            } else if (find_separately) {
+                buffer1 = make_range(b.end - count, b.end);
+                find_separately = false;
+            } else {
+                /* If the first buffer came from this A run, it must stop short of the second when put back */
+                if (pull[0].range.start == a.start) {
+                    pull[0].range.end -= pull[1].count;
+                }
+                buffer2 = make_range(b.end - count, b.end);
+                break;
+            }
+        } else if (pull_index == 0 && count > range_length(buffer1)) {
+            buffer1 = make_range(b.end - count, b.end);
+            set_pull(&pull[pull_index], make_range(a.start, b.end), count, index, b.end);
+        }
+    }
+
+    pull_out(m, &pull[0]);
+    pull_out(m, &pull[1]);
+
+    /* Adjust the block size to the number of tags in the first buffer */
+    buffer_size = range_length(buffer1);
+    block_size = length / buffer_size + 1;
+
+    run_iterator_begin(it);
+    while (!run_iterator_finished(it)) {
+        struct range a = run_iterator_next(it);
+        struct range b = run_iterator_next(it);
+
+        /* Leave out the parts of A or B that are being used by the internal buffers */
+        size_t start = a.start;
+        bool skip = false;
+        for (size_t i = 0; i < 2 && !skip; i++) {
+            if (start == pull[i].range.start) {
+                if (pull[i].from > pull[i].to) {
+                    a.start += pull[i].count;
+                    skip = range_length(a) == 0;
+                } else if (pull[i].from < pull[i].to) {
+                    b.end -= pull[i].count;
+                    skip = range_length(b) == 0;
+                }
+            }
+        }
+        if (skip) {
+            continue;
+        }
+
+        if (less(m, elem(m, b.end - 1), elem(m, a.start))) {
+            /* The runs are in reverse order, rotate them */
+            rotate(m, range_length(a), make_range(a.start, b.end), m->cache_nelems);
+        } else if (less(m, elem(m, a.end), elem(m, a.end - 1))) {
+            merge_blocks(m, a, b, block_size, buffer1, buffer2);
+        }
+    }
+
+    /* The second buffer was used as scratch space and is out of order, sort it and put both buffers back */
+    insertion_sort_range(m, buffer2);
+    redistribute(m, &pull[0]);
+    redistribute(m, &pull[1]);
+}
+
+static void block_merge_sort_common(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, char *cache, size_t cache_size)
+{
+    char temp_buf[1024];
+    if (nelems < 2) {
+        return;
+    }
+    /* Elements too big for temp_buf take their temporary from the end of the cache, or malloc if it won't fit */
+    char *temp = temp_buf;
+    bool temp_allocated = false;
+    if (size > sizeof(temp_buf)) {
+        if (size <= cache_size) {
+            cache_size -= size;
+            temp = cache + cache_size;
+        } else {
+            temp = malloc(size);
+            if (!temp) {
+                return;
+            }
+            temp_allocated = true;
+        }
+    }
+    struct block_merge m = {base, size, compare, context, cache, cache_size / size, temp};
+
+    /* Insertion sort runs of 4 to 8 elements */
+    struct run_iterator it;
+    if (nelems < 8) {
+        insertion_sort_range(&m, make_range(0, nelems));
+    } else {
+        run_iterator_init(&it, nelems, 4);
+        while (!run_iterator_finished(&it)) {
+            insertion_sort_range(&m, run_iterator_next(&it));
+        }
+        do {
+            size_t length = run_iterator_length(&it);
+            /* The runs can be one longer than the length */
+            if (length < m.cache_nelems) {
+                if ((length + 1) * 4 <= m.cache_nelems && length * 4 <= nelems) {
+                    merge_two_levels_cached(&m, &it);
+                    run_iterator_next_level(&it);
+                } else {
+                    merge_level_cached(&m, &it);
+                }
+            } else {
+                merge_level_in_place(&m, &it);
+            }
+        } while (run_iterator_next_level(&it));
+    }
+
+    if (temp_allocated) {
+        free(temp);
+    }
+}
+
+void block_merge_sort(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context)
+{
+    char cache[BLOCK_MERGE_CACHE_SIZE];
+    block_merge_sort_common(base, nelems, size, compare, context, cache, sizeof(cache));
+}
+
+void block_merge_sort_buffer(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, void *buffer, size_t buffer_size)
+{
+    char cache[BLOCK_MERGE_CACHE_SIZE];
+    if (buffer_size > sizeof(cache)) {
+        block_merge_sort_common(base, nelems, size, compare, context, buffer, buffer_size);
+    } else {
+        block_merge_sort_common(base, nelems, size, compare, context, cache, sizeof(cache));
+    }
+}
@@ -0,0 +1,614 @@
+/*
+ * Written by Luke McCarthy <luke@iogopro.co.uk>, Oct-Nov 2025
+ * https://github.com/ljmccarthy/sorting_algorithms
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+ * this software, either in source code form or as a compiled binary, for any
+ * purpose, commercial or non-commercial, and by any means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors of
+ * this software dedicate any and all copyright interest in the software to the
+ * public domain. We make this dedication for the benefit of the public at
+ * large and to the detriment of our heirs and successors. We intend this
+ * dedication to be an overt act of relinquishment in perpetuity of all present
+ * and future rights to this software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org/>
+ */
+
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "external_sort.h"
+#include "util.h"
+
+#if defined(_WIN32)
+
+int external_sort(FILE *input, FILE *output, size_t size, compare_fn_t compare, void *context,
+                  size_t memory_limit, const char *temp_dir)
+{
+    (void) input; (void) output; (void) size; (void) compare; (void) context;
+    (void) memory_limit; (void) temp_dir;
+    errno = ENOSYS;
+    return -1;
+}
+
+#else
+#include <pthread.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+/* Preferred size of each read and write while merging */
+#define EXTERNAL_SORT_BLOCK_SIZE (4 * 1024 * 1024)
+
+/* Smallest block worth merging from, smaller blocks mean more seeking so the fan-in is limited to keep blocks at least this big */
+#define EXTERNAL_SORT_MIN_BLOCK_SIZE (64 * 1024)
+
+#define EXTERNAL_SORT_MAX_FAN_IN 1024
+
+/*
+ * A read or write of a block, done by the I/O thread. Streams are accessed
+ * sequentially in the order the requests were submitted, temporary files are
+ * accessed at the given offset.
+ */
+struct io_request {
+    struct io_request *next;
+    FILE *stream;
+    int fd;
+    off_t offset;
+    char *buffer;
+    size_t length;
+    bool write;
+    bool done;
+    size_t transferred;
+    int error;
+};
+
+struct io_thread {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond; /* signalled when a request is submitted or completed */
+    struct io_request *head;
+    struct io_request *tail;
+    bool stop;
+};
+
+struct external_sort {
+    size_t size;
+    compare_fn_t compare;
+    void *context;
+    size_t memory_limit;
+    struct io_thread io;
+    int error;
+};
+
+static void do_io(struct io_request *req)
+{
+    size_t done = 0;
+    int error = 0;
+    if (req->stream) {
+        done = req->write ? fwrite(req->buffer, 1, req->length, req->stream)
+                          : fread(req->buffer, 1, req->length, req->stream);
+        if (done < req->length && ferror(req->stream)) {
+            error = EIO;
+        }
+    } else {
+        while (done < req->length) {
+            off_t offset = req->offset + (off_t) done;
+            ssize_t n = req->write ? pwrite(req->fd, req->buffer + done, req->length - done, offset)
+                                   : pread(req->fd, req->buffer + done, req->length - done, offset);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                error = errno;
+                break;
+            }
+            if (n == 0) {
+                break;
+            }
+            done += (size_t) n;
+        }
+    }
+    if (!error && done < req->length && req->write) {
+        error = EIO;
+    }
+    req->transferred = done;
+    req->error = error;
+}
+
+static void *io_thread_main(void *arg)
+{
+    struct io_thread *io = arg;
+    pthread_mutex_lock(&io->lock);
+    for (;;) {
+        while (!io->head && !io->stop) {
+            pthread_cond_wait(&io->cond, &io->lock);
+        }
+        struct io_request *req = io->head;
+        if (!req) {
+            break;
+        }
+        io->head = req->next;
+        if (!io->head) {
+            io->tail = NULL;
+        }
+        pthread_mutex_unlock(&io->lock);
+        do_io(req);
+        pthread_mutex_lock(&io->lock);
+        req->done = true;
+        pthread_cond_broadcast(&io->cond);
+    }
+    pthread_mutex_unlock(&io->lock);
+    return NULL;
+}
+
+static int io_thread_start(struct io_thread *io)
+{
+    io->head = NULL;
+    io->tail = NULL;
+    io->stop = false;
+    int error = pthread_mutex_init(&io->lock, NULL);
+    if (error) {
+        return error;
+    }
+    error = pthread_cond_init(&io->cond, NULL);
+    if (error) {
+        pthread_mutex_destroy(&io->lock);
+        return error;
+    }
+    error = pthread_create(&io->thread, NULL, io_thread_main, io);
+    if (error) {
+        pthread_cond_destroy(&io->cond);
+        pthread_mutex_destroy(&io->lock);
+    }
+    return error;
+}
+
+/* Finishes all submitted requests before stopping */
+static void io_thread_stop(struct io_thread *io)
+{
+    pthread_mutex_lock(&io->lock);
+    io->stop = true;
+    pthread_cond_broadcast(&io->cond);
+    pthread_mutex_unlock(&io->lock);
+    pthread_join(io->thread, NULL);
+    pthread_cond_destroy(&io->cond);
+    pthread_mutex_destroy(&io->lock);
+}
+
+static void io_submit(struct io_thread *io, struct io_request *req)
+{
+    req->next = NULL;
+    req->done = false;
+    pthread_mutex_lock(&io->lock);
+    if (io->tail) {
+        io->tail->next = req;
+    } else {
+        io->head = req;
+    }
+    io->tail = req;
+    pthread_cond_broadcast(&io->cond);
+    pthread_mutex_unlock(&io->lock);
+}
+
+static void io_wait(struct io_thread *io, struct io_request *req)
+{
+    pthread_mutex_lock(&io->lock);
+    while (!req->done) {
+        pthread_cond_wait(&io->cond, &io->lock);
+    }
+    pthread_mutex_unlock(&io->lock);
+}
+
+/* Checks a completed request transferred all its bytes, otherwise records the error */
+static bool io_check(struct external_sort *es, const struct io_request *req)
+{
+    if (req->error || req->transferred != req->length) {
+        if (!es->error) {
+            es->error = req->error ? req->error : EIO;
+        }
+        return false;
+    }
+    return true;
+}
+
+/* Opens a temporary file and unlinks it right away, so it goes away when closed */
+static int create_temp_file(const char *temp_dir)
+{
+    static const char name[] = "/external_sort.XXXXXX";
+    if (!temp_dir) {
+        temp_dir = getenv("TMPDIR");
+        if (!temp_dir || !*temp_dir) {
+            temp_dir = "/tmp";
+        }
+    }
+    size_t dir_len = strlen(temp_dir);
+    char *path = malloc(dir_len + sizeof(name));
+    if (!path) {
+        return -1;
+    }
+    memcpy(path, temp_dir, dir_len);
+    memcpy(path + dir_len, name, sizeof(name));
+    int fd = mkstemp(path);
+    if (fd >= 0) {
+        unlink(path);
+    }
+    free(path);
+    return fd;
+}
+
+/*
+ * Double-buffered input from one run. The block at buffers[current] is being
+ * consumed from pos to limit while the next block is read into the other.
+ */
+struct merge_input {
+    off_t next_offset;
+    off_t end_offset;
+    char *buffers[2];
+    struct io_request requests[2];
+    bool pending[2];
+    int current;
+    char *pos;
+    char *limit;
+};
+
+struct merge_output {
+    char *buffers[2];
+    struct io_request requests[2];
+    bool pending[2];
+    int current;
+    char *pos;
+    char *limit;
+};
+
+static void input_read_ahead(struct external_sort *es, struct merge_input *in, int fd, size_t block_size, int buffer)
+{
+    off_t remaining = in->end_offset - in->next_offset;
+    if (remaining == 0) {
+        in->pending[buffer] = false;
+        return;
+    }
+    struct io_request *req = &in->requests[buffer];
+    req->stream = NULL;
+    req->fd = fd;
+    req->offset = in->next_offset;
+    req->buffer = in->buffers[buffer];
+    req->length = remaining < (off_t) block_size ? (size_t) remaining : block_size;
+    req->write = false;
+    io_submit(&es->io, req);
+    in->next_offset += (off_t) req->length;
+    in->pending[buffer] = true;
+}
+
+/* Moves on to the next block of a run when the current one is used up, returns false at the end of the run or on error */
+static bool input_next_block(struct external_sort *es, struct merge_input *in, int fd, size_t block_size)
+{
+    int used = in->current;
+    int next = used ^ 1;
+    if (!in->pending[next]) {
+        return false;
+    }
+    io_wait(&es->io, &in->requests[next]);
+    in->pending[next] = false;
+    if (!io_check(es, &in->requests[next])) {
+        return false;
+    }
+    input_read_ahead(es, in, fd, block_size, used);
+    in->current = next;
+    in->pos = in->buffers[next];
+    in->limit = in->pos + in->requests[next].length;
+    return true;
+}
+
+/* Writes out the current output block and switches to the other buffer once its write has finished */
+static void output_flush(struct external_sort *es, struct merge_output *out, FILE *stream, int fd, off_t *offset)
+{
+    int full = out->current;
+    struct io_request *req = &out->requests[full];
+    req->stream = stream;
+    req->fd = fd;
+    req->offset = *offset;
+    req->buffer = out->buffers[full];
+    req->length = (size_t) (out->pos - out->buffers[full]);
+    req->write = true;
+    if (req->length > 0) {
+        io_submit(&es->io, req);
+        out->pending[full] = true;
+        *offset += (off_t) req->length;
+    }
+    int next = full ^ 1;
+    if (out->pending[next]) {
+        io_wait(&es->io, &out->requests[next]);
+        out->pending[next] = false;
+        io_check(es, &out->requests[next]);
+    }
+    out->current = next;
+    out->pos = out->buffers[next];
+}
+
+/* State of a merge passed to the merge_k_stream callbacks */
+struct merge {
+    struct external_sort *es;
+    struct merge_input *inputs;
+    struct merge_output out;
+    int src_fd;
+    size_t block_size;
+    FILE *stream;
+    int dst_fd;
+    off_t dst_offset;
+};
+
+/* The record returned stays in its block until the next pull from the same run, as merge_k_stream requires */
+static const void *merge_pull(size_t run, void *context)
+{
+    struct merge *merge = context;
+    struct merge_input *in = &merge->inputs[run];
+    if (unlikely(in->pos == in->limit) && !input_next_block(merge->es, in, merge->src_fd, merge->block_size)) {
+        return NULL;
+    }
+    const char *record = in->pos;
+    in->pos += merge->es->size;
+    return record;
+}
+
+static void merge_push(const void *record, void *context)
+{
+    struct merge *merge = context;
+    struct merge_output *out = &merge->out;
+    copy(out->pos, record, merge->es->size);
+    out->pos += merge->es->size;
+    if (unlikely(out->pos == out->limit)) {
+        output_flush(merge->es, out, merge->stream, merge->dst_fd, &merge->dst_offset);
+        out->limit = out->pos + merge->block_size;
+    }
+}
+
+/*
+ * Merges nruns consecutive runs of run_length bytes (the last one ending at
+ * end_offset) starting at offset in the temporary file src_fd. The result is
+ * written to the output stream, or to dst_fd at the same offset if stream is
+ * NULL. Two blocks are allocated for each run and two for the output, all
+ * within the memory limit along with the per-run state.
+ */
+static void merge_runs(struct external_sort *es, int src_fd, off_t offset, off_t run_length, size_t nruns, off_t end_offset,
+                       FILE *stream, int dst_fd)
+{
+    const size_t size = es->size;
+    /* merge_k_stream's loser tree takes a node and a pointer for each run */
+    size_t bookkeeping = nruns * (sizeof(struct merge_input) + sizeof(size_t) + sizeof(void *));
+    size_t block_size = es->memory_limit > bookkeeping ? (es->memory_limit - bookkeeping) / (2 * (nruns + 1)) : 0;
+    if (block_size > EXTERNAL_SORT_BLOCK_SIZE) {
+        block_size = EXTERNAL_SORT_BLOCK_SIZE;
+    }
+    block_size -= block_size % size;
+    if (block_size < size) {
+        block_size = size;
+    }
+
+    struct merge_input *inputs = malloc(nruns * sizeof(struct merge_input));
+    char *buffers = malloc(2 * (nruns + 1) * block_size);
+    if (!inputs || !buffers) {
+        free(inputs);
+        free(buffers);
+        es->error = ENOMEM;
+        return;
+    }
+
+    for (size_t i = 0; i < nruns; i++) {
+        struct merge_input *in = &inputs[i];
+        in->next_offset = offset + (off_t) i * run_length;
+        in->end_offset = end_offset - in->next_offset > run_length ? in->next_offset + run_length : end_offset;
+        in->buffers[0] = buffers + (2 * i + 0) * block_size;
+        in->buffers[1] = buffers + (2 * i + 1) * block_size;
+        in->pending[0] = false;
+        in->pending[1] = false;
+        /* Start with buffer 1 used up and the first block on its way into buffer 0 */
+        in->current = 1;
+        in->pos = NULL;
+        in->limit = NULL;
+        input_read_ahead(es, in, src_fd, block_size, 0);
+    }
+
+    struct merge merge;
+    merge.es = es;
+    merge.inputs = inputs;
+    merge.src_fd = src_fd;
+    merge.block_size = block_size;
+    merge.stream = stream;
+    merge.dst_fd = dst_fd;
+    merge.dst_offset = offset;
+    merge.out.buffers[0] = buffers + (2 * nruns + 0) * block_size;
+    merge.out.buffers[1] = buffers + (2 * nruns + 1) * block_size;
+    merge.out.pending[0] = false;
+    merge.out.pending[1] = false;
+    merge.out.current = 0;
+    merge.out.pos = merge.out.buffers[0];
+    merge.out.limit = merge.out.pos + block_size;
+
+    /* After an error the runs just end early, and the merge is thrown away */
+    merge_k_stream(nruns, merge_pull, &merge, merge_push, &merge, es->compare, es->context);
+    output_flush(es, &merge.out, stream, dst_fd, &merge.dst_offset);
+    output_flush(es, &merge.out, stream, dst_fd, &merge.dst_offset);
+
+    /* Wait for any read-ahead still in flight (after an error) before freeing the buffers */
+    for (size_t i = 0; i < nruns; i++) {
+        for (int b = 0; b < 2; b++) {
+            if (inputs[i].pending[b]) {
+                io_wait(&es->io, &inputs[i].requests[b]);
+            }
+        }
+    }
+    free(inputs);
+    free(buffers);
+}
+
+/* Reads up to chunk_size bytes from the input, returns the number of bytes read */
+static size_t read_chunk(struct external_sort *es, FILE *input, char *chunk, size_t chunk_size, bool *at_end)
+{
+    size_t length = fread(chunk, 1, chunk_size, input);
+    if (ferror(input)) {
+        es->error = EIO;
+        return 0;
+    }
+    if (length % es->size != 0) {
+        es->error = EINVAL; /* partial record at the end */
+        return 0;
+    }
+    /* Peek ahead so that input that fits in one chunk is written straight to the output */
+    int c = length < chunk_size ? EOF : getc(input);
+    if (c == EOF) {
+        *at_end = true;
+        if (ferror(input)) {
+            es->error = EIO;
+        }
+    } else {
+        ungetc(c, input);
+    }
+    return length;
+}
+
+/*
+ * Sorts the input in chunks of memory_limit * 2/3 bytes (timsort needs up to
+ * half a chunk of scratch memory) and writes them one after the other as runs
+ * to the temporary file, or straight to the output if it all fits in one
+ * chunk. Returns the number of runs written to the temporary file.
+ */
+static size_t make_runs(struct external_sort *es, FILE *input, FILE *output, int temp_fd, size_t chunk_size, off_t *end_offset)
+{
+    const size_t size = es->size;
+    char *chunk = malloc(chunk_size);
+    struct sort_workspace *ws = sort_workspace_create(chunk_size / 2);
+    size_t nruns = 0;
+    off_t offset = 0;
+    bool at_end = false;
+    if (!chunk || !ws) {
+        es->error = ENOMEM;
+    }
+    while (!es->error && !at_end) {
+        size_t length = read_chunk(es, input, chunk, chunk_size, &at_end);
+        if (es->error || length == 0) {
+            break;
+        }
+        if (timsort_r_ws(chunk, length / size, size, es->compare, es->context, ws) != 0) {
+            es->error = errno ? errno : EINVAL;
+            break;
+        }
+        struct io_request req;
+        req.buffer = chunk;
+        req.length = length;
+        req.write = true;
+        if (nruns == 0 && at_end) {
+            req.stream = output;
+            req.fd = -1;
+            req.offset = 0;
+        } else {
+            req.stream = NULL;
+            req.fd = temp_fd;
+            req.offset = offset;
+            nruns++;
+            offset += (off_t) length;
+        }
+        do_io(&req);
+        io_check(es, &req);
+    }
+    sort_workspace_destroy(ws);
+    free(chunk);
+    *end_offset = offset;
+    return nruns;
+}
+
+int external_sort(FILE *input, FILE *output, size_t size, compare_fn_t compare, void *context,
+                  size_t memory_limit, const char *temp_dir)
+{
+    /* Merging needs at least two records for each of two runs and the output */
+    if (size == 0 || memory_limit / 6 < size) {
+        errno = EINVAL;
+        return -1;
+    }
+    struct external_sort es;
+    es.size = size;
+    es.compare = compare;
+    es.context = context;
+    es.memory_limit = memory_limit;
+    es.error = 0;
+
+    int fds[2] = {-1, -1};
+    fds[0] = create_temp_file(temp_dir);
+    if (fds[0] < 0) {
+        return -1;
+    }
+    size_t chunk_size = memory_limit / 3 * 2;
+    chunk_size -= chunk_size % size;
+    off_t end_offset;
+    size_t nruns = make_runs(&es, input, output, fds[0], chunk_size, &end_offset);
+
+    if (!es.error && nruns > 0) {
+        size_t max_fan_in = memory_limit / (2 * EXTERNAL_SORT_MIN_BLOCK_SIZE);
+        max_fan_in = max_fan_in > 1 ? max_fan_in - 1 : 0;
+        if (max_fan_in < 2) {
+            max_fan_in = 2;
+        }
+        if (max_fan_in > EXTERNAL_SORT_MAX_FAN_IN) {
+            max_fan_in = EXTERNAL_SORT_MAX_FAN_IN;
+        }
+        es.error = io_thread_start(&es.io);
+        if (!es.error) {
+            /* Each pass merges groups of max_fan_in runs in place into the other temporary file */
+            int src = 0;
+            off_t run_length = (off_t) chunk_size;
+            while (nruns > max_fan_in && !es.error) {
+                if (fds[src ^ 1] < 0) {
+                    fds[src ^ 1] = create_temp_file(temp_dir);
+                    if (fds[src ^ 1] < 0) {
+                        es.error = errno;
+                        break;
+                    }
+                }
+                for (size_t start = 0; start < nruns && !es.error; start += max_fan_in) {
+                    size_t count = nruns - start < max_fan_in ? nruns - start : max_fan_in;
+                    merge_runs(&es, fds[src], (off_t) start * run_length, run_length, count, end_offset, NULL, fds[src ^ 1]);
+                }
+                nruns = (nruns + max_fan_in - 1) / max_fan_in;
+                run_length *= (off_t) max_fan_in;
+                src ^= 1;
+            }
+            if (!es.error) {
+                merge_runs(&es, fds[src], 0, run_length, nruns, end_offset, output, -1);
+            }
+            io_thread_stop(&es.io);
+        }
+    }
+    if (!es.error && fflush(output) != 0) {
+        es.error = errno;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        if (fds[i] >= 0) {
+            close(fds[i]);
+        }
+    }
+    if (es.error) {
+        errno = es.error;
+        return -1;
+    }
+    return 0;
+}
+
+#endif
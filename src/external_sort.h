@@ -0,0 +1,56 @@
+/*
+ * Written by Luke McCarthy <luke@iogopro.co.uk>, Oct-Nov 2025
+ * https://github.com/ljmccarthy/sorting_algorithms
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+ * this software, either in source code form or as a compiled binary, for any
+ * purpose, commercial or non-commercial, and by any means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors of
+ * this software dedicate any and all copyright interest in the software to the
+ * public domain. We make this dedication for the benefit of the public at
+ * large and to the detriment of our heirs and successors. We intend this
+ * dedication to be an overt act of relinquishment in perpetuity of all present
+ * and future rights to this software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org/>
+ */
+
+/*
+ * External merge sort for data sets larger than memory. Fixed-size records
+ * are read from the input stream until end of file, sorted with timsort in
+ * chunks as big as fit in memory_limit bytes along with timsort's scratch
+ * memory, and written as runs to a temporary file. The runs are then merged
+ * with merge_k_stream, in several passes if there are too many runs to merge
+ * at once in the memory limit, and the result is written to the output
+ * stream. The sort is stable.
+ *
+ * While merging, a background thread reads ahead into a second buffer for
+ * each run and writes out one output buffer while the next is being filled,
+ * so the disk I/O overlaps with the comparisons.
+ *
+ * Temporary files are created in temp_dir, or $TMPDIR or /tmp if it is NULL,
+ * and are removed as soon as they are created so nothing is left behind. They
+ * take up to twice the input size when more than one merge pass is needed.
+ *
+ * memory_limit must be at least 6 times the record size. The streams are read
+ * and written from their current position. Returns 0 on success or -1 with
+ * errno set on failure, in which case the output is incomplete. Only available on POSIX systems (fails with ENOSYS on Windows).
+ */
+
+#pragma once
+#include <stddef.h>
+#include <stdio.h>
+#include "sort.h"
+
+int external_sort(FILE *input, FILE *output, size_t size, compare_fn_t compare, void *context,
+                  size_t memory_limit, const char *temp_dir);
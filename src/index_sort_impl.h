@@ -0,0 +1,219 @@
+/*
+ * Written by Luke McCarthy <luke@iogopro.co.uk>, Oct-Nov 2025
+ * https://github.com/ljmccarthy/sorting_algorithms
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+ * this software, either in source code form or as a compiled binary, for any
+ * purpose, commercial or non-commercial, and by any means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors of
+ * this software dedicate any and all copyright interest in the software to the
+ * public domain. We make this dedication for the benefit of the public at
+ * large and to the detriment of our heirs and successors. We intend this
+ * dedication to be an overt act of relinquishment in perpetuity of all present
+ * and future rights to this software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org/>
+ */
+
+/*
+ * Merge sort of an array of element indices, for one width of index, and
+ * applying the resulting permutation to the elements. Define these and then
+ * include this file (it may be included more than once):
+ *
+ *     INDEX_TYPE    unsigned integer type of the indices
+ *     INDEX_SUFFIX  appended to the names defined here, e.g. u32
+ *
+ * This defines:
+ *
+ *     static inline void sort_indices_<INDEX_SUFFIX>(const void *base, size_t nelems, size_t size,
+ *         compare_fn_t compare, void *context, INDEX_TYPE *buffer);
+ *         Sorts the indices of the elements into the first nelems entries of
+ *         the buffer, which has room for 2 * nelems indices. The sort is stable.
+ *     static inline void apply_permutation_<INDEX_SUFFIX>(void *base, size_t nelems, size_t size,
+ *         INDEX_TYPE *index_array);
+ *         Moves the elements into the order given by the indices, in place.
+ *     static inline void gather_<INDEX_SUFFIX>(const void *base, size_t nelems, size_t size,
+ *         const INDEX_TYPE *index_array, void *out);
+ *         Copies the elements in the order given by the indices to out.
+ *
+ * The parameters are undefined at the end of this file.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "sort.h"
+#include "util.h"
+
+#ifndef INDEX_NAME
+#define INDEX_CONCAT(x, y) x ## _ ## y
+#define INDEX_MAKE_NAME(x, y) INDEX_CONCAT(x, y)
+#define INDEX_NAME(x) INDEX_MAKE_NAME(x, INDEX_SUFFIX)
+#define INDEX_ELEM_PTR(base, size, index) ((char *) (base) + (size) * (size_t) (index))
+
+/* Swaps two elements through a temporary buffer that may be smaller than them, a piece at a time */
+static inline void index_swap_through(void *a_ptr, void *b_ptr, size_t size, void *temp, size_t temp_size)
+{
+    char *a = a_ptr;
+    char *b = b_ptr;
+    while (size > 0) {
+        const size_t n = size < temp_size ? size : temp_size;
+        swap(a, b, temp, n);
+        a += n;
+        b += n;
+        size -= n;
+    }
+}
+#endif
+
+static void INDEX_NAME(sort_two)(const void *base, size_t size, INDEX_TYPE *index_array, compare_fn_t compare, void *context)
+{
+    const INDEX_TYPE a_index = index_array[0];
+    const INDEX_TYPE b_index = index_array[1];
+    const void *a_ptr = INDEX_ELEM_PTR(base, size, a_index);
+    const void *b_ptr = INDEX_ELEM_PTR(base, size, b_index);
+    const bool a_le_b = compare(a_ptr, b_ptr, context) <= 0;
+    index_array[0] = a_le_b ? a_index : b_index;
+    index_array[1] = a_le_b ? b_index : a_index;
+}
+
+static void INDEX_NAME(sort_three)(const void *base, size_t size, INDEX_TYPE *index_array, compare_fn_t compare, void *context)
+{
+    const INDEX_TYPE a_index = index_array[0];
+    const INDEX_TYPE b_index = index_array[1];
+    const INDEX_TYPE c_index = index_array[2];
+    const void *a_ptr = INDEX_ELEM_PTR(base, size, a_index);
+    const void *b_ptr = INDEX_ELEM_PTR(base, size, b_index);
+    const void *c_ptr = INDEX_ELEM_PTR(base, size, c_index);
+    const bool a_le_b = compare(a_ptr, b_ptr, context) <= 0;
+    const bool a_le_c = compare(a_ptr, c_ptr, context) <= 0;
+    const bool b_le_c = compare(b_ptr, c_ptr, context) <= 0;
+    const INDEX_TYPE min_a_c = a_le_c ? a_index : c_index;
+    const INDEX_TYPE max_a_c = a_le_c ? c_index : a_index;
+    const INDEX_TYPE min_b_c = b_le_c ? b_index : c_index;
+    const INDEX_TYPE max_b_c = b_le_c ? c_index : b_index;
+    index_array[0] = a_le_b ? min_a_c : min_b_c;
+    index_array[1] = a_le_b ? (b_le_c ? b_index : max_a_c) : (a_le_c ? a_index : max_b_c);
+    index_array[2] = a_le_b ? max_b_c : max_a_c;
+}
+
+static void INDEX_NAME(merge_sort_rec)(const void *base, size_t nelems, size_t size, INDEX_TYPE *index_array, INDEX_TYPE *merge_array, compare_fn_t compare, void *context)
+{
+    if (nelems <= 2) {
+        if (nelems == 2) {
+            INDEX_NAME(sort_two)(base, size, index_array, compare, context);
+        }
+        return;
+    } else if (nelems == 3) {
+        INDEX_NAME(sort_three)(base, size, index_array, compare, context);
+        return;
+    }
+    size_t lhs_nelems = nelems / 2;
+    size_t rhs_nelems = nelems - lhs_nelems;
+    INDEX_NAME(merge_sort_rec)(base, lhs_nelems, size, merge_array, index_array, compare, context);
+    INDEX_NAME(merge_sort_rec)(base, rhs_nelems, size, merge_array + lhs_nelems, index_array + lhs_nelems, compare, context);
+    INDEX_TYPE *lhs = merge_array;
+    INDEX_TYPE *rhs = merge_array + lhs_nelems;
+    INDEX_TYPE *lhs_end = lhs + lhs_nelems;
+    INDEX_TYPE *rhs_end = rhs + rhs_nelems;
+    INDEX_TYPE *dst = index_array;
+    while (1) {
+        const INDEX_TYPE lhs_index = *lhs;
+        const INDEX_TYPE rhs_index = *rhs;
+        const void *lhs_ptr = INDEX_ELEM_PTR(base, size, lhs_index);
+        const void *rhs_ptr = INDEX_ELEM_PTR(base, size, rhs_index);
+        const bool lhs_le_rhs = compare(lhs_ptr, rhs_ptr, context) <= 0;
+        *dst++ = lhs_le_rhs ? lhs_index : rhs_index;
+        lhs += lhs_le_rhs;
+        rhs += !lhs_le_rhs;
+        if (unlikely(lhs == lhs_end)) {
+            copy(dst, rhs, (size_t) ((char *) rhs_end - (char *) rhs));
+            break;
+        }
+        if (unlikely(rhs == rhs_end)) {
+            copy(dst, lhs, (size_t) ((char *) lhs_end - (char *) lhs));
+            break;
+        }
+    }
+}
+
+static inline void INDEX_NAME(sort_indices)(const void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, INDEX_TYPE *buffer)
+{
+    INDEX_TYPE *index_array = buffer;
+    INDEX_TYPE *merge_array = index_array + nelems;
+    for (size_t i = 0; i < nelems; i++) {
+        index_array[i] = (INDEX_TYPE) i;
+    }
+    for (size_t i = 0; i < nelems; i++) {
+        merge_array[i] = (INDEX_TYPE) i;
+    }
+    INDEX_NAME(merge_sort_rec)(base, nelems, size, index_array, merge_array, compare, context);
+}
+
+/*
+ * Follows each cycle of the permutation with one element held in temp. Each
+ * position is marked as done by setting its index to itself, so nothing else
+ * is needed to track which elements have been moved. If there is no memory
+ * for an element larger than temp_buf, each cycle is followed by swapping its
+ * first element along it through temp_buf instead.
+ */
+static inline void INDEX_NAME(apply_permutation)(void *base, size_t nelems, size_t size, INDEX_TYPE *index_array)
+{
+    char temp_buf[1024];
+    char *temp = size > sizeof(temp_buf) ? malloc(size) : temp_buf;
+    if (unlikely(!temp)) {
+        for (size_t i = 0; i < nelems; i++) {
+            size_t j = i;
+            while (index_array[j] != i) {
+                const size_t src = index_array[j];
+                index_swap_through(INDEX_ELEM_PTR(base, size, j), INDEX_ELEM_PTR(base, size, src), size, temp_buf, sizeof(temp_buf));
+                index_array[j] = (INDEX_TYPE) j;
+                j = src;
+            }
+            index_array[j] = (INDEX_TYPE) j;
+        }
+        return;
+    }
+    for (size_t i = 0; i < nelems; i++) {
+        if (index_array[i] == i) {
+            continue;
+        }
+        copy(temp, INDEX_ELEM_PTR(base, size, i), size);
+        size_t j = i;
+        while (1) {
+            const size_t src = index_array[j];
+            index_array[j] = (INDEX_TYPE) j;
+            if (src == i) {
+                copy(INDEX_ELEM_PTR(base, size, j), temp, size);
+                break;
+            }
+            copy(INDEX_ELEM_PTR(base, size, j), INDEX_ELEM_PTR(base, size, src), size);
+            j = src;
+        }
+    }
+    if (temp != temp_buf) {
+        free(temp);
+    }
+}
+
+static inline void INDEX_NAME(gather)(const void *base, size_t nelems, size_t size, const INDEX_TYPE *index_array, void *out)
+{
+    char *dst_ptr = out;
+    for (size_t i = 0; i < nelems; i++) {
+        copy(dst_ptr, INDEX_ELEM_PTR(base, size, index_array[i]), size);
+        dst_ptr += size;
+    }
+}
+
+#undef INDEX_TYPE
+#undef INDEX_SUFFIX
@@ -0,0 +1,109 @@
+/*
+ * Written by Luke McCarthy <luke@iogopro.co.uk>, Oct-Nov 2025
+ * https://github.com/ljmccarthy/sorting_algorithms
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+ * this software, either in source code form or as a compiled binary, for any
+ * purpose, commercial or non-commercial, and by any means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors of
+ * this software dedicate any and all copyright interest in the software to the
+ * public domain. We make this dedication for the benefit of the public at
+ * large and to the detriment of our heirs and successors. We intend this
+ * dedication to be an overt act of relinquishment in perpetuity of all present
+ * and future rights to this software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org/>
+ */
+
+#if defined(HAVE_MALLOC_WRAP)
+#define _GNU_SOURCE /* malloc_usable_size */
+#endif
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "instrument.h"
+
+struct instrument_counters instrument_counters;
+
+void instrument_reset_peak(void)
+{
+    uint_least64_t allocated = atomic_load_explicit(&instrument_counters.allocated_bytes, memory_order_relaxed);
+    atomic_store_explicit(&instrument_counters.peak_allocated_bytes, allocated, memory_order_relaxed);
+}
+
+#if defined(HAVE_MALLOC_WRAP)
+#include <malloc.h>
+
+/* Linked with -Wl,--wrap=malloc etc. so calls to malloc from this program come here and __real_malloc is the C library's */
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nelems, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+void *__wrap_malloc(size_t size);
+void *__wrap_calloc(size_t nelems, size_t size);
+void *__wrap_realloc(void *ptr, size_t size);
+void __wrap_free(void *ptr);
+
+static void count_alloc(void *ptr)
+{
+    if (ptr) {
+        uint_least64_t size = malloc_usable_size(ptr);
+        uint_least64_t allocated = atomic_fetch_add_explicit(&instrument_counters.allocated_bytes, size, memory_order_relaxed) + size;
+        uint_least64_t peak = atomic_load_explicit(&instrument_counters.peak_allocated_bytes, memory_order_relaxed);
+        while (allocated > peak && !atomic_compare_exchange_weak_explicit(&instrument_counters.peak_allocated_bytes, &peak, allocated, memory_order_relaxed, memory_order_relaxed)) {
+        }
+        atomic_fetch_add_explicit(&instrument_counters.allocations, 1, memory_order_relaxed);
+    }
+}
+
+static void count_free(void *ptr)
+{
+    if (ptr) {
+        atomic_fetch_sub_explicit(&instrument_counters.allocated_bytes, malloc_usable_size(ptr), memory_order_relaxed);
+    }
+}
+
+void *__wrap_malloc(size_t size)
+{
+    void *ptr = __real_malloc(size);
+    count_alloc(ptr);
+    return ptr;
+}
+
+void *__wrap_calloc(size_t nelems, size_t size)
+{
+    void *ptr = __real_calloc(nelems, size);
+    count_alloc(ptr);
+    return ptr;
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    count_free(ptr);
+    void *new_ptr = __real_realloc(ptr, size);
+    if (new_ptr) {
+        count_alloc(new_ptr);
+    } else if (ptr && size) {
+        count_alloc(ptr); /* failed, the old block is still allocated */
+    }
+    return new_ptr;
+}
+
+void __wrap_free(void *ptr)
+{
+    count_free(ptr);
+    __real_free(ptr);
+}
+#endif
@@ -0,0 +1,61 @@
+/*
+ * Written by Luke McCarthy <luke@iogopro.co.uk>, Oct-Nov 2025
+ * https://github.com/ljmccarthy/sorting_algorithms
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+ * this software, either in source code form or as a compiled binary, for any
+ * purpose, commercial or non-commercial, and by any means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors of
+ * this software dedicate any and all copyright interest in the software to the
+ * public domain. We make this dedication for the benefit of the public at
+ * large and to the detriment of our heirs and successors. We intend this
+ * dedication to be an overt act of relinquishment in perpetuity of all present
+ * and future rights to this software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org/>
+ */
+
+/*
+ * Operation counters for test_sort. These are global and updated atomically,
+ * so they also work for the multi-threaded sorts.
+ *
+ * - Element copies made with copy() and swap() in util.h are only counted
+ *   when compiled with SORT_INSTRUMENT defined, as counting slows them down.
+ * - Allocations are counted when malloc, calloc, realloc and free are
+ *   interposed with the linker (HAVE_MALLOC_WRAP, see build.sh). Only calls
+ *   from this program are seen, not allocations made inside the C library.
+ */
+
+#pragma once
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct instrument_counters {
+    atomic_uint_least64_t copies;
+    atomic_uint_least64_t bytes_copied;
+    atomic_uint_least64_t allocations;
+    atomic_uint_least64_t allocated_bytes; /* currently allocated */
+    atomic_uint_least64_t peak_allocated_bytes;
+};
+
+extern struct instrument_counters instrument_counters;
+
+static inline void instrument_count_copy(size_t size)
+{
+    atomic_fetch_add_explicit(&instrument_counters.copies, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&instrument_counters.bytes_copied, size, memory_order_relaxed);
+}
+
+/* Resets the peak allocated bytes to the current allocated bytes */
+void instrument_reset_peak(void);
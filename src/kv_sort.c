@@ -0,0 +1,237 @@
+/*
+ * Written by Luke McCarthy <luke@iogopro.co.uk>, Oct-Nov 2025
+ * https://github.com/ljmccarthy/sorting_algorithms
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+ * this software, either in source code form or as a compiled binary, for any
+ * purpose, commercial or non-commercial, and by any means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors of
+ * this software dedicate any and all copyright interest in the software to the
+ * public domain. We make this dedication for the benefit of the public at
+ * large and to the detriment of our heirs and successors. We intend this
+ * dedication to be an overt act of relinquishment in perpetuity of all present
+ * and future rights to this software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org/>
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sort.h"
+#include "util.h"
+
+#define INDEX_TYPE uint16_t
+#define INDEX_SUFFIX u16
+#include "index_sort_impl.h"
+
+#define INDEX_TYPE uint32_t
+#define INDEX_SUFFIX u32
+#include "index_sort_impl.h"
+
+#define INDEX_TYPE uint64_t
+#define INDEX_SUFFIX u64
+#include "index_sort_impl.h"
+
+/*
+ * Key/value sorts on a struct-of-arrays layout, where the keys are in one
+ * array and the values (the rest of each record) in another, with value i
+ * belonging to key i. Only the keys are compared, so the comparisons read
+ * densely packed keys instead of striding through whole records, and the
+ * values are moved as little as the two strategies allow:
+ *
+ * kv_sort_lockstep is a merge sort that moves each value along with its key
+ * on every merge pass. Each pass streams sequentially through the key and
+ * value arrays, which is cheap when the values are small.
+ *
+ * kv_sort_gather sorts the keys along with the indices of their values (as
+ * narrow as sort_index_width allows) and then moves the values into sorted
+ * order in place at the end, following the cycles of the permutation, so each
+ * value is moved once however many merge passes there are. This is cheaper
+ * for wide values.
+ *
+ * kv_sort uses lockstep for values up to twice the width of an index and
+ * gather for wider ones. All of them are stable.
+ */
+
+#define KV_INSERTION_SORT_CUTOFF 8
+
+/* kv_sort moves the values in lockstep when they are no wider than this many indices */
+#define KV_LOCKSTEP_MAX_INDICES 2
+
+struct kv_params {
+    size_t key_size;
+    size_t value_size;
+    compare_fn_t compare;
+    void *context;
+};
+
+/* Insertion sort of a small array, moving the values with the keys */
+static void kv_insertion_sort(const struct kv_params *params, char *keys, char *values, size_t nelems, char *key_temp, char *value_temp)
+{
+    const size_t key_size = params->key_size;
+    const size_t value_size = params->value_size;
+    for (size_t i = 1; i < nelems; i++) {
+        size_t j = i;
+        while (j > 0 && params->compare(keys + (j - 1) * key_size, keys + i * key_size, params->context) > 0) {
+            j--;
+        }
+        if (j == i) {
+            continue;
+        }
+        copy(key_temp, keys + i * key_size, key_size);
+        memmove(keys + (j + 1) * key_size, keys + j * key_size, (i - j) * key_size);
+        copy(keys + j * key_size, key_temp, key_size);
+        copy(value_temp, values + i * value_size, value_size);
+        memmove(values + (j + 1) * value_size, values + j * value_size, (i - j) * value_size);
+        copy(values + j * value_size, value_temp, value_size);
+    }
+}
+
+/* Merges two non-empty sorted runs of keys and their values */
+static void kv_merge(const struct kv_params *params,
+                     const char *lhs_keys, const char *lhs_values, size_t lhs_nelems,
+                     const char *rhs_keys, const char *rhs_values, size_t rhs_nelems,
+                     char *keys, char *values)
+{
+    const size_t key_size = params->key_size;
+    const size_t value_size = params->value_size;
+    const char *lhs_keys_end = lhs_keys + lhs_nelems * key_size;
+    const char *rhs_keys_end = rhs_keys + rhs_nelems * key_size;
+    while (1) {
+        const bool lhs_le_rhs = params->compare(lhs_keys, rhs_keys, params->context) <= 0;
+        copy(keys, lhs_le_rhs ? lhs_keys : rhs_keys, key_size);
+        copy(values, lhs_le_rhs ? lhs_values : rhs_values, value_size);
+        keys += key_size;
+        values += value_size;
+        lhs_keys += lhs_le_rhs ? key_size : 0;
+        lhs_values += lhs_le_rhs ? value_size : 0;
+        rhs_keys += lhs_le_rhs ? 0 : key_size;
+        rhs_values += lhs_le_rhs ? 0 : value_size;
+        if (unlikely(lhs_keys == lhs_keys_end)) {
+            size_t nelems = (size_t) (rhs_keys_end - rhs_keys) / key_size;
+            copy(keys, rhs_keys, nelems * key_size);
+            copy(values, rhs_values, nelems * value_size);
+            break;
+        }
+        if (unlikely(rhs_keys == rhs_keys_end)) {
+            size_t nelems = (size_t) (lhs_keys_end - lhs_keys) / key_size;
+            copy(keys, lhs_keys, nelems * key_size);
+            copy(values, lhs_values, nelems * value_size);
+            break;
+        }
+    }
+}
+
+/* Sorts keys and values, using merge_keys and merge_values, which hold a copy of them, as scratch */
+static void kv_merge_sort_rec(const struct kv_params *params, char *keys, char *values, char *merge_keys, char *merge_values,
+                              size_t nelems, char *key_temp, char *value_temp)
+{
+    if (nelems <= KV_INSERTION_SORT_CUTOFF) {
+        kv_insertion_sort(params, keys, values, nelems, key_temp, value_temp);
+        return;
+    }
+    const size_t key_size = params->key_size;
+    const size_t value_size = params->value_size;
+    size_t lhs_nelems = nelems / 2;
+    size_t rhs_nelems = nelems - lhs_nelems;
+    kv_merge_sort_rec(params, merge_keys, merge_values, keys, values, lhs_nelems, key_temp, value_temp);
+    kv_merge_sort_rec(params, merge_keys + lhs_nelems * key_size, merge_values + lhs_nelems * value_size,
+                      keys + lhs_nelems * key_size, values + lhs_nelems * value_size, rhs_nelems, key_temp, value_temp);
+    kv_merge(params, merge_keys, merge_values, lhs_nelems,
+             merge_keys + lhs_nelems * key_size, merge_values + lhs_nelems * value_size, rhs_nelems, keys, values);
+}
+
+static void kv_merge_sort(const struct kv_params *params, char *keys, char *values, size_t nelems)
+{
+    const size_t key_size = params->key_size;
+    const size_t value_size = params->value_size;
+    /* Scratch copies of the keys and values, then one temporary key and value for the insertion sort */
+    char *merge_keys = malloc(nelems * (key_size + value_size) + key_size + value_size);
+    char *merge_values = merge_keys + nelems * key_size;
+    char *key_temp = merge_values + nelems * value_size;
+    char *value_temp = key_temp + key_size;
+    copy(merge_keys, keys, nelems * key_size);
+    copy(merge_values, values, nelems * value_size);
+    kv_merge_sort_rec(params, keys, values, merge_keys, merge_values, nelems, key_temp, value_temp);
+    free(merge_keys);
+}
+
+void kv_sort_lockstep(void *keys, size_t nelems, size_t key_size, compare_fn_t compare, void *context, void *values, size_t value_size)
+{
+    if (nelems < 2) {
+        return;
+    }
+    if (value_size == 0) {
+        merge_sort(keys, nelems, key_size, compare, context);
+        return;
+    }
+    struct kv_params params = {key_size, value_size, compare, context};
+    kv_merge_sort(&params, keys, values, nelems);
+}
+
+void kv_sort_gather(void *keys, size_t nelems, size_t key_size, compare_fn_t compare, void *context, void *values, size_t value_size)
+{
+    if (nelems < 2) {
+        return;
+    }
+    if (value_size == 0) {
+        merge_sort(keys, nelems, key_size, compare, context);
+        return;
+    }
+    const size_t index_width = sort_index_width(nelems);
+    void *indices = malloc(nelems * index_width);
+    switch (index_width) {
+        case sizeof(uint16_t):
+            for (size_t i = 0; i < nelems; i++) {
+                ((uint16_t *) indices)[i] = (uint16_t) i;
+            }
+            break;
+        case sizeof(uint32_t):
+            for (size_t i = 0; i < nelems; i++) {
+                ((uint32_t *) indices)[i] = (uint32_t) i;
+            }
+            break;
+        default:
+            for (size_t i = 0; i < nelems; i++) {
+                ((uint64_t *) indices)[i] = (uint64_t) i;
+            }
+            break;
+    }
+    struct kv_params params = {key_size, index_width, compare, context};
+    kv_merge_sort(&params, keys, indices, nelems);
+
+    switch (index_width) {
+        case sizeof(uint16_t):
+            apply_permutation_u16(values, nelems, value_size, indices);
+            break;
+        case sizeof(uint32_t):
+            apply_permutation_u32(values, nelems, value_size, indices);
+            break;
+        default:
+            apply_permutation_u64(values, nelems, value_size, indices);
+            break;
+    }
+    free(indices);
+}
+
+void kv_sort(void *keys, size_t nelems, size_t key_size, compare_fn_t compare, void *context, void *values, size_t value_size)
+{
+    if (value_size <= KV_LOCKSTEP_MAX_INDICES * sort_index_width(nelems)) {
+        kv_sort_lockstep(keys, nelems, key_size, compare, context, values, value_size);
+    } else {
+        kv_sort_gather(keys, nelems, key_size, compare, context, values, value_size);
+    }
+}
@@ -0,0 +1,156 @@
+/*
+ * Written by Luke McCarthy <luke@iogopro.co.uk>, Oct-Nov 2025
+ * https://github.com/ljmccarthy/sorting_algorithms
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+ * this software, either in source code form or as a compiled binary, for any
+ * purpose, commercial or non-commercial, and by any means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors of
+ * this software dedicate any and all copyright interest in the software to the
+ * public domain. We make this dedication for the benefit of the public at
+ * large and to the detriment of our heirs and successors. We intend this
+ * dedication to be an overt act of relinquishment in perpetuity of all present
+ * and future rights to this software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org/>
+ */
+
+/*
+ * Merges a batch of new elements into an array that is already sorted. The
+ * batch is sorted with merge_sort and then merged into the array from the
+ * tail backwards, into the spare capacity after the sorted elements, so that
+ * each element of the array moves at most once and no copy of it is needed.
+ *
+ * Like timsort's merges, the merge counts how many times in a row each side
+ * has supplied the next element, and after MIN_GALLOP times it switches to
+ * galloping: an exponential then binary search back from the tail of each
+ * side for the elements that go after the tail of the other, which are then
+ * moved as a block. It stays in galloping mode while the blocks found are
+ * long. A batch that lands in a few places in a large array is merged with
+ * O(log n) comparisons per place and one memmove of the elements after it.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include "sort.h"
+#include "util.h"
+
+#define MIN_GALLOP 7
+
+struct merge_params {
+    size_t size;
+    compare_fn_t compare;
+    void *context;
+};
+
+/*
+ * Returns the number of elements at the end of the sorted array that are
+ * greater than key, or greater than or equal to it if or_equal.
+ */
+static size_t gallop_tail(const struct merge_params *p, const char *key, const char *base, size_t nelems, bool or_equal)
+{
+    size_t size = p->size;
+    size_t found = 0;   /* the last found elements are known to go after key */
+    size_t limit = nelems + 1; /* and the last limit don't all */
+    size_t ofs = 1;
+    while (ofs <= nelems) {
+        int order = p->compare(base + (nelems - ofs) * size, key, p->context);
+        if (order < 0 || (order == 0 && !or_equal)) {
+            limit = ofs;
+            break;
+        }
+        found = ofs;
+        ofs = ofs * 2 + 1;
+    }
+    while (found + 1 < limit) {
+        size_t mid = found + (limit - found) / 2;
+        int order = p->compare(base + (nelems - mid) * size, key, p->context);
+        if (order < 0 || (order == 0 && !or_equal)) {
+            limit = mid;
+        } else {
+            found = mid;
+        }
+    }
+    return found;
+}
+
+static void merge_backwards(const struct merge_params *p, char *base, size_t nelems, const char *batch, size_t batch_nelems)
+{
+    size_t size = p->size;
+    size_t i = nelems;       /* elements of base not yet merged */
+    size_t j = batch_nelems; /* elements of the batch not yet merged */
+    size_t base_wins = 0;
+    size_t batch_wins = 0;
+    bool galloping = false;
+    /* The merged output ends at base + (i + j) * size */
+    while (i > 0 && j > 0) {
+        if (galloping) {
+            /* Elements of base after the last of the batch, with the batch after equal elements of base */
+            size_t n = gallop_tail(p, batch + (j - 1) * size, base, i, false);
+            if (n) {
+                memmove(base + (i + j - n) * size, base + (i - n) * size, n * size);
+                i -= n;
+            }
+            if (i == 0) {
+                break;
+            }
+            /* Elements of the batch not before the last of base */
+            size_t m = gallop_tail(p, base + (i - 1) * size, batch, j, true);
+            copy(base + (i + j - m) * size, batch + (j - m) * size, m * size);
+            j -= m;
+            galloping = n >= MIN_GALLOP || m >= MIN_GALLOP;
+        } else if (p->compare(batch + (j - 1) * size, base + (i - 1) * size, p->context) < 0) {
+            copy(base + (i + j - 1) * size, base + (i - 1) * size, size);
+            i--;
+            batch_wins = 0;
+            galloping = ++base_wins >= MIN_GALLOP;
+        } else {
+            copy(base + (i + j - 1) * size, batch + (j - 1) * size, size);
+            j--;
+            base_wins = 0;
+            galloping = ++batch_wins >= MIN_GALLOP;
+        }
+        if (galloping) {
+            base_wins = batch_wins = 0;
+        }
+    }
+    /* Whatever is left of base is already in place */
+    if (j > 0) {
+        copy(base, batch, j * size);
+    }
+}
+
+static void merge_batch_common(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, void *batch, size_t batch_nelems, struct sort_workspace *ws)
+{
+    if (batch_nelems == 0) {
+        return;
+    }
+    if (ws) {
+        merge_sort_ws(batch, batch_nelems, size, compare, context, ws);
+    } else {
+        merge_sort(batch, batch_nelems, size, compare, context);
+    }
+    struct merge_params params = {size, compare, context};
+    merge_backwards(&params, base, nelems, batch, batch_nelems);
+}
+
+void merge_batch(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, void *batch, size_t batch_nelems)
+{
+    merge_batch_common(base, nelems, size, compare, context, batch, batch_nelems, NULL);
+}
+
+void merge_batch_ws(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, void *batch, size_t batch_nelems, struct sort_workspace *ws)
+{
+    merge_batch_common(base, nelems, size, compare, context, batch, batch_nelems, ws);
+}
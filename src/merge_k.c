@@ -0,0 +1,198 @@
+/*
+ * Written by Luke McCarthy <luke@iogopro.co.uk>, Oct-Nov 2025
+ * https://github.com/ljmccarthy/sorting_algorithms
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+ * this software, either in source code form or as a compiled binary, for any
+ * purpose, commercial or non-commercial, and by any means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors of
+ * this software dedicate any and all copyright interest in the software to the
+ * public domain. We make this dedication for the benefit of the public at
+ * large and to the detriment of our heirs and successors. We intend this
+ * dedication to be an overt act of relinquishment in perpetuity of all present
+ * and future rights to this software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org/>
+ */
+
+/*
+ * k-way merge of sorted runs with a tournament tree of losers. Each internal
+ * node of the tree holds the run that lost the match played there, and the
+ * overall winner is kept at the root, so after the winner's run moves on to
+ * its next element only the matches on the path from its leaf to the root
+ * are replayed, which is about log2(k) comparisons per element output.
+ * Finished runs lose every match and ties go to the lower numbered run, so
+ * the merge is stable.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "sort.h"
+#include "util.h"
+
+/* Runs up to this many are merged without allocating */
+#define MERGE_K_STACK_RUNS 64
+
+struct loser_tree {
+    size_t k;
+    size_t *nodes;      /* nodes[0] is the winner, nodes[1..k-1] the losers, leaf i is node k + i */
+    const char **heads; /* next element of each run, NULL once the run is finished */
+    compare_fn_t compare;
+    void *context;
+};
+
+/* Whether the head of run a goes before the head of run b */
+static inline bool beats(const struct loser_tree *tree, size_t a, size_t b)
+{
+    const char *x = tree->heads[a];
+    const char *y = tree->heads[b];
+    if (!x || !y) {
+        return !y && (x || a < b);
+    }
+    int result = tree->compare(x, y, tree->context);
+    return result < 0 || (result == 0 && a < b);
+}
+
+/*
+ * Plays each leaf up the tree. A node that hasn't been played yet keeps the
+ * first player to arrive, the second plays it and the winner carries on, so
+ * each node is played once both its subtrees are complete.
+ */
+static void loser_tree_init(struct loser_tree *tree)
+{
+    const size_t k = tree->k;
+    for (size_t node = 1; node < k; node++) {
+        tree->nodes[node] = SIZE_MAX;
+    }
+    tree->nodes[0] = 0;
+    for (size_t i = 0; i < k; i++) {
+        size_t winner = i;
+        size_t node = (k + i) / 2;
+        for (; node > 0; node /= 2) {
+            size_t player = tree->nodes[node];
+            if (player == SIZE_MAX) {
+                tree->nodes[node] = winner;
+                break;
+            }
+            if (beats(tree, player, winner)) {
+                tree->nodes[node] = winner;
+                winner = player;
+            }
+        }
+        if (node == 0) {
+            tree->nodes[0] = winner;
+        }
+    }
+}
+
+/* Replays the matches of run i after its head has changed, returns the new winner */
+static inline size_t loser_tree_replay(struct loser_tree *tree, size_t i)
+{
+    size_t winner = i;
+    for (size_t node = (tree->k + i) / 2; node > 0; node /= 2) {
+        size_t loser = tree->nodes[node];
+        if (beats(tree, loser, winner)) {
+            tree->nodes[node] = winner;
+            winner = loser;
+        }
+    }
+    tree->nodes[0] = winner;
+    return winner;
+}
+
+void merge_k(const void *const runs[], const size_t lens[], size_t k, size_t size, compare_fn_t compare, void *context, void *out)
+{
+    size_t stack_nodes[MERGE_K_STACK_RUNS];
+    const char *stack_heads[MERGE_K_STACK_RUNS];
+    const char *stack_ends[MERGE_K_STACK_RUNS];
+    size_t *nodes = stack_nodes;
+    const char **heads = stack_heads;
+    const char **ends = stack_ends;
+    void *buffer = NULL;
+    if (k > MERGE_K_STACK_RUNS) {
+        buffer = malloc(k * (sizeof(size_t) + 2 * sizeof(const char *)));
+        nodes = buffer;
+        heads = (const char **) (nodes + k);
+        ends = heads + k;
+    }
+
+    size_t active = 0;
+    for (size_t i = 0; i < k; i++) {
+        heads[i] = lens[i] ? runs[i] : NULL;
+        ends[i] = (const char *) runs[i] + lens[i] * size;
+        active += lens[i] != 0;
+    }
+    struct loser_tree tree = {k, nodes, heads, compare, context};
+    if (active > 1) {
+        loser_tree_init(&tree);
+    }
+
+    char *dst = out;
+    while (active > 1) {
+        size_t winner = nodes[0];
+        copy(dst, heads[winner], size);
+        dst += size;
+        heads[winner] += size;
+        if (unlikely(heads[winner] == ends[winner])) {
+            heads[winner] = NULL;
+            active--;
+        }
+        loser_tree_replay(&tree, winner);
+    }
+    /* The last run left is copied straight out */
+    for (size_t i = 0; i < k && active; i++) {
+        if (heads[i]) {
+            copy(dst, heads[i], (size_t) (ends[i] - heads[i]));
+            break;
+        }
+    }
+
+    if (buffer) {
+        free(buffer);
+    }
+}
+
+void merge_k_stream(size_t k, merge_pull_fn_t pull, void *pull_context, merge_push_fn_t push, void *push_context,
+                    compare_fn_t compare, void *context)
+{
+    size_t stack_nodes[MERGE_K_STACK_RUNS];
+    const char *stack_heads[MERGE_K_STACK_RUNS];
+    size_t *nodes = stack_nodes;
+    const char **heads = stack_heads;
+    void *buffer = NULL;
+    if (k > MERGE_K_STACK_RUNS) {
+        buffer = malloc(k * (sizeof(size_t) + sizeof(const char *)));
+        nodes = buffer;
+        heads = (const char **) (nodes + k);
+    }
+
+    for (size_t i = 0; i < k; i++) {
+        heads[i] = pull(i, pull_context);
+    }
+    struct loser_tree tree = {k, nodes, heads, compare, context};
+    if (k > 0) {
+        loser_tree_init(&tree);
+        size_t winner = nodes[0];
+        while (heads[winner]) {
+            push(heads[winner], push_context);
+            heads[winner] = pull(winner, pull_context);
+            winner = loser_tree_replay(&tree, winner);
+        }
+    }
+
+    if (buffer) {
+        free(buffer);
+    }
+}
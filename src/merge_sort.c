@@ -30,80 +30,33 @@
 #include <stdlib.h>
 #include "sort.h"
 #include "util.h"
+#include "merge_sort_rec_impl.h"
 
-static void sort_two(char *array, char *merge_array, size_t size, compare_fn_t compare, void *context)
+static void merge_sort_with_buffer(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, char *merge_array)
 {
-    void *a = merge_array + 0 * size;
-    void *b = merge_array + 1 * size;
-    copy(a, array + 0 * size, size);
-    copy(b, array + 1 * size, size);
-    bool a_le_b = compare(a, b, context) <= 0;
-    copy(array + 0 * size, a_le_b ? a : b, size);
-    copy(array + 1 * size, a_le_b ? b : a, size);
+    copy(merge_array, base, nelems * size);
+    merge_sort_rec(base, merge_array, nelems, size, compare, context);
 }
 
-static void sort_three(char *array, char *merge_array, size_t size, compare_fn_t compare, void *context)
+void merge_sort(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context)
 {
-    void *a = merge_array + 0 * size;
-    void *b = merge_array + 1 * size;
-    void *c = merge_array + 2 * size;
-    copy(a, array + 0 * size, size);
-    copy(b, array + 1 * size, size);
-    copy(c, array + 2 * size, size);
-    bool a_le_b = compare(a, b, context) <= 0;
-    bool a_le_c = compare(a, c, context) <= 0;
-    bool b_le_c = compare(b, c, context) <= 0;
-    void *min_a_c = a_le_c ? a : c;
-    void *max_a_c = a_le_c ? c : a;
-    void *min_b_c = b_le_c ? b : c;
-    void *max_b_c = b_le_c ? c : b;
-    copy(array + 0 * size, a_le_b ? min_a_c : min_b_c, size);
-    copy(array + 1 * size, a_le_b ? (b_le_c ? b : max_a_c) : (a_le_c ? a : max_b_c), size);
-    copy(array + 2 * size, a_le_b ? max_b_c : max_a_c, size);
+    if (nelems < 2) {
+        return;
+    }
+    char *merge_array = malloc(nelems * size);
+    merge_sort_with_buffer(base, nelems, size, compare, context, merge_array);
+    free(merge_array);
 }
 
-static void merge_sort_rec(char *array, char *merge_array, size_t nelems, size_t size, compare_fn_t compare, void *context)
+void merge_sort_ws(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, struct sort_workspace *ws)
 {
-    if (nelems <= 2) {
-        if (nelems == 2) {
-            sort_two(array, merge_array, size, compare, context);
-        }
-        return;
-    } else if (nelems == 3) {
-        sort_three(array, merge_array, size, compare, context);
+    if (nelems < 2) {
         return;
     }
-    size_t lhs_nelems = nelems / 2;
-    size_t rhs_nelems = nelems - lhs_nelems;
-    merge_sort_rec(merge_array, array, lhs_nelems, size, compare, context);
-    merge_sort_rec(merge_array + lhs_nelems * size, array + lhs_nelems * size, rhs_nelems, size, compare, context);
-    char *lhs = merge_array;
-    char *rhs = merge_array + lhs_nelems * size;
-    char *lhs_end = rhs;
-    char *rhs_end = rhs + rhs_nelems * size;
-    char *dst = array;
-    while (1) {
-        bool lhs_le_rhs = compare(lhs, rhs, context) <= 0;
-        copy(dst, lhs_le_rhs ? lhs : rhs, size);
-        dst += size;
-        lhs += lhs_le_rhs ? size : 0;
-        rhs += lhs_le_rhs ? 0 : size;
-        if (unlikely(lhs == lhs_end)) {
-            copy(dst, rhs, (size_t) (rhs_end - rhs));
-            break;
-        }
-        if (unlikely(rhs == rhs_end)) {
-            copy(dst, lhs, (size_t) (lhs_end - lhs));
-            break;
-        }
+    char *merge_array = sort_workspace_reserve(ws, nelems * size);
+    if (!merge_array) {
+        merge_sort(base, nelems, size, compare, context);
+        return;
     }
-}
-
-void merge_sort(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context)
-{
-    size_t array_size = nelems * size;
-    char *merge_array = malloc(array_size);
-    copy(merge_array, base, array_size);
-    merge_sort_rec(base, merge_array, nelems, size, compare, context);
-    free(merge_array);
+    merge_sort_with_buffer(base, nelems, size, compare, context, merge_array);
 }
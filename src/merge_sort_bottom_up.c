@@ -0,0 +1,172 @@
+/*
+ * Written by Luke McCarthy <luke@iogopro.co.uk>, Oct-Nov 2025
+ * https://github.com/ljmccarthy/sorting_algorithms
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+ * this software, either in source code form or as a compiled binary, for any
+ * purpose, commercial or non-commercial, and by any means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors of
+ * this software dedicate any and all copyright interest in the software to the
+ * public domain. We make this dedication for the benefit of the public at
+ * large and to the detriment of our heirs and successors. We intend this
+ * dedication to be an overt act of relinquishment in perpetuity of all present
+ * and future rights to this software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org/>
+ */
+
+/*
+ * Bottom-up merge sort. Instead of recursing over the whole array, the merge
+ * passes are grouped by cache level: each L1-sized tile is sorted completely
+ * (insertion sorted runs, then merges up to the tile size), then each L2-sized
+ * tile is merged, and only the remaining passes stream over the whole array.
+ *
+ * Passes ping-pong between the array and a scratch array of the same size.
+ * The number of passes is known up front, so the runs are insertion sorted
+ * into whichever array makes the last pass finish in the original array. This
+ * avoids copying the array into the scratch array before starting.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "sort.h"
+#include "util.h"
+
+/* Length of the initial runs sorted by insertion sort */
+#define MERGE_SORT_RUN_NELEMS 4
+
+/* Cache sizes in bytes, each tile and its scratch space should fit */
+#define MERGE_SORT_L1_CACHE_SIZE (32 * 1024)
+#define MERGE_SORT_L2_CACHE_SIZE (256 * 1024)
+
+struct sort_params {
+    size_t size;
+    compare_fn_t compare;
+    void *context;
+};
+
+/* Insertion sort nelems elements from src into dst, which may be the same array */
+static void insertion_sort_run(char *dst, const char *src, size_t nelems, const struct sort_params *params, char *temp)
+{
+    size_t size = params->size;
+    for (size_t i = 0; i < nelems; i++) {
+        copy(temp, src + i * size, size);
+        char *cur = dst + i * size;
+        for (; cur != dst && params->compare(cur - size, temp, params->context) > 0; cur -= size) {
+            copy(cur, cur - size, size);
+        }
+        copy(cur, temp, size);
+    }
+}
+
+static void merge(char *dst, const char *lhs, const char *lhs_end, const char *rhs, const char *rhs_end, const struct sort_params *params)
+{
+    size_t size = params->size;
+    while (1) {
+        bool lhs_le_rhs = params->compare(lhs, rhs, params->context) <= 0;
+        copy(dst, lhs_le_rhs ? lhs : rhs, size);
+        dst += size;
+        lhs += lhs_le_rhs ? size : 0;
+        rhs += lhs_le_rhs ? 0 : size;
+        if (unlikely(lhs == lhs_end)) {
+            copy(dst, rhs, (size_t) (rhs_end - rhs));
+            break;
+        }
+        if (unlikely(rhs == rhs_end)) {
+            copy(dst, lhs, (size_t) (lhs_end - lhs));
+            break;
+        }
+    }
+}
+
+/* Merge adjacent pairs of sorted runs of run_nelems elements from src into dst */
+static void merge_pass(char *dst, const char *src, size_t nelems, size_t run_nelems, const struct sort_params *params)
+{
+    size_t size = params->size;
+    for (size_t start = 0; start < nelems; start += 2 * run_nelems) {
+        size_t mid = nelems - start > run_nelems ? start + run_nelems : nelems;
+        size_t end = nelems - start > 2 * run_nelems ? start + 2 * run_nelems : nelems;
+        if (mid == end) {
+            /* Lone run at the end, it still has to move to the other array */
+            copy(dst + start * size, src + start * size, (end - start) * size);
+        } else {
+            merge(dst + start * size, src + start * size, src + mid * size, src + mid * size, src + end * size, params);
+        }
+    }
+}
+
+/* Largest tile (a power of two multiple of the run length) whose data and scratch space fit in cache_size */
+static size_t tile_nelems(size_t cache_size, size_t size)
+{
+    size_t nelems = MERGE_SORT_RUN_NELEMS;
+    while (nelems * 2 * 2 * size <= cache_size) {
+        nelems *= 2;
+    }
+    return nelems;
+}
+
+void merge_sort_bottom_up(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context)
+{
+    char temp_buf[1024];
+    struct sort_params params = {size, compare, context};
+    char *temp = size > sizeof(temp_buf) ? malloc(size) : temp_buf;
+    size_t npasses = 0;
+    for (size_t run_nelems = MERGE_SORT_RUN_NELEMS; run_nelems < nelems; run_nelems *= 2) {
+        npasses++;
+    }
+    char *arrays[2] = {base, NULL};
+    if (npasses > 0) {
+        arrays[1] = malloc(nelems * size);
+    }
+    /* Pass p reads from arrays[(npasses - p) & 1] and the last pass writes to base */
+    size_t l1_tile = tile_nelems(MERGE_SORT_L1_CACHE_SIZE, size);
+    size_t l2_tile = tile_nelems(MERGE_SORT_L2_CACHE_SIZE, size);
+    size_t pass = 0;
+    size_t run_nelems = MERGE_SORT_RUN_NELEMS;
+    for (size_t tile_start = 0; tile_start < nelems; tile_start += l1_tile) {
+        size_t tile_end = nelems - tile_start > l1_tile ? tile_start + l1_tile : nelems;
+        char *dst = arrays[npasses & 1] + tile_start * size;
+        const char *src = (char *) base + tile_start * size;
+        for (size_t start = 0; start < tile_end - tile_start; start += MERGE_SORT_RUN_NELEMS) {
+            size_t end = tile_end - tile_start - start > MERGE_SORT_RUN_NELEMS ? start + MERGE_SORT_RUN_NELEMS : tile_end - tile_start;
+            insertion_sort_run(dst + start * size, src + start * size, end - start, &params, temp);
+        }
+        for (size_t p = 0, run = MERGE_SORT_RUN_NELEMS; p < npasses && run < l1_tile; p++, run *= 2) {
+            char *pass_src = arrays[(npasses - p) & 1] + tile_start * size;
+            char *pass_dst = arrays[(npasses - p - 1) & 1] + tile_start * size;
+            merge_pass(pass_dst, pass_src, tile_end - tile_start, run, &params);
+        }
+    }
+    for (; pass < npasses && run_nelems < l1_tile; pass++) {
+        run_nelems *= 2;
+    }
+    for (size_t tile_start = 0; pass < npasses && run_nelems < l2_tile && tile_start < nelems; tile_start += l2_tile) {
+        size_t tile_end = nelems - tile_start > l2_tile ? tile_start + l2_tile : nelems;
+        for (size_t p = pass, run = run_nelems; p < npasses && run < l2_tile; p++, run *= 2) {
+            char *pass_src = arrays[(npasses - p) & 1] + tile_start * size;
+            char *pass_dst = arrays[(npasses - p - 1) & 1] + tile_start * size;
+            merge_pass(pass_dst, pass_src, tile_end - tile_start, run, &params);
+        }
+    }
+    for (; pass < npasses && run_nelems < l2_tile; pass++) {
+        run_nelems *= 2;
+    }
+    for (; pass < npasses; pass++, run_nelems *= 2) {
+        merge_pass(arrays[(npasses - pass - 1) & 1], arrays[(npasses - pass) & 1], nelems, run_nelems, &params);
+    }
+    free(arrays[1]);
+    if (temp != temp_buf) {
+        free(temp);
+    }
+}
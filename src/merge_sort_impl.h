@@ -0,0 +1,137 @@
+/*
+ * Written by Luke McCarthy <luke@iogopro.co.uk>
+ * https://github.com/ljmccarthy/sorting_algorithms
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+ * this software, either in source code form or as a compiled binary, for any
+ * purpose, commercial or non-commercial, and by any means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors of
+ * this software dedicate any and all copyright interest in the software to the
+ * public domain. We make this dedication for the benefit of the public at
+ * large and to the detriment of our heirs and successors. We intend this
+ * dedication to be an overt act of relinquishment in perpetuity of all present
+ * and future rights to this software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org/>
+ */
+
+/*
+ * Merge sort specialized for a fixed element type, with the comparison
+ * inlined instead of called through a compare_fn_t. Define these and then
+ * include this file (it may be included more than once):
+ *
+ *     SORT_TYPE        the element type
+ *     SORT_SUFFIX      appended to the function name, e.g. u32 for merge_sort_u32
+ *     SORT_LESS(a, b)  expression that is true if element a sorts before element b
+ *     SORT_LINKAGE     optional, storage class of the sort function (default: static)
+ *     SORT_NETWORK(array, nelems)
+ *                      optional, sorts small arrays of up to SORT_NETWORK_MAX elements
+ *                      in place as the base case, returning false if it can't
+ *
+ * This defines:
+ *
+ *     SORT_LINKAGE void merge_sort_<SORT_SUFFIX>(SORT_TYPE *base, size_t nelems);
+ *
+ * The parameters are undefined at the end of this file.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "util.h"
+
+#ifndef SORT_NAME
+#define SORT_CONCAT(x, y) x ## _ ## y
+#define SORT_MAKE_NAME(x, y) SORT_CONCAT(x, y)
+#define SORT_NAME(x) SORT_MAKE_NAME(x, SORT_SUFFIX)
+#endif
+
+#ifndef SORT_LINKAGE
+#define SORT_LINKAGE static
+#endif
+
+static void SORT_NAME(merge_sort_rec)(SORT_TYPE *array, SORT_TYPE *merge_array, size_t nelems)
+{
+#ifdef SORT_NETWORK
+    if (nelems <= SORT_NETWORK_MAX && nelems > 3 && SORT_NETWORK(array, nelems)) {
+        return;
+    }
+#endif
+    if (nelems <= 2) {
+        if (nelems == 2) {
+            SORT_TYPE a = array[0];
+            SORT_TYPE b = array[1];
+            bool b_lt_a = SORT_LESS(b, a);
+            array[0] = b_lt_a ? b : a;
+            array[1] = b_lt_a ? a : b;
+        }
+        return;
+    } else if (nelems == 3) {
+        SORT_TYPE a = array[0];
+        SORT_TYPE b = array[1];
+        SORT_TYPE c = array[2];
+        bool a_le_b = !SORT_LESS(b, a);
+        bool a_le_c = !SORT_LESS(c, a);
+        bool b_le_c = !SORT_LESS(c, b);
+        SORT_TYPE min_a_c = a_le_c ? a : c;
+        SORT_TYPE max_a_c = a_le_c ? c : a;
+        SORT_TYPE min_b_c = b_le_c ? b : c;
+        SORT_TYPE max_b_c = b_le_c ? c : b;
+        array[0] = a_le_b ? min_a_c : min_b_c;
+        array[1] = a_le_b ? (b_le_c ? b : max_a_c) : (a_le_c ? a : max_b_c);
+        array[2] = a_le_b ? max_b_c : max_a_c;
+        return;
+    }
+    size_t lhs_nelems = nelems / 2;
+    size_t rhs_nelems = nelems - lhs_nelems;
+    SORT_NAME(merge_sort_rec)(merge_array, array, lhs_nelems);
+    SORT_NAME(merge_sort_rec)(merge_array + lhs_nelems, array + lhs_nelems, rhs_nelems);
+    SORT_TYPE *lhs = merge_array;
+    SORT_TYPE *rhs = merge_array + lhs_nelems;
+    SORT_TYPE *lhs_end = rhs;
+    SORT_TYPE *rhs_end = rhs + rhs_nelems;
+    SORT_TYPE *dst = array;
+    while (1) {
+        bool rhs_lt_lhs = SORT_LESS(*rhs, *lhs);
+        *dst++ = rhs_lt_lhs ? *rhs : *lhs;
+        lhs += !rhs_lt_lhs;
+        rhs += rhs_lt_lhs;
+        if (unlikely(lhs == lhs_end)) {
+            copy(dst, rhs, (size_t) (rhs_end - rhs) * sizeof(SORT_TYPE));
+            break;
+        }
+        if (unlikely(rhs == rhs_end)) {
+            copy(dst, lhs, (size_t) (lhs_end - lhs) * sizeof(SORT_TYPE));
+            break;
+        }
+    }
+}
+
+SORT_LINKAGE void SORT_NAME(merge_sort)(SORT_TYPE *base, size_t nelems)
+{
+    if (nelems < 2) {
+        return;
+    }
+    SORT_TYPE *merge_array = malloc(nelems * sizeof(SORT_TYPE));
+    copy(merge_array, base, nelems * sizeof(SORT_TYPE));
+    SORT_NAME(merge_sort_rec)(base, merge_array, nelems);
+    free(merge_array);
+}
+
+#undef SORT_TYPE
+#undef SORT_SUFFIX
+#undef SORT_LESS
+#undef SORT_LINKAGE
+#undef SORT_NETWORK
+#undef SORT_NETWORK_MAX
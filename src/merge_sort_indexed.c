@@ -32,103 +32,141 @@
 #include "sort.h"
 #include "util.h"
 
-typedef uint32_t index_t;
+/* The indices are as narrow as nelems allows (see sort_index_width) */
+#define INDEX_TYPE uint16_t
+#define INDEX_SUFFIX u16
+#include "index_sort_impl.h"
 
-static void *get_elem_ptr(void *base, size_t size, index_t index)
+#define INDEX_TYPE uint32_t
+#define INDEX_SUFFIX u32
+#include "index_sort_impl.h"
+
+#define INDEX_TYPE uint64_t
+#define INDEX_SUFFIX u64
+#include "index_sort_impl.h"
+
+#define PREFIX_TYPE uint32_t
+#define PREFIX_SUFFIX u32
+#include "merge_sort_prefix_impl.h"
+
+#define PREFIX_TYPE uint64_t
+#define PREFIX_SUFFIX u64
+#include "merge_sort_prefix_impl.h"
+
+/* The buffer holds the two index arrays */
+static size_t buffer_size(size_t nelems)
 {
-    return (char *) base + (size * index);
+    return nelems * 2 * sort_index_width(nelems);
 }
 
-static void sort_two(void *base, size_t size, index_t *index_array, compare_fn_t compare, void *context)
+static void merge_sort_indexed_with_buffer(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, void *buffer)
 {
-    const index_t a_index = index_array[0];
-    const index_t b_index = index_array[1];
-    void *a_ptr = get_elem_ptr(base, size, a_index);
-    void *b_ptr = get_elem_ptr(base, size, b_index);
-    const bool a_le_b = compare(a_ptr, b_ptr, context) <= 0;
-    index_array[0] = a_le_b ? a_index : b_index;
-    index_array[1] = a_le_b ? b_index : a_index;
+    switch (sort_index_width(nelems)) {
+        case sizeof(uint16_t):
+            sort_indices_u16(base, nelems, size, compare, context, buffer);
+            apply_permutation_u16(base, nelems, size, buffer);
+            break;
+        case sizeof(uint32_t):
+            sort_indices_u32(base, nelems, size, compare, context, buffer);
+            apply_permutation_u32(base, nelems, size, buffer);
+            break;
+        default:
+            sort_indices_u64(base, nelems, size, compare, context, buffer);
+            apply_permutation_u64(base, nelems, size, buffer);
+            break;
+    }
 }
 
-static void sort_three(void *base, size_t size, index_t *index_array, compare_fn_t compare, void *context)
+/* A 32-bit prefix is sorted in 8-byte pairs unless there are too many elements for a 32-bit index */
+static bool use_u32_prefix(size_t nelems, size_t prefix_width)
 {
-    const index_t a_index = index_array[0];
-    const index_t b_index = index_array[1];
-    const index_t c_index = index_array[2];
-    void *a_ptr = get_elem_ptr(base, size, a_index);
-    void *b_ptr = get_elem_ptr(base, size, b_index);
-    void *c_ptr = get_elem_ptr(base, size, c_index);
-    const bool a_le_b = compare(a_ptr, b_ptr, context) <= 0;
-    const bool a_le_c = compare(a_ptr, c_ptr, context) <= 0;
-    const bool b_le_c = compare(b_ptr, c_ptr, context) <= 0;
-    const index_t min_a_c = a_le_c ? a_index : c_index;
-    const index_t max_a_c = a_le_c ? c_index : a_index;
-    const index_t min_b_c = b_le_c ? b_index : c_index;
-    const index_t max_b_c = b_le_c ? c_index : b_index;
-    index_array[0] = a_le_b ? min_a_c : min_b_c;
-    index_array[1] = a_le_b ? (b_le_c ? b_index : max_a_c) : (a_le_c ? a_index : max_b_c);
-    index_array[2] = a_le_b ? max_b_c : max_a_c;
+    return prefix_width <= sizeof(uint32_t) && sort_index_width(nelems) <= sizeof(uint32_t);
 }
 
-static void merge_sort_rec(void *base, size_t nelems, size_t size, index_t *index_array, index_t *merge_array, compare_fn_t compare, void *context)
+static size_t prefix_buffer_size(size_t nelems, size_t prefix_width)
 {
-    if (nelems <= 2) {
-        if (nelems == 2) {
-            sort_two(base, size, index_array, compare, context);
-        }
+    return use_u32_prefix(nelems, prefix_width) ? prefix_buffer_size_u32(nelems) : prefix_buffer_size_u64(nelems);
+}
+
+static void merge_sort_indexed_prefix_with_buffer(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context,
+                                                  key_fn_t prefix_fn, size_t prefix_width, void *buffer)
+{
+    if (use_u32_prefix(nelems, prefix_width)) {
+        prefix_merge_sort_u32(base, nelems, size, compare, context, prefix_fn, buffer);
+    } else {
+        prefix_merge_sort_u64(base, nelems, size, compare, context, prefix_fn, buffer);
+    }
+}
+
+void merge_sort_indexed(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context)
+{
+    if (nelems < 2) {
         return;
-    } else if (nelems == 3) {
-        sort_three(base, size, index_array, compare, context);
+    }
+    void *buffer = malloc(buffer_size(nelems));
+    merge_sort_indexed_with_buffer(base, nelems, size, compare, context, buffer);
+    free(buffer);
+}
+
+void merge_sort_indexed_ws(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, struct sort_workspace *ws)
+{
+    if (nelems < 2) {
         return;
     }
-    size_t lhs_nelems = nelems / 2;
-    size_t rhs_nelems = nelems - lhs_nelems;
-    merge_sort_rec(base, lhs_nelems, size, merge_array, index_array, compare, context);
-    merge_sort_rec(base, rhs_nelems, size, merge_array + lhs_nelems, index_array + lhs_nelems, compare, context);
-    index_t *lhs = merge_array;
-    index_t *rhs = merge_array + lhs_nelems;
-    index_t *lhs_end = lhs + lhs_nelems;
-    index_t *rhs_end = rhs + rhs_nelems;
-    index_t *dst = index_array;
-    while (1) {
-        const index_t lhs_index = *lhs;
-        const index_t rhs_index = *rhs;
-        const void *lhs_ptr = get_elem_ptr(base, size, lhs_index);
-        const void *rhs_ptr = get_elem_ptr(base, size, rhs_index);
-        const bool lhs_le_rhs = compare(lhs_ptr, rhs_ptr, context) <= 0;
-        *dst++ = lhs_le_rhs ? lhs_index : rhs_index;
-        lhs += lhs_le_rhs;
-        rhs += !lhs_le_rhs;
-        if (unlikely(lhs == lhs_end)) {
-            copy(dst, rhs, (size_t) ((char *) rhs_end - (char *) rhs));
-            break;
+    void *buffer = sort_workspace_reserve(ws, buffer_size(nelems));
+    if (!buffer) {
+        merge_sort_indexed(base, nelems, size, compare, context);
+        return;
+    }
+    merge_sort_indexed_with_buffer(base, nelems, size, compare, context, buffer);
+}
+
+void merge_sort_indexed_out(const void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, void *out)
+{
+    if (nelems < 2) {
+        if (nelems == 1) {
+            copy(out, base, size);
         }
-        if (unlikely(rhs == rhs_end)) {
-            copy(dst, lhs, (size_t) ((char *) lhs_end - (char *) lhs));
+        return;
+    }
+    void *buffer = malloc(buffer_size(nelems));
+    switch (sort_index_width(nelems)) {
+        case sizeof(uint16_t):
+            sort_indices_u16(base, nelems, size, compare, context, buffer);
+            gather_u16(base, nelems, size, buffer, out);
+            break;
+        case sizeof(uint32_t):
+            sort_indices_u32(base, nelems, size, compare, context, buffer);
+            gather_u32(base, nelems, size, buffer, out);
+            break;
+        default:
+            sort_indices_u64(base, nelems, size, compare, context, buffer);
+            gather_u64(base, nelems, size, buffer, out);
             break;
-        }
     }
+    free(buffer);
 }
 
-void merge_sort_indexed(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context)
+void merge_sort_indexed_prefix(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, key_fn_t prefix_fn, size_t prefix_width)
 {
-    index_t *index_array = calloc(nelems * 2, sizeof(index_t));
-    index_t *merge_array = index_array + nelems;
-    for (index_t i = 0; i < nelems; i++) {
-        index_array[i] = i;
+    if (nelems < 2) {
+        return;
     }
-    for (index_t i = 0; i < nelems; i++) {
-        merge_array[i] = i;
+    void *buffer = malloc(prefix_buffer_size(nelems, prefix_width));
+    merge_sort_indexed_prefix_with_buffer(base, nelems, size, compare, context, prefix_fn, prefix_width, buffer);
+    free(buffer);
+}
+
+void merge_sort_indexed_prefix_ws(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context,
+                                  key_fn_t prefix_fn, size_t prefix_width, struct sort_workspace *ws)
+{
+    if (nelems < 2) {
+        return;
     }
-    merge_sort_rec(base, nelems, size, index_array, merge_array, compare, context);
-    void *array_copy = calloc(nelems, size);
-    copy(array_copy, base, nelems * size);
-    char *dst_ptr = base;
-    for (size_t i = 0; i < nelems; i++) {
-        void *src_ptr = get_elem_ptr(array_copy, size, index_array[i]);
-        copy(dst_ptr, src_ptr, size);
-        dst_ptr += size;
+    void *buffer = sort_workspace_reserve(ws, prefix_buffer_size(nelems, prefix_width));
+    if (!buffer) {
+        merge_sort_indexed_prefix(base, nelems, size, compare, context, prefix_fn, prefix_width);
+        return;
     }
-    free(array_copy);
-    free(index_array);
+    merge_sort_indexed_prefix_with_buffer(base, nelems, size, compare, context, prefix_fn, prefix_width, buffer);
 }
@@ -0,0 +1,143 @@
+/*
+ * Written by Luke McCarthy <luke@iogopro.co.uk>
+ * https://github.com/ljmccarthy/sorting_algorithms
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+ * this software, either in source code form or as a compiled binary, for any
+ * purpose, commercial or non-commercial, and by any means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors of
+ * this software dedicate any and all copyright interest in the software to the
+ * public domain. We make this dedication for the benefit of the public at
+ * large and to the detriment of our heirs and successors. We intend this
+ * dedication to be an overt act of relinquishment in perpetuity of all present
+ * and future rights to this software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org/>
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "sort.h"
+#include "task_pool.h"
+#include "util.h"
+#include "merge_sort_rec_impl.h"
+
+/* Below these sizes the overhead of spawning a task outweighs the parallelism gained. */
+#define PARALLEL_SORT_CUTOFF 8192
+#define PARALLEL_MERGE_CUTOFF 8192
+
+struct sort_params {
+    size_t size;
+    compare_fn_t compare;
+    void *context;
+};
+
+struct sort_task_args {
+    const struct sort_params *params;
+    char *array;
+    char *merge_array;
+    size_t nelems;
+};
+
+struct merge_task_args {
+    const struct sort_params *params;
+    const char *lhs;
+    size_t lhs_nelems;
+    const char *rhs;
+    size_t rhs_nelems;
+    char *dst;
+};
+
+/*
+ * Co-ranking: find how many elements of lhs are among the first k elements of
+ * the stable merge of lhs and rhs. The remaining k - i come from rhs. This
+ * lets both halves of a merge be produced independently.
+ */
+static size_t corank(size_t k, const char *lhs, size_t lhs_nelems, const char *rhs, size_t rhs_nelems, const struct sort_params *params)
+{
+    size_t lo = k > rhs_nelems ? k - rhs_nelems : 0;
+    size_t hi = k < lhs_nelems ? k : lhs_nelems;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const char *lhs_elem = lhs + mid * params->size;
+        const char *rhs_elem = rhs + (k - mid - 1) * params->size;
+        if (params->compare(lhs_elem, rhs_elem, params->context) <= 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static void parallel_merge_task(struct task_worker *worker, void *arg)
+{
+    const struct merge_task_args *args = arg;
+    const struct sort_params *params = args->params;
+    size_t nelems = args->lhs_nelems + args->rhs_nelems;
+    if (nelems <= PARALLEL_MERGE_CUTOFF) {
+        merge(args->lhs, args->lhs_nelems, args->rhs, args->rhs_nelems, args->dst, params->size, params->compare, params->context);
+        return;
+    }
+    size_t k = nelems / 2;
+    size_t i = corank(k, args->lhs, args->lhs_nelems, args->rhs, args->rhs_nelems, params);
+    size_t j = k - i;
+    struct merge_task_args front_args = {params, args->lhs, i, args->rhs, j, args->dst};
+    struct merge_task_args back_args = {
+        params,
+        args->lhs + i * params->size, args->lhs_nelems - i,
+        args->rhs + j * params->size, args->rhs_nelems - j,
+        args->dst + k * params->size,
+    };
+    struct task front_task;
+    task_spawn(worker, &front_task, parallel_merge_task, &front_args);
+    parallel_merge_task(worker, &back_args);
+    task_wait(worker, &front_task);
+}
+
+static void parallel_sort_task(struct task_worker *worker, void *arg)
+{
+    const struct sort_task_args *args = arg;
+    const struct sort_params *params = args->params;
+    size_t size = params->size;
+    if (args->nelems <= PARALLEL_SORT_CUTOFF) {
+        merge_sort_rec(args->array, args->merge_array, args->nelems, size, params->compare, params->context);
+        return;
+    }
+    size_t lhs_nelems = args->nelems / 2;
+    size_t rhs_nelems = args->nelems - lhs_nelems;
+    struct sort_task_args lhs_args = {params, args->merge_array, args->array, lhs_nelems};
+    struct sort_task_args rhs_args = {params, args->merge_array + lhs_nelems * size, args->array + lhs_nelems * size, rhs_nelems};
+    struct task lhs_task;
+    task_spawn(worker, &lhs_task, parallel_sort_task, &lhs_args);
+    parallel_sort_task(worker, &rhs_args);
+    task_wait(worker, &lhs_task);
+    struct merge_task_args merge_args = {params, args->merge_array, lhs_nelems, args->merge_array + lhs_nelems * size, rhs_nelems, args->array};
+    parallel_merge_task(worker, &merge_args);
+}
+
+void merge_sort_parallel(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, unsigned nthreads)
+{
+    size_t array_size = nelems * size;
+    char *merge_array = malloc(array_size);
+    copy(merge_array, base, array_size);
+    struct sort_params params = {size, compare, context};
+    struct sort_task_args args = {&params, base, merge_array, nelems};
+    if (nelems <= PARALLEL_SORT_CUTOFF) {
+        merge_sort_rec(base, merge_array, nelems, size, compare, context);
+    } else {
+        task_pool_run(nthreads, parallel_sort_task, &args);
+    }
+    free(merge_array);
+}
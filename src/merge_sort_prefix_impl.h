@@ -0,0 +1,136 @@
+/*
+ * Written by Luke McCarthy <luke@iogopro.co.uk>, Oct-Nov 2025
+ * https://github.com/ljmccarthy/sorting_algorithms
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+ * this software, either in source code form or as a compiled binary, for any
+ * purpose, commercial or non-commercial, and by any means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors of
+ * this software dedicate any and all copyright interest in the software to the
+ * public domain. We make this dedication for the benefit of the public at
+ * large and to the detriment of our heirs and successors. We intend this
+ * dedication to be an overt act of relinquishment in perpetuity of all present
+ * and future rights to this software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org/>
+ */
+
+/*
+ * The (key prefix, index) merge sort behind merge_sort_indexed_prefix, for
+ * one width of prefix. Merging compares the prefixes in the dense pair array
+ * and only looks at the elements, through the comparison function, when two
+ * prefixes are equal. Define these and then include this file after
+ * index_sort_impl.h has been included with the same type and suffix (the
+ * index in each pair has the same width as the prefix):
+ *
+ *     PREFIX_TYPE    unsigned integer type of the prefix
+ *     PREFIX_SUFFIX  appended to the names defined here, e.g. u32
+ *
+ * This defines the pair type prefix_pair_<PREFIX_SUFFIX> and:
+ *
+ *     static size_t prefix_buffer_size_<PREFIX_SUFFIX>(size_t nelems);
+ *     static void prefix_merge_sort_<PREFIX_SUFFIX>(void *base, size_t nelems, size_t size,
+ *         compare_fn_t compare, void *context, key_fn_t prefix_fn, void *buffer);
+ *
+ * The parameters are undefined at the end of this file.
+ */
+
+#ifndef PREFIX_NAME
+#define PREFIX_CONCAT(x, y) x ## _ ## y
+#define PREFIX_MAKE_NAME(x, y) PREFIX_CONCAT(x, y)
+#define PREFIX_NAME(x) PREFIX_MAKE_NAME(x, PREFIX_SUFFIX)
+#endif
+
+#define PREFIX_PAIR struct PREFIX_NAME(prefix_pair)
+
+PREFIX_PAIR {
+    PREFIX_TYPE prefix;
+    PREFIX_TYPE index;
+};
+
+static inline bool PREFIX_NAME(pair_le)(const PREFIX_PAIR *a, const PREFIX_PAIR *b, void *base, size_t size, compare_fn_t compare, void *context)
+{
+    if (a->prefix != b->prefix) {
+        return a->prefix < b->prefix;
+    }
+    return compare(INDEX_ELEM_PTR(base, size, a->index), INDEX_ELEM_PTR(base, size, b->index), context) <= 0;
+}
+
+static void PREFIX_NAME(prefix_merge_sort_rec)(void *base, size_t nelems, size_t size, PREFIX_PAIR *pairs, PREFIX_PAIR *merge_pairs, compare_fn_t compare, void *context)
+{
+    if (nelems <= 3) {
+        /* insertion sort */
+        for (size_t i = 1; i < nelems; i++) {
+            PREFIX_PAIR pair = pairs[i];
+            size_t j = i;
+            for (; j > 0 && !PREFIX_NAME(pair_le)(&pairs[j - 1], &pair, base, size, compare, context); j--) {
+                pairs[j] = pairs[j - 1];
+            }
+            pairs[j] = pair;
+        }
+        return;
+    }
+    size_t lhs_nelems = nelems / 2;
+    size_t rhs_nelems = nelems - lhs_nelems;
+    PREFIX_NAME(prefix_merge_sort_rec)(base, lhs_nelems, size, merge_pairs, pairs, compare, context);
+    PREFIX_NAME(prefix_merge_sort_rec)(base, rhs_nelems, size, merge_pairs + lhs_nelems, pairs + lhs_nelems, compare, context);
+    PREFIX_PAIR *lhs = merge_pairs;
+    PREFIX_PAIR *rhs = merge_pairs + lhs_nelems;
+    PREFIX_PAIR *lhs_end = lhs + lhs_nelems;
+    PREFIX_PAIR *rhs_end = rhs + rhs_nelems;
+    PREFIX_PAIR *dst = pairs;
+    while (1) {
+        const bool lhs_le_rhs = PREFIX_NAME(pair_le)(lhs, rhs, base, size, compare, context);
+        *dst++ = lhs_le_rhs ? *lhs : *rhs;
+        lhs += lhs_le_rhs;
+        rhs += !lhs_le_rhs;
+        if (unlikely(lhs == lhs_end)) {
+            copy(dst, rhs, (size_t) ((char *) rhs_end - (char *) rhs));
+            break;
+        }
+        if (unlikely(rhs == rhs_end)) {
+            copy(dst, lhs, (size_t) ((char *) lhs_end - (char *) lhs));
+            break;
+        }
+    }
+}
+
+/* The buffer holds the two pair arrays */
+static size_t PREFIX_NAME(prefix_buffer_size)(size_t nelems)
+{
+    return nelems * 2 * sizeof(PREFIX_PAIR);
+}
+
+static void PREFIX_NAME(prefix_merge_sort)(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, key_fn_t prefix_fn, void *buffer)
+{
+    PREFIX_PAIR *pairs = buffer;
+    PREFIX_PAIR *merge_pairs = pairs + nelems;
+    const char *elem = base;
+    for (size_t i = 0; i < nelems; i++) {
+        pairs[i].prefix = (PREFIX_TYPE) prefix_fn(elem, context);
+        pairs[i].index = (PREFIX_TYPE) i;
+        elem += size;
+    }
+    copy(merge_pairs, pairs, nelems * sizeof(PREFIX_PAIR));
+    PREFIX_NAME(prefix_merge_sort_rec)(base, nelems, size, pairs, merge_pairs, compare, context);
+    /* The merge pairs aren't needed any more, reuse them for the sorted indices */
+    PREFIX_TYPE *index_array = (PREFIX_TYPE *) merge_pairs;
+    for (size_t i = 0; i < nelems; i++) {
+        index_array[i] = pairs[i].index;
+    }
+    PREFIX_NAME(apply_permutation)(base, nelems, size, index_array);
+}
+
+#undef PREFIX_PAIR
+#undef PREFIX_TYPE
+#undef PREFIX_SUFFIX
@@ -96,24 +96,103 @@ static void merge_sort_rec(void **ptr_array, void **merge_ptr_array, size_t nele
     }
 }
 
-void merge_sort_ptr(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context)
+/*
+ * Moves the elements into the order given by ptr_array, following each cycle
+ * of the permutation with one element held in temp. Each position is marked
+ * as done by pointing it at itself, so nothing else is needed to track which
+ * elements have been moved.
+ */
+static void apply_permutation(char *base, size_t nelems, size_t size, void **ptr_array)
+{
+    char temp_buf[1024];
+    char *temp = size > sizeof(temp_buf) ? malloc(size) : temp_buf;
+    for (size_t i = 0; i < nelems; i++) {
+        char *start_ptr = base + i * size;
+        if (ptr_array[i] == start_ptr) {
+            continue;
+        }
+        copy(temp, start_ptr, size);
+        size_t j = i;
+        while (1) {
+            char *dst_ptr = base + j * size;
+            char *src_ptr = ptr_array[j];
+            ptr_array[j] = dst_ptr;
+            if (src_ptr == start_ptr) {
+                copy(dst_ptr, temp, size);
+                break;
+            }
+            copy(dst_ptr, src_ptr, size);
+            j = (size_t) (src_ptr - base) / size;
+        }
+    }
+    if (temp != temp_buf) {
+        free(temp);
+    }
+}
+
+/* The buffer holds the two pointer arrays */
+static size_t buffer_size(size_t nelems)
+{
+    return nelems * 2 * sizeof(void *);
+}
+
+/* Leaves pointers to the elements in sorted order in the first half of the buffer */
+static void sort_ptrs(char *base, size_t nelems, size_t size, compare_fn_t compare, void *context, void **buffer)
 {
-    void *elem_array = calloc(nelems, size);
-    copy(elem_array, base, nelems * size);
-    void **ptr_array = calloc(nelems * 2, sizeof(void *));
+    void **ptr_array = buffer;
     void **merge_ptr_array = ptr_array + nelems;
-    char *elem_ptr = elem_array;
+    char *elem_ptr = base;
     for (size_t i = 0; i < nelems; i++) {
         ptr_array[i] = elem_ptr;
         merge_ptr_array[i] = elem_ptr;
         elem_ptr += size;
     }
     merge_sort_rec(ptr_array, merge_ptr_array, nelems, size, compare, context);
-    char *dst_ptr = base;
+}
+
+static void merge_sort_ptr_with_buffer(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, void *buffer)
+{
+    sort_ptrs(base, nelems, size, compare, context, buffer);
+    apply_permutation(base, nelems, size, buffer);
+}
+
+void merge_sort_ptr(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context)
+{
+    if (nelems < 2) {
+        return;
+    }
+    void *buffer = malloc(buffer_size(nelems));
+    merge_sort_ptr_with_buffer(base, nelems, size, compare, context, buffer);
+    free(buffer);
+}
+
+void merge_sort_ptr_ws(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, struct sort_workspace *ws)
+{
+    if (nelems < 2) {
+        return;
+    }
+    void *buffer = sort_workspace_reserve(ws, buffer_size(nelems));
+    if (!buffer) {
+        merge_sort_ptr(base, nelems, size, compare, context);
+        return;
+    }
+    merge_sort_ptr_with_buffer(base, nelems, size, compare, context, buffer);
+}
+
+void merge_sort_ptr_out(const void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, void *out)
+{
+    if (nelems < 2) {
+        if (nelems == 1) {
+            copy(out, base, size);
+        }
+        return;
+    }
+    void **buffer = malloc(buffer_size(nelems));
+    sort_ptrs((char *) base, nelems, size, compare, context, buffer);
+    char *dst_ptr = out;
     for (size_t i = 0; i < nelems; i++) {
-        copy(dst_ptr, ptr_array[i], size);
+        copy(dst_ptr, buffer[i], size);
         dst_ptr += size;
     }
-    free(elem_array);
-    free(ptr_array);
+    free(buffer);
 }
@@ -0,0 +1,500 @@
+/*
+ * Written by Luke McCarthy <luke@iogopro.co.uk>
+ * https://github.com/ljmccarthy/sorting_algorithms
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+ * this software, either in source code form or as a compiled binary, for any
+ * purpose, commercial or non-commercial, and by any means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors of
+ * this software dedicate any and all copyright interest in the software to the
+ * public domain. We make this dedication for the benefit of the public at
+ * large and to the detriment of our heirs and successors. We intend this
+ * dedication to be an overt act of relinquishment in perpetuity of all present
+ * and future rights to this software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org/>
+ */
+
+/*
+ * Pattern-defeating quicksort, after Orson Peters' pdqsort
+ * (https://github.com/orlp/pdqsort).
+ *
+ * This is an introsort: quicksort with a ninther pivot on large partitions
+ * that switches to heapsort once it has seen log2(n) badly unbalanced
+ * partitions, so the worst case is O(n log n). Unbalanced partitions also
+ * trigger a few swaps to break up patterns that fool the pivot selection.
+ * If a partition needed no swaps, a bounded insertion sort is attempted on
+ * both sides, which sorts already sorted input in linear time. Partitions
+ * with many elements equal to the pivot are handled in linear time by
+ * partitioning equal elements to the left.
+ *
+ * pdq_sort_branchless uses the block partitioning scheme from "BlockQuicksort:
+ * How Branch Mispredictions don't affect Quicksort" by Stefan Edelkamp and
+ * Armin Weiss. Comparison results are recorded as offsets into small buffers
+ * without branching on them, and the misplaced elements are then swapped in
+ * bulk. This avoids the mispredicted branch per comparison of the classic
+ * partition loop, which pays off when comparisons are cheap.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "sort.h"
+#include "util.h"
+
+#define INSERTION_SORT_THRESHOLD 24
+#define NINTHER_THRESHOLD 128
+#define PARTIAL_INSERTION_SORT_LIMIT 8
+#define PARTITION_BLOCK_SIZE 64 /* must fit the offsets in an unsigned char */
+
+struct pdq_params {
+    size_t size;
+    compare_fn_t compare;
+    void *context;
+    char *pivot; /* holds the pivot during partitioning, and the element being inserted in insertion sort */
+    char *temp;  /* for swaps */
+    bool branchless;
+};
+
+static inline bool less(const struct pdq_params *p, const char *a, const char *b)
+{
+    return p->compare(a, b, p->context) < 0;
+}
+
+static inline void swap_elems(const struct pdq_params *p, char *a, char *b)
+{
+    swap(a, b, p->temp, p->size);
+}
+
+static void sort2(const struct pdq_params *p, char *a, char *b)
+{
+    if (less(p, b, a)) {
+        swap_elems(p, a, b);
+    }
+}
+
+static void sort3(const struct pdq_params *p, char *a, char *b, char *c)
+{
+    sort2(p, a, b);
+    sort2(p, b, c);
+    sort2(p, a, b);
+}
+
+static void pdq_insertion_sort(const struct pdq_params *p, char *begin, char *end)
+{
+    size_t size = p->size;
+    if (begin == end) {
+        return;
+    }
+    for (char *cur = begin + size; cur != end; cur += size) {
+        char *sift = cur;
+        if (less(p, sift, sift - size)) {
+            copy(p->pivot, sift, size);
+            do {
+                copy(sift, sift - size, size);
+                sift -= size;
+            } while (sift != begin && less(p, p->pivot, sift - size));
+            copy(sift, p->pivot, size);
+        }
+    }
+}
+
+/* Swaps two elements through temp, temp_size bytes at a time, so temp can be smaller than an element */
+static void swap_through(char *a, char *b, size_t size, char *temp, size_t temp_size)
+{
+    while (size > 0) {
+        size_t n = size < temp_size ? size : temp_size;
+        swap(a, b, temp, n);
+        a += n;
+        b += n;
+        size -= n;
+    }
+}
+
+/* Sifts the element at root down the max-heap of nelems elements at begin */
+static void pdq_sift_down(const struct pdq_params *p, char *begin, size_t nelems, size_t root, char *temp, size_t temp_size)
+{
+    size_t size = p->size;
+    size_t child;
+    while ((child = 2 * root + 1) < nelems) {
+        if (child + 1 < nelems && less(p, begin + child * size, begin + (child + 1) * size)) {
+            child++;
+        }
+        if (!less(p, begin + root * size, begin + child * size)) {
+            break;
+        }
+        swap_through(begin + root * size, begin + child * size, size, temp, temp_size);
+        root = child;
+    }
+}
+
+/* In-place heapsort, the fallback for bad partitions and for when the temporaries can't be allocated */
+static void pdq_heap_sort(const struct pdq_params *p, char *begin, size_t nelems, char *temp, size_t temp_size)
+{
+    for (size_t i = nelems / 2; i-- > 0;) {
+        pdq_sift_down(p, begin, nelems, i, temp, temp_size);
+    }
+    for (size_t end = nelems; end-- > 1;) {
+        swap_through(begin, begin + end * p->size, p->size, temp, temp_size);
+        pdq_sift_down(p, begin, end, 0, temp, temp_size);
+    }
+}
+
+/* Assumes the element before begin is not greater than any element in the range */
+static void pdq_unguarded_insertion_sort(const struct pdq_params *p, char *begin, char *end)
+{
+    size_t size = p->size;
+    if (begin == end) {
+        return;
+    }
+    for (char *cur = begin + size; cur != end; cur += size) {
+        char *sift = cur;
+        if (less(p, sift, sift - size)) {
+            copy(p->pivot, sift, size);
+            do {
+                copy(sift, sift - size, size);
+                sift -= size;
+            } while (less(p, p->pivot, sift - size));
+            copy(sift, p->pivot, size);
+        }
+    }
+}
+
+/* Insertion sort that gives up once it has moved more than PARTIAL_INSERTION_SORT_LIMIT elements */
+static bool pdq_partial_insertion_sort(const struct pdq_params *p, char *begin, char *end)
+{
+    size_t size = p->size;
+    size_t limit = 0;
+    if (begin == end) {
+        return true;
+    }
+    for (char *cur = begin + size; cur != end; cur += size) {
+        if (limit > PARTIAL_INSERTION_SORT_LIMIT) {
+            return false;
+        }
+        char *sift = cur;
+        if (less(p, sift, sift - size)) {
+            copy(p->pivot, sift, size);
+            do {
+                copy(sift, sift - size, size);
+                sift -= size;
+            } while (sift != begin && less(p, p->pivot, sift - size));
+            copy(sift, p->pivot, size);
+            limit += (size_t) (cur - sift) / size;
+        }
+    }
+    return true;
+}
+
+/*
+ * Partition around the pivot at begin, putting elements equal to the pivot on
+ * the right. Returns the final position of the pivot and sets
+ * already_partitioned if no elements had to be swapped.
+ */
+static char *partition_right(const struct pdq_params *p, char *begin, char *end, bool *already_partitioned)
+{
+    size_t size = p->size;
+    char *pivot = p->pivot;
+    char *first = begin;
+    char *last = end;
+    copy(pivot, begin, size);
+    /* The median of 3 guarantees an element not less than the pivot exists */
+    do { first += size; } while (less(p, first, pivot));
+    if (first - size == begin) {
+        while (first < last) {
+            last -= size;
+            if (less(p, last, pivot)) break;
+        }
+    } else {
+        do { last -= size; } while (!less(p, last, pivot));
+    }
+    *already_partitioned = first >= last;
+    while (first < last) {
+        swap_elems(p, first, last);
+        do { first += size; } while (less(p, first, pivot));
+        do { last -= size; } while (!less(p, last, pivot));
+    }
+    char *pivot_pos = first - size;
+    copy(begin, pivot_pos, size);
+    copy(pivot_pos, pivot, size);
+    return pivot_pos;
+}
+
+/*
+ * Swap num elements from the left offset block with elements from the right
+ * offset block. When the counts differ the swaps are done as one cycle, which
+ * needs fewer element moves, but with equal counts plain swaps are needed to
+ * keep descending input linear.
+ */
+static void swap_offsets(const struct pdq_params *p, char *first, char *last, const unsigned char *offsets_l, const unsigned char *offsets_r, size_t num, bool use_swaps)
+{
+    size_t size = p->size;
+    if (use_swaps) {
+        for (size_t i = 0; i < num; i++) {
+            swap_elems(p, first + offsets_l[i] * size, last - offsets_r[i] * size);
+        }
+    } else if (num > 0) {
+        char *l = first + offsets_l[0] * size;
+        char *r = last - offsets_r[0] * size;
+        copy(p->temp, l, size);
+        copy(l, r, size);
+        for (size_t i = 1; i < num; i++) {
+            l = first + offsets_l[i] * size;
+            copy(r, l, size);
+            r = last - offsets_r[i] * size;
+            copy(l, r, size);
+        }
+        copy(r, p->temp, size);
+    }
+}
+
+/* Same as partition_right but using block partitioning */
+static char *partition_right_branchless(const struct pdq_params *p, char *begin, char *end, bool *already_partitioned)
+{
+    size_t size = p->size;
+    char *pivot = p->pivot;
+    char *first = begin;
+    char *last = end;
+    copy(pivot, begin, size);
+    do { first += size; } while (less(p, first, pivot));
+    if (first - size == begin) {
+        while (first < last) {
+            last -= size;
+            if (less(p, last, pivot)) break;
+        }
+    } else {
+        do { last -= size; } while (!less(p, last, pivot));
+    }
+    *already_partitioned = first >= last;
+    if (!*already_partitioned) {
+        swap_elems(p, first, last);
+        first += size;
+
+        unsigned char offsets_l[PARTITION_BLOCK_SIZE];
+        unsigned char offsets_r[PARTITION_BLOCK_SIZE];
+        char *offsets_l_base = first;
+        char *offsets_r_base = last;
+        size_t num_l = 0, num_r = 0, start_l = 0, start_r = 0;
+
+        while (first < last) {
+            /* Decide how many unknown elements to examine on each side */
+            size_t num_unknown = (size_t) (last - first) / size;
+            size_t left_split = num_l == 0 ? (num_r == 0 ? num_unknown / 2 : num_unknown) : 0;
+            size_t right_split = num_r == 0 ? (num_unknown - left_split) : 0;
+            if (left_split > PARTITION_BLOCK_SIZE) {
+                left_split = PARTITION_BLOCK_SIZE;
+            }
+            if (right_split > PARTITION_BLOCK_SIZE) {
+                right_split = PARTITION_BLOCK_SIZE;
+            }
+
+            /* Record the offsets of elements on the wrong side, without branching on the comparison */
+            for (size_t i = 0; i < left_split; i++) {
+                offsets_l[num_l] = (unsigned char) i;
+                num_l += !less(p, first, pivot);
+                first += size;
+            }
+            for (size_t i = 0; i < right_split; i++) {
+                last -= size;
+                offsets_r[num_r] = (unsigned char) (i + 1);
+                num_r += less(p, last, pivot);
+            }
+
+            size_t num = num_l < num_r ? num_l : num_r;
+            swap_offsets(p, offsets_l_base, offsets_r_base, offsets_l + start_l, offsets_r + start_r, num, num_l == num_r);
+            num_l -= num;
+            num_r -= num;
+            start_l += num;
+            start_r += num;
+            if (num_l == 0) {
+                start_l = 0;
+                offsets_l_base = first;
+            }
+            if (num_r == 0) {
+                start_r = 0;
+                offsets_r_base = last;
+            }
+        }
+
+        /* One block may have elements left over, swap them to the middle */
+        if (num_l) {
+            while (num_l--) {
+                last -= size;
+                swap_elems(p, offsets_l_base + offsets_l[start_l + num_l] * size, last);
+            }
+            first = last;
+        }
+        if (num_r) {
+            while (num_r--) {
+                swap_elems(p, offsets_r_base - offsets_r[start_r + num_r] * size, first);
+                first += size;
+            }
+            last = first;
+        }
+    }
+    char *pivot_pos = first - size;
+    copy(begin, pivot_pos, size);
+    copy(pivot_pos, pivot, size);
+    return pivot_pos;
+}
+
+/*
+ * Partition around the pivot at begin, putting elements equal to the pivot on
+ * the left. Used when the pivot equals the element before the range, in which
+ * case everything on the left is equal and doesn't need sorting.
+ */
+static char *partition_left(const struct pdq_params *p, char *begin, char *end)
+{
+    size_t size = p->size;
+    char *pivot = p->pivot;
+    char *first = begin;
+    char *last = end;
+    copy(pivot, begin, size);
+    do { last -= size; } while (less(p, pivot, last));
+    if (last + size == end) {
+        while (first < last) {
+            first += size;
+            if (less(p, pivot, first)) break;
+        }
+    } else {
+        do { first += size; } while (!less(p, pivot, first));
+    }
+    while (first < last) {
+        swap_elems(p, first, last);
+        do { last -= size; } while (less(p, pivot, last));
+        do { first += size; } while (!less(p, pivot, first));
+    }
+    copy(begin, last, size);
+    copy(last, pivot, size);
+    return last;
+}
+
+static void pdq_sort_loop(const struct pdq_params *p, char *begin, char *end, unsigned bad_allowed, bool leftmost)
+{
+    size_t size = p->size;
+    while (1) {
+        size_t nelems = (size_t) (end - begin) / size;
+        if (nelems < INSERTION_SORT_THRESHOLD) {
+            if (leftmost) {
+                pdq_insertion_sort(p, begin, end);
+            } else {
+                pdq_unguarded_insertion_sort(p, begin, end);
+            }
+            return;
+        }
+
+        /* Choose the pivot as the median of 3 or pseudomedian of 9 and move it to begin */
+        size_t half = nelems / 2;
+        char *middle = begin + half * size;
+        char *back = end - size;
+        if (nelems > NINTHER_THRESHOLD) {
+            sort3(p, begin, middle, back);
+            sort3(p, begin + size, middle - size, back - size);
+            sort3(p, begin + 2 * size, middle + size, back - 2 * size);
+            sort3(p, middle - size, middle, middle + size);
+            swap_elems(p, begin, middle);
+        } else {
+            sort3(p, middle, begin, back);
+        }
+
+        /*
+         * If the pivot is equal to the element before this range (the pivot of
+         * an enclosing partition) then there are no smaller elements, so put
+         * everything equal to the pivot on the left and skip over it.
+         */
+        if (!leftmost && !less(p, begin - size, begin)) {
+            begin = partition_left(p, begin, end) + size;
+            continue;
+        }
+
+        bool already_partitioned;
+        char *pivot_pos = p->branchless
+            ? partition_right_branchless(p, begin, end, &already_partitioned)
+            : partition_right(p, begin, end, &already_partitioned);
+        size_t lhs_nelems = (size_t) (pivot_pos - begin) / size;
+        size_t rhs_nelems = (size_t) (end - (pivot_pos + size)) / size;
+        bool highly_unbalanced = lhs_nelems < nelems / 8 || rhs_nelems < nelems / 8;
+
+        if (highly_unbalanced) {
+            if (--bad_allowed == 0) {
+                pdq_heap_sort(p, begin, nelems, p->temp, size);
+                return;
+            }
+            /* Swap a few elements around to break patterns that defeat the pivot selection */
+            if (lhs_nelems >= INSERTION_SORT_THRESHOLD) {
+                size_t quarter = lhs_nelems / 4;
+                swap_elems(p, begin, begin + quarter * size);
+                swap_elems(p, pivot_pos - size, pivot_pos - quarter * size);
+                if (lhs_nelems > NINTHER_THRESHOLD) {
+                    swap_elems(p, begin + size, begin + (quarter + 1) * size);
+                    swap_elems(p, begin + 2 * size, begin + (quarter + 2) * size);
+                    swap_elems(p, pivot_pos - 2 * size, pivot_pos - (quarter + 1) * size);
+                    swap_elems(p, pivot_pos - 3 * size, pivot_pos - (quarter + 2) * size);
+                }
+            }
+            if (rhs_nelems >= INSERTION_SORT_THRESHOLD) {
+                size_t quarter = rhs_nelems / 4;
+                swap_elems(p, pivot_pos + size, pivot_pos + (1 + quarter) * size);
+                swap_elems(p, end - size, end - quarter * size);
+                if (rhs_nelems > NINTHER_THRESHOLD) {
+                    swap_elems(p, pivot_pos + 2 * size, pivot_pos + (2 + quarter) * size);
+                    swap_elems(p, pivot_pos + 3 * size, pivot_pos + (3 + quarter) * size);
+                    swap_elems(p, end - 2 * size, end - (quarter + 1) * size);
+                    swap_elems(p, end - 3 * size, end - (quarter + 2) * size);
+                }
+            }
+        } else if (already_partitioned
+                   && pdq_partial_insertion_sort(p, begin, pivot_pos)
+                   && pdq_partial_insertion_sort(p, pivot_pos + size, end)) {
+            /* The input was (nearly) sorted */
+            return;
+        }
+
+        /* Recurse into the left partition and loop on the right */
+        pdq_sort_loop(p, begin, pivot_pos, bad_allowed, leftmost);
+        begin = pivot_pos + size;
+        leftmost = false;
+    }
+}
+
+static void pdq_sort_common(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, bool branchless)
+{
+    char temp_buf[1024];
+    if (nelems <= 1) return;
+    char *temp = size * 2 > sizeof(temp_buf) ? malloc(size * 2) : temp_buf;
+    if (!temp) {
+        /* Heapsort only needs to swap elements, which it can do through temp_buf a piece at a time */
+        struct pdq_params heap_params = {size, compare, context, NULL, NULL, branchless};
+        pdq_heap_sort(&heap_params, base, nelems, temp_buf, sizeof(temp_buf));
+        return;
+    }
+    struct pdq_params params = {size, compare, context, temp, temp + size, branchless};
+    unsigned log2_nelems = 0;
+    for (size_t n = nelems; n > 1; n >>= 1) {
+        log2_nelems++;
+    }
+    pdq_sort_loop(&params, base, (char *) base + nelems * size, log2_nelems, true);
+    if (temp != temp_buf) {
+        free(temp);
+    }
+}
+
+void pdq_sort(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context)
+{
+    pdq_sort_common(base, nelems, size, compare, context, false);
+}
+
+void pdq_sort_branchless(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context)
+{
+    pdq_sort_common(base, nelems, size, compare, context, true);
+}
@@ -0,0 +1,140 @@
+/*
+ * Written by Luke McCarthy <luke@iogopro.co.uk>
+ * https://github.com/ljmccarthy/sorting_algorithms
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+ * this software, either in source code form or as a compiled binary, for any
+ * purpose, commercial or non-commercial, and by any means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors of
+ * this software dedicate any and all copyright interest in the software to the
+ * public domain. We make this dedication for the benefit of the public at
+ * large and to the detriment of our heirs and successors. We intend this
+ * dedication to be an overt act of relinquishment in perpetuity of all present
+ * and future rights to this software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org/>
+ */
+
+/*
+ * Bentley & McIlroy's quicksort (see third_party/bentley_mcilroy_quicksort.c)
+ * specialized for a fixed element type, with the comparison inlined. Takes the
+ * same parameters as merge_sort_impl.h and defines:
+ *
+ *     SORT_LINKAGE void quicksort_<SORT_SUFFIX>(SORT_TYPE *base, size_t nelems);
+ *
+ * Unlike the original this recurses on the smaller partition and loops on the
+ * larger, so stack depth is O(log n).
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifndef SORT_NAME
+#define SORT_CONCAT(x, y) x ## _ ## y
+#define SORT_MAKE_NAME(x, y) SORT_CONCAT(x, y)
+#define SORT_NAME(x) SORT_MAKE_NAME(x, SORT_SUFFIX)
+#endif
+
+#ifndef SORT_LINKAGE
+#define SORT_LINKAGE static
+#endif
+
+static inline void SORT_NAME(quicksort_swap)(SORT_TYPE *a, SORT_TYPE *b)
+{
+    SORT_TYPE t = *a;
+    *a = *b;
+    *b = t;
+}
+
+static inline void SORT_NAME(quicksort_vecswap)(SORT_TYPE *a, SORT_TYPE *b, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        SORT_NAME(quicksort_swap)(a + i, b + i);
+    }
+}
+
+static inline SORT_TYPE *SORT_NAME(quicksort_med3)(SORT_TYPE *a, SORT_TYPE *b, SORT_TYPE *c)
+{
+    return SORT_LESS(*a, *b) ? (SORT_LESS(*b, *c) ? b : SORT_LESS(*a, *c) ? c : a)
+                             : (SORT_LESS(*c, *b) ? b : SORT_LESS(*c, *a) ? c : a);
+}
+
+SORT_LINKAGE void SORT_NAME(quicksort)(SORT_TYPE *a, size_t n)
+{
+    while (n >= 7) {
+        SORT_TYPE *pm = a + n / 2;
+        if (n > 7) {
+            SORT_TYPE *pl = a;
+            SORT_TYPE *pn = a + n - 1;
+            if (n > 40) { /* Big arrays, pseudomedian of 9 */
+                size_t s = n / 8;
+                pl = SORT_NAME(quicksort_med3)(pl, pl + s, pl + 2 * s);
+                pm = SORT_NAME(quicksort_med3)(pm - s, pm, pm + s);
+                pn = SORT_NAME(quicksort_med3)(pn - 2 * s, pn - s, pn);
+            }
+            pm = SORT_NAME(quicksort_med3)(pl, pm, pn);
+        }
+        const SORT_TYPE v = *pm;
+        /* pc and pd are one past the positions used in the original, so they never go below zero */
+        size_t pa = 0, pb = 0, pc = n, pd = n;
+        for (;;) {
+            while (pb < pc && !SORT_LESS(v, a[pb])) {
+                if (!SORT_LESS(a[pb], v)) {
+                    SORT_NAME(quicksort_swap)(a + pa, a + pb);
+                    pa++;
+                }
+                pb++;
+            }
+            while (pc > pb && !SORT_LESS(a[pc - 1], v)) {
+                if (!SORT_LESS(v, a[pc - 1])) {
+                    SORT_NAME(quicksort_swap)(a + pc - 1, a + pd - 1);
+                    pd--;
+                }
+                pc--;
+            }
+            if (pb >= pc) break;
+            SORT_NAME(quicksort_swap)(a + pb, a + pc - 1);
+            pb++;
+            pc--;
+        }
+        size_t s = pa < pb - pa ? pa : pb - pa;
+        SORT_NAME(quicksort_vecswap)(a, a + pb - s, s);
+        s = pd - pc < n - pd ? pd - pc : n - pd;
+        SORT_NAME(quicksort_vecswap)(a + pb, a + n - s, s);
+        size_t lhs_n = pb - pa;
+        size_t rhs_n = pd - pc;
+        SORT_TYPE *rhs = a + n - rhs_n;
+        if (lhs_n < rhs_n) {
+            SORT_NAME(quicksort)(a, lhs_n);
+            a = rhs;
+            n = rhs_n;
+        } else {
+            SORT_NAME(quicksort)(rhs, rhs_n);
+            n = lhs_n;
+        }
+    }
+    /* Insertion sort on smallest arrays */
+    for (size_t i = 1; i < n; i++) {
+        SORT_TYPE x = a[i];
+        size_t j = i;
+        for (; j > 0 && SORT_LESS(x, a[j - 1]); j--) {
+            a[j] = a[j - 1];
+        }
+        a[j] = x;
+    }
+}
+
+#undef SORT_TYPE
+#undef SORT_SUFFIX
+#undef SORT_LESS
+#undef SORT_LINKAGE
@@ -0,0 +1,322 @@
+/*
+ * Written by Luke McCarthy <luke@iogopro.co.uk>
+ * https://github.com/ljmccarthy/sorting_algorithms
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+ * this software, either in source code form or as a compiled binary, for any
+ * purpose, commercial or non-commercial, and by any means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors of
+ * this software dedicate any and all copyright interest in the software to the
+ * public domain. We make this dedication for the benefit of the public at
+ * large and to the detriment of our heirs and successors. We intend this
+ * dedication to be an overt act of relinquishment in perpetuity of all present
+ * and future rights to this software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org/>
+ */
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sort.h"
+#include "util.h"
+
+/*
+ * Radix sorts on unsigned integer keys using 8-bit digits. The key is either
+ * read directly from the element (key_width bytes at key_offset, in native
+ * byte order) or returned by a key function, in which case only the low
+ * key_width bytes of the result are significant.
+ *
+ * LSD radix sort is stable and makes one scatter pass per digit using a
+ * scratch array of nelems * size bytes. MSD radix sort works in place (and is
+ * not stable), recursing into each bucket and finishing small buckets with
+ * insertion sort. Both skip digits that are the same for every element.
+ *
+ * They return 0, or -1 with errno set to EINVAL if the key isn't 1, 2, 4 or
+ * 8 bytes within the element (1 to 8 bytes for a key function), or to ENOMEM
+ * if the scratch memory can't be allocated, leaving the array unsorted.
+ */
+
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_MAX_DIGITS 8
+
+/* Buckets smaller than this are finished with insertion sort in MSD radix sort */
+#define MSD_INSERTION_SORT_CUTOFF 32
+
+/* radix_sort uses MSD radix sort when the key has more digits than this and the array is at least this large */
+#define MSD_MIN_KEY_WIDTH 4
+#define MSD_MIN_NELEMS 65536
+
+struct radix_key {
+    size_t offset;
+    size_t width;
+    key_fn_t fn;
+    void *context;
+    uint64_t mask;
+};
+
+static inline uint64_t read_key(const struct radix_key *key, const char *elem)
+{
+    if (key->fn) {
+        return key->fn(elem, key->context) & key->mask;
+    }
+    elem += key->offset;
+    switch (key->width) {
+        case 1: {
+            uint8_t value;
+            memcpy(&value, elem, sizeof(value));
+            return value;
+        }
+        case 2: {
+            uint16_t value;
+            memcpy(&value, elem, sizeof(value));
+            return value;
+        }
+        case 4: {
+            uint32_t value;
+            memcpy(&value, elem, sizeof(value));
+            return value;
+        }
+        default: {
+            uint64_t value;
+            memcpy(&value, elem, sizeof(value));
+            return value;
+        }
+    }
+}
+
+static inline size_t key_digit(uint64_t key, size_t digit)
+{
+    return (size_t) (key >> (digit * RADIX_BITS)) & (RADIX_BUCKETS - 1);
+}
+
+/* Returns false if the key can't be read: read_key only loads 1, 2, 4 or 8 bytes, which must be within the element */
+static bool make_key(struct radix_key *key, size_t size, size_t offset, size_t width, key_fn_t fn, void *context)
+{
+    key->offset = offset;
+    key->width = width;
+    key->fn = fn;
+    key->context = context;
+    key->mask = UINT64_MAX;
+    if (fn) {
+        if (width < 1 || width > RADIX_MAX_DIGITS) {
+            return false;
+        }
+        key->mask = width < RADIX_MAX_DIGITS ? (UINT64_C(1) << (width * RADIX_BITS)) - 1 : UINT64_MAX;
+        return true;
+    }
+    return (width == 1 || width == 2 || width == 4 || width == 8) && offset <= size && width <= size - offset;
+}
+
+static int lsd_radix_sort(char *base, size_t nelems, size_t size, const struct radix_key *key)
+{
+    size_t counts[RADIX_MAX_DIGITS][RADIX_BUCKETS];
+    size_t ndigits = key->width;
+    if (nelems < 2) {
+        return 0;
+    }
+    /* Histogram every digit in a single pass */
+    memset(counts, 0, sizeof(counts));
+    for (char *elem = base, *end = base + nelems * size; elem != end; elem += size) {
+        uint64_t k = read_key(key, elem);
+        for (size_t digit = 0; digit < ndigits; digit++) {
+            counts[digit][key_digit(k, digit)]++;
+        }
+    }
+    uint64_t first_key = read_key(key, base);
+    char *scratch = NULL;
+    char *src = base;
+    for (size_t digit = 0; digit < ndigits; digit++) {
+        size_t *count = counts[digit];
+        if (count[key_digit(first_key, digit)] == nelems) {
+            continue; /* every element has the same digit */
+        }
+        if (!scratch) {
+            scratch = malloc(nelems * size);
+            if (!scratch) {
+                return -1;
+            }
+        }
+        char *dst = src == base ? scratch : base;
+        size_t offset = 0;
+        for (size_t bucket = 0; bucket < RADIX_BUCKETS; bucket++) {
+            size_t bucket_count = count[bucket];
+            count[bucket] = offset;
+            offset += bucket_count;
+        }
+        for (char *elem = src, *end = src + nelems * size; elem != end; elem += size) {
+            size_t bucket = key_digit(read_key(key, elem), digit);
+            copy(dst + count[bucket] * size, elem, size);
+            count[bucket]++;
+        }
+        src = dst;
+    }
+    if (src != base) {
+        copy(base, src, nelems * size);
+    }
+    free(scratch);
+    return 0;
+}
+
+static void key_insertion_sort(char *base, size_t nelems, size_t size, const struct radix_key *key, char *temp)
+{
+    char *end = base + nelems * size;
+    for (char *unsorted = base + size; unsorted < end; unsorted += size) {
+        uint64_t k = read_key(key, unsorted);
+        for (char *cur = unsorted; cur != base && read_key(key, cur - size) > k; cur -= size) {
+            swap(cur - size, cur, temp, size);
+        }
+    }
+}
+
+static void msd_radix_sort_rec(char *base, size_t nelems, size_t size, const struct radix_key *key, size_t ndigits, char *temp)
+{
+    size_t heads[RADIX_BUCKETS];
+    size_t tails[RADIX_BUCKETS];
+    size_t digit;
+    while (1) {
+        if (nelems < MSD_INSERTION_SORT_CUTOFF) {
+            key_insertion_sort(base, nelems, size, key, temp);
+            return;
+        }
+        if (ndigits == 0) {
+            return;
+        }
+        digit = ndigits - 1;
+        memset(heads, 0, sizeof(heads));
+        for (char *elem = base, *end = base + nelems * size; elem != end; elem += size) {
+            heads[key_digit(read_key(key, elem), digit)]++;
+        }
+        if (heads[key_digit(read_key(key, base), digit)] != nelems) {
+            break;
+        }
+        ndigits--; /* every element has the same digit */
+    }
+    size_t offset = 0;
+    for (size_t bucket = 0; bucket < RADIX_BUCKETS; bucket++) {
+        size_t bucket_count = heads[bucket];
+        heads[bucket] = offset;
+        offset += bucket_count;
+        tails[bucket] = offset;
+    }
+    /* American flag sort: swap each element directly into the next free slot of its bucket */
+    for (size_t bucket = 0; bucket < RADIX_BUCKETS; bucket++) {
+        while (heads[bucket] < tails[bucket]) {
+            char *elem = base + heads[bucket] * size;
+            size_t elem_bucket = key_digit(read_key(key, elem), digit);
+            if (elem_bucket == bucket) {
+                heads[bucket]++;
+            } else {
+                swap(elem, base + heads[elem_bucket] * size, temp, size);
+                heads[elem_bucket]++;
+            }
+        }
+    }
+    size_t start = 0;
+    for (size_t bucket = 0; bucket < RADIX_BUCKETS; bucket++) {
+        size_t bucket_nelems = tails[bucket] - start;
+        if (bucket_nelems > 1) {
+            msd_radix_sort_rec(base + start * size, bucket_nelems, size, key, digit, temp);
+        }
+        start = tails[bucket];
+    }
+}
+
+static int msd_radix_sort(char *base, size_t nelems, size_t size, const struct radix_key *key)
+{
+    char temp_buf[1024];
+    if (nelems < 2) {
+        return 0;
+    }
+    char *temp = size > sizeof(temp_buf) ? malloc(size) : temp_buf;
+    if (!temp) {
+        return -1;
+    }
+    msd_radix_sort_rec(base, nelems, size, key, key->width, temp);
+    if (temp != temp_buf) {
+        free(temp);
+    }
+    return 0;
+}
+
+static int auto_radix_sort(char *base, size_t nelems, size_t size, const struct radix_key *key)
+{
+    if (key->width > MSD_MIN_KEY_WIDTH && nelems >= MSD_MIN_NELEMS) {
+        return msd_radix_sort(base, nelems, size, key);
+    }
+    return lsd_radix_sort(base, nelems, size, key);
+}
+
+int radix_sort(void *base, size_t nelems, size_t size, size_t key_offset, size_t key_width)
+{
+    struct radix_key key;
+    if (!make_key(&key, size, key_offset, key_width, NULL, NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+    return auto_radix_sort(base, nelems, size, &key);
+}
+
+int radix_sort_lsd(void *base, size_t nelems, size_t size, size_t key_offset, size_t key_width)
+{
+    struct radix_key key;
+    if (!make_key(&key, size, key_offset, key_width, NULL, NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+    return lsd_radix_sort(base, nelems, size, &key);
+}
+
+int radix_sort_msd(void *base, size_t nelems, size_t size, size_t key_offset, size_t key_width)
+{
+    struct radix_key key;
+    if (!make_key(&key, size, key_offset, key_width, NULL, NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+    return msd_radix_sort(base, nelems, size, &key);
+}
+
+int radix_sort_fn(void *base, size_t nelems, size_t size, key_fn_t key_fn, void *context, size_t key_width)
+{
+    struct radix_key key;
+    if (!make_key(&key, size, 0, key_width, key_fn, context)) {
+        errno = EINVAL;
+        return -1;
+    }
+    return auto_radix_sort(base, nelems, size, &key);
+}
+
+int radix_sort_lsd_fn(void *base, size_t nelems, size_t size, key_fn_t key_fn, void *context, size_t key_width)
+{
+    struct radix_key key;
+    if (!make_key(&key, size, 0, key_width, key_fn, context)) {
+        errno = EINVAL;
+        return -1;
+    }
+    return lsd_radix_sort(base, nelems, size, &key);
+}
+
+int radix_sort_msd_fn(void *base, size_t nelems, size_t size, key_fn_t key_fn, void *context, size_t key_width)
+{
+    struct radix_key key;
+    if (!make_key(&key, size, 0, key_width, key_fn, context)) {
+        errno = EINVAL;
+        return -1;
+    }
+    return msd_radix_sort(base, nelems, size, &key);
+}
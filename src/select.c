@@ -0,0 +1,349 @@
+/*
+ * Written by Luke McCarthy <luke@iogopro.co.uk>, Oct-Nov 2025
+ * https://github.com/ljmccarthy/sorting_algorithms
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+ * this software, either in source code form or as a compiled binary, for any
+ * purpose, commercial or non-commercial, and by any means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors of
+ * this software dedicate any and all copyright interest in the software to the
+ * public domain. We make this dedication for the benefit of the public at
+ * large and to the detriment of our heirs and successors. We intend this
+ * dedication to be an overt act of relinquishment in perpetuity of all present
+ * and future rights to this software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org/>
+ */
+
+/*
+ * Selection: select_nth, partial_sort and a streaming top-k heap.
+ *
+ * select_nth is an introselect. It runs quickselect with a median-of-3 or
+ * pseudomedian-of-9 pivot, like pdq_sort, and counts the elements it has
+ * partitioned. If that passes SELECT_WORK_FACTOR times the array size the
+ * input is defeating the pivot choice, and the remaining partitions use the
+ * median of medians of groups of 5 as the pivot instead, which guarantees
+ * that each partition removes at least 3/10 of the elements, so the worst
+ * case is linear. Partitioning stops on elements equal to the pivot from both
+ * sides, which splits runs of equal elements evenly.
+ *
+ * partial_sort sorts the k smallest elements to the front. For small k
+ * relative to the array it keeps a max-heap of the k smallest seen so far,
+ * which rejects most elements with one comparison against the top of the
+ * heap, then heap sorts it. Otherwise it uses select_nth and then sorts the
+ * front with pdq_sort.
+ *
+ * The top-k heap does the same heap selection over a stream of batches,
+ * keeping only k elements. The heaps use the sift from bsd_heapsort (Knuth,
+ * Vol. 3, 5.2.3 exercise 18): the hole at the top is moved down to a leaf
+ * along the larger children and the new element is sifted up from there,
+ * which saves comparisons since the new element usually belongs near the
+ * bottom.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "sort.h"
+#include "util.h"
+
+#define SELECT_INSERTION_THRESHOLD 16
+#define NINTHER_THRESHOLD 128
+#define SELECT_WORK_FACTOR 4
+/* partial_sort uses a heap when k is at most nelems / PARTIAL_SORT_HEAP_RATIO */
+#define PARTIAL_SORT_HEAP_RATIO 64
+
+struct select_params {
+    size_t size;
+    compare_fn_t compare;
+    void *context;
+    char *pivot; /* holds the pivot during partitioning, and the element being inserted in insertion sort */
+    char *temp;  /* for swaps */
+};
+
+static inline bool less(const struct select_params *p, const char *a, const char *b)
+{
+    return p->compare(a, b, p->context) < 0;
+}
+
+static inline void swap_elems(const struct select_params *p, char *a, char *b)
+{
+    swap(a, b, p->temp, p->size);
+}
+
+static void sort2(const struct select_params *p, char *a, char *b)
+{
+    if (less(p, b, a)) {
+        swap_elems(p, a, b);
+    }
+}
+
+/* Puts the median of the three elements in b */
+static void sort3(const struct select_params *p, char *a, char *b, char *c)
+{
+    sort2(p, a, b);
+    sort2(p, b, c);
+    sort2(p, a, b);
+}
+
+static void select_insertion_sort(const struct select_params *p, char *begin, size_t nelems)
+{
+    size_t size = p->size;
+    char *end = begin + nelems * size;
+    for (char *cur = begin + size; cur < end; cur += size) {
+        char *sift = cur;
+        if (less(p, sift, sift - size)) {
+            copy(p->pivot, sift, size);
+            do {
+                copy(sift, sift - size, size);
+                sift -= size;
+            } while (sift != begin && less(p, p->pivot, sift - size));
+            copy(sift, p->pivot, size);
+        }
+    }
+}
+
+/*
+ * Partition around the pivot at begin, stopping on elements equal to the
+ * pivot from both sides. Returns the final index of the pivot, with no
+ * greater elements before it and no smaller elements after it.
+ */
+static size_t partition(const struct select_params *p, char *begin, size_t nelems)
+{
+    size_t size = p->size;
+    size_t i = 0;
+    size_t j = nelems;
+    copy(p->pivot, begin, size);
+    while (1) {
+        do { i++; } while (i < nelems && less(p, begin + i * size, p->pivot));
+        do { j--; } while (less(p, p->pivot, begin + j * size));
+        if (i >= j) {
+            break;
+        }
+        swap_elems(p, begin + i * size, begin + j * size);
+    }
+    swap_elems(p, begin, begin + j * size);
+    return j;
+}
+
+/* Moves the median of 3 or pseudomedian of 9 to begin */
+static void choose_pivot(const struct select_params *p, char *begin, size_t nelems)
+{
+    size_t size = p->size;
+    char *middle = begin + nelems / 2 * size;
+    char *back = begin + (nelems - 1) * size;
+    if (nelems > NINTHER_THRESHOLD) {
+        sort3(p, begin, middle, back);
+        sort3(p, begin + size, middle - size, back - size);
+        sort3(p, begin + 2 * size, middle + size, back - 2 * size);
+        sort3(p, middle - size, middle, middle + size);
+    } else {
+        sort3(p, begin, middle, back);
+    }
+    swap_elems(p, begin, middle);
+}
+
+static void select_rec(const struct select_params *p, char *begin, size_t nelems, size_t nth);
+
+/* Moves the median of the medians of groups of 5 to begin */
+static void median_of_medians_pivot(const struct select_params *p, char *begin, size_t nelems)
+{
+    size_t size = p->size;
+    size_t ngroups = nelems / 5;
+    /* Group i's median goes to index i, which is in a group that has already been done */
+    for (size_t i = 0; i < ngroups; i++) {
+        char *group = begin + i * 5 * size;
+        select_insertion_sort(p, group, 5);
+        swap_elems(p, begin + i * size, group + 2 * size);
+    }
+    select_rec(p, begin, ngroups, ngroups / 2);
+    swap_elems(p, begin, begin + ngroups / 2 * size);
+}
+
+static void select_rec(const struct select_params *p, char *begin, size_t nelems, size_t nth)
+{
+    size_t size = p->size;
+    size_t budget = nelems * SELECT_WORK_FACTOR;
+    while (nelems > SELECT_INSERTION_THRESHOLD) {
+        if (budget >= nelems) {
+            budget -= nelems;
+            choose_pivot(p, begin, nelems);
+        } else {
+            median_of_medians_pivot(p, begin, nelems);
+        }
+        size_t pivot = partition(p, begin, nelems);
+        if (nth == pivot) {
+            return;
+        } else if (nth < pivot) {
+            nelems = pivot;
+        } else {
+            begin += (pivot + 1) * size;
+            nth -= pivot + 1;
+            nelems -= pivot + 1;
+        }
+    }
+    select_insertion_sort(p, begin, nelems);
+}
+
+void select_nth(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, size_t nth)
+{
+    char temp_buf[1024];
+    if (nth >= nelems || nelems < 2) {
+        return;
+    }
+    char *temp = size * 2 > sizeof(temp_buf) ? malloc(size * 2) : temp_buf;
+    struct select_params params = {size, compare, context, temp, temp + size};
+    select_rec(&params, base, nelems, nth);
+    if (temp != temp_buf) {
+        free(temp);
+    }
+}
+
+/*
+ * Replaces the element at root of the max-heap of nelems elements with elem,
+ * which must not be in the heap, and restores the heap property below root.
+ */
+static void heap_sift(char *heap, size_t nelems, size_t size, size_t root, const char *elem, compare_fn_t compare, void *context)
+{
+    size_t hole = root;
+    size_t child;
+    while ((child = 2 * hole + 1) < nelems) {
+        if (child + 1 < nelems && compare(heap + child * size, heap + (child + 1) * size, context) < 0) {
+            child++;
+        }
+        copy(heap + hole * size, heap + child * size, size);
+        hole = child;
+    }
+    while (hole > root) {
+        size_t parent = (hole - 1) / 2;
+        if (compare(elem, heap + parent * size, context) <= 0) {
+            break;
+        }
+        copy(heap + hole * size, heap + parent * size, size);
+        hole = parent;
+    }
+    copy(heap + hole * size, elem, size);
+}
+
+static void heapify(char *heap, size_t nelems, size_t size, compare_fn_t compare, void *context, char *temp)
+{
+    for (size_t i = nelems / 2; i-- > 0;) {
+        copy(temp, heap + i * size, size);
+        heap_sift(heap, nelems, size, i, temp, compare, context);
+    }
+}
+
+/* Sorts a max-heap into ascending order */
+static void heap_sort_heap(char *heap, size_t nelems, size_t size, compare_fn_t compare, void *context, char *temp)
+{
+    for (size_t end = nelems; end-- > 1;) {
+        copy(temp, heap + end * size, size);
+        copy(heap + end * size, heap, size);
+        heap_sift(heap, end, size, 0, temp, compare, context);
+    }
+}
+
+void partial_sort(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, size_t k)
+{
+    if (k >= nelems) {
+        pdq_sort(base, nelems, size, compare, context);
+    } else if (k > nelems / PARTIAL_SORT_HEAP_RATIO) {
+        select_nth(base, nelems, size, compare, context, k - 1);
+        pdq_sort(base, k - 1, size, compare, context);
+    } else if (k > 0) {
+        char temp_buf[1024];
+        char *temp = size * 2 > sizeof(temp_buf) ? malloc(size * 2) : temp_buf;
+        char *heap = base;
+        heapify(heap, k, size, compare, context, temp);
+        for (char *elem = heap + k * size, *end = heap + nelems * size; elem != end; elem += size) {
+            if (compare(elem, heap, context) < 0) {
+                /* Swap the new element with the top of the heap */
+                copy(temp, elem, size);
+                copy(elem, heap, size);
+                heap_sift(heap, k, size, 0, temp, compare, context);
+            }
+        }
+        heap_sort_heap(heap, k, size, compare, context, temp);
+        if (temp != temp_buf) {
+            free(temp);
+        }
+    }
+}
+
+struct top_k {
+    size_t k;
+    size_t nelems;
+    size_t size;
+    compare_fn_t compare;
+    void *context;
+    char *temp;
+    char *heap; /* max-heap of the k smallest elements once full, in insertion order before that */
+};
+
+struct top_k *top_k_create(size_t k, size_t size, compare_fn_t compare, void *context)
+{
+    struct top_k *top = malloc(sizeof(struct top_k) + (k + 1) * size);
+    if (!top) {
+        return NULL;
+    }
+    top->k = k;
+    top->nelems = 0;
+    top->size = size;
+    top->compare = compare;
+    top->context = context;
+    top->temp = (char *) (top + 1);
+    top->heap = top->temp + size;
+    return top;
+}
+
+void top_k_destroy(struct top_k *top)
+{
+    free(top);
+}
+
+void top_k_push(struct top_k *top, const void *elems, size_t nelems)
+{
+    size_t size = top->size;
+    const char *elem = elems;
+    const char *end = elem + nelems * size;
+    if (top->k == 0) {
+        return;
+    }
+    if (top->nelems < top->k) {
+        size_t n = top->k - top->nelems < nelems ? top->k - top->nelems : nelems;
+        if (n) {
+            copy(top->heap + top->nelems * size, elem, n * size);
+        }
+        top->nelems += n;
+        elem += n * size;
+        if (top->nelems < top->k) {
+            return;
+        }
+        heapify(top->heap, top->k, size, top->compare, top->context, top->temp);
+    }
+    for (; elem != end; elem += size) {
+        if (top->compare(elem, top->heap, top->context) < 0) {
+            heap_sift(top->heap, top->k, size, 0, elem, top->compare, top->context);
+        }
+    }
+}
+
+size_t top_k_result(const struct top_k *top, void *out)
+{
+    if (top->nelems) {
+        copy(out, top->heap, top->nelems * top->size);
+        heapify(out, top->nelems, top->size, top->compare, top->context, top->temp);
+        heap_sort_heap(out, top->nelems, top->size, top->compare, top->context, top->temp);
+    }
+    return top->nelems;
+}
@@ -27,22 +27,180 @@
 
 #pragma once
 #include <stddef.h>
+#include <stdint.h>
+#include "sort_workspace.h"
 
 typedef int (*compare_fn_t)(const void *, const void *, void *);
+typedef uint64_t (*key_fn_t)(const void *, void *);
 
 /* Our implementations */
 void insertion_sort(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context);
 void insertion_sort_v2(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context);
 void merge_sort(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context);
+void merge_sort_bottom_up(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context);
+void merge_sort_parallel(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, unsigned nthreads);
 void merge_sort_ptr(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context);
 void merge_sort_indexed(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context);
+/*
+ * merge_sort_indexed on cached (key prefix, index) pairs. prefix_fn returns a prefix of each element's key
+ * in its low prefix_width bytes (4 or 8), normalized so that prefixes compare as unsigned integers in the
+ * same order as compare, and is passed the same context. compare is only called when two prefixes are equal.
+ */
+void merge_sort_indexed_prefix(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context,
+                               key_fn_t prefix_fn, size_t prefix_width);
+/*
+ * Stable in-place block merge sort (see block_merge_sort.c), which needs no scratch memory beyond a 4096 byte
+ * buffer on the stack. block_merge_sort_buffer also uses buffer_size bytes of buffer as scratch space, which makes
+ * it faster: enough for sqrt(nelems) elements gets most of the benefit. Elements bigger than both buffers need one
+ * temporary element from malloc, and the array is left unsorted if that fails.
+ */
+void block_merge_sort(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context);
+void block_merge_sort_buffer(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context,
+                             void *buffer, size_t buffer_size);
 void selection_sort(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context);
 void minmax_selection_sort(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context);
+void pdq_sort(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context);
+void pdq_sort_branchless(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context);
+
+/*
+ * Sorting permutations. argsort returns an array of nelems indices, allocated with malloc, such that element
+ * perm[i] of base is the i-th in sorted order, leaving base unchanged (NULL if out of memory). The indices are
+ * as narrow as nelems allows: sort_index_width(nelems) bytes, 2, 4 or 8, which is also stored in *index_width.
+ * argsort is a stable merge sort, argsort_unstable is pdq_sort and needs no scratch memory.
+ */
+size_t sort_index_width(size_t nelems);
+void *argsort(const void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, size_t *index_width);
+void *argsort_unstable(const void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, size_t *index_width);
+
+/*
+ * Selection (see select.c). select_nth moves the element that would be at index nth in sorted order there,
+ * with no greater elements before it and no smaller elements after it. partial_sort sorts the k smallest
+ * elements into the first k places, leaving the rest in unspecified order. Neither is stable.
+ *
+ * A top_k keeps the k smallest elements of a stream that is pushed to it in batches of any size, using
+ * memory for k elements. top_k_result writes the elements kept so far to out in sorted order and returns
+ * how many there are (fewer than k if fewer have been pushed). top_k_create returns NULL if out of memory.
+ */
+void select_nth(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, size_t nth);
+void partial_sort(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, size_t k);
+struct top_k;
+struct top_k *top_k_create(size_t k, size_t size, compare_fn_t compare, void *context);
+void top_k_destroy(struct top_k *top);
+void top_k_push(struct top_k *top, const void *elems, size_t nelems);
+size_t top_k_result(const struct top_k *top, void *out);
+
+/*
+ * sort_auto samples the input and sorts it with whichever of the sorts here suits it (see sort_auto.c),
+ * returning the path it took. The sort is stable unless flags includes SORT_AUTO_UNSTABLE. By default it may
+ * use scratch memory for a copy of the array, SORT_AUTO_LOW_MEMORY limits that to sqrt(nelems) elements and
+ * SORT_AUTO_IN_PLACE to none. sort_auto_path_name returns the name of a path, e.g. "timsort".
+ */
+enum sort_auto_flags {
+    SORT_AUTO_UNSTABLE = 1 << 0,
+    SORT_AUTO_LOW_MEMORY = 1 << 1,
+    SORT_AUTO_IN_PLACE = 1 << 2,
+};
+enum sort_auto_path {
+    SORT_AUTO_SORTED,
+    SORT_AUTO_REVERSED,
+    SORT_AUTO_INSERTION_SORT,
+    SORT_AUTO_TIMSORT,
+    SORT_AUTO_MERGE_SORT,
+    SORT_AUTO_MERGE_SORT_PTR,
+    SORT_AUTO_BLOCK_MERGE_SORT,
+    SORT_AUTO_PDQ_SORT,
+};
+enum sort_auto_path sort_auto(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, unsigned flags);
+const char *sort_auto_path_name(enum sort_auto_path path);
+
+/*
+ * Key/value sorts on separate arrays (see kv_sort.c): sorts the nelems keys of key_size bytes and moves the
+ * values of value_size bytes, value i belonging to key i, into the same order. Only the keys are compared.
+ * kv_sort_lockstep moves the values along with the keys on every merge pass, kv_sort_gather sorts indices
+ * along with the keys and moves the values into place once at the end, and kv_sort picks lockstep for narrow values
+ * and gather for wide ones. All are stable.
+ */
+void kv_sort(void *keys, size_t nelems, size_t key_size, compare_fn_t compare, void *context, void *values, size_t value_size);
+void kv_sort_lockstep(void *keys, size_t nelems, size_t key_size, compare_fn_t compare, void *context, void *values, size_t value_size);
+void kv_sort_gather(void *keys, size_t nelems, size_t key_size, compare_fn_t compare, void *context, void *values, size_t value_size);
+
+/*
+ * Merges a batch of unsorted elements into a sorted array (see merge_batch.c). base holds nelems sorted elements
+ * and has room for batch_nelems more after them. The batch, which must not overlap base, is sorted in place and
+ * merged in from the tail backwards, so base + nelems + batch_nelems is sorted afterwards. The merge is stable,
+ * with elements of the batch going after equal elements already in base.
+ */
+void merge_batch(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, void *batch, size_t batch_nelems);
+void merge_batch_ws(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, void *batch, size_t batch_nelems,
+                    struct sort_workspace *ws);
+
+/* Variants of the indirect sorts that leave base unchanged and write the sorted elements to out (which must not overlap it) */
+void merge_sort_ptr_out(const void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, void *out);
+void merge_sort_indexed_out(const void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, void *out);
+
+/*
+ * Variants that take their scratch memory from a reusable workspace instead of allocating it. If the workspace
+ * can't grow to the size needed they fall back to allocating it like the plain variants.
+ */
+void merge_sort_ws(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, struct sort_workspace *ws);
+void merge_sort_ptr_ws(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, struct sort_workspace *ws);
+void merge_sort_indexed_ws(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, struct sort_workspace *ws);
+void merge_sort_indexed_prefix_ws(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context,
+                                  key_fn_t prefix_fn, size_t prefix_width, struct sort_workspace *ws);
+
+/*
+ * Stable k-way merges of sorted runs with a loser tree (see merge_k.c). merge_k merges k arrays of lens[i]
+ * elements into out. merge_k_stream pulls the next element of run i from pull, which returns NULL at the end
+ * of the run and whose result must stay valid until the next pull from the same run, and pushes each element
+ * in merged order to push.
+ */
+typedef const void *(*merge_pull_fn_t)(size_t run, void *pull_context);
+typedef void (*merge_push_fn_t)(const void *elem, void *push_context);
+void merge_k(const void *const runs[], const size_t lens[], size_t k, size_t size, compare_fn_t compare, void *context, void *out);
+void merge_k_stream(size_t k, merge_pull_fn_t pull, void *pull_context, merge_push_fn_t push, void *push_context,
+                    compare_fn_t compare, void *context);
+
+/*
+ * Radix sorts on an unsigned integer key, either key_width bytes at key_offset or the low key_width bytes returned by key_fn.
+ * They return -1 with errno set to EINVAL if key_width isn't 1, 2, 4 or 8 with the key inside the element (1 to 8 with
+ * key_fn), or to ENOMEM if scratch memory can't be allocated, leaving the array unsorted, and 0 otherwise.
+ */
+int radix_sort(void *base, size_t nelems, size_t size, size_t key_offset, size_t key_width);
+int radix_sort_lsd(void *base, size_t nelems, size_t size, size_t key_offset, size_t key_width);
+int radix_sort_msd(void *base, size_t nelems, size_t size, size_t key_offset, size_t key_width);
+int radix_sort_fn(void *base, size_t nelems, size_t size, key_fn_t key_fn, void *context, size_t key_width);
+int radix_sort_lsd_fn(void *base, size_t nelems, size_t size, key_fn_t key_fn, void *context, size_t key_width);
+int radix_sort_msd_fn(void *base, size_t nelems, size_t size, key_fn_t key_fn, void *context, size_t key_width);
+
+/*
+ * String sorts (see string_sort.c), ordering strings by their bytes as unsigned char like strcmp, without
+ * rescanning common prefixes on every comparison. multikey_quicksort and string_radix_sort (MSD radix sort
+ * finishing small buckets with an LCP merge sort) sort an array of pointers to NUL-terminated strings.
+ * string_ref_sort sorts strings given by pointer and length, which may contain NUL bytes, comparing cached
+ * 8-byte prefixes. None of them are stable.
+ */
+struct string_ref {
+    const char *data;
+    size_t len;
+};
+void multikey_quicksort(const char **strings, size_t nelems);
+void string_radix_sort(const char **strings, size_t nelems);
+void string_ref_sort(struct string_ref *strings, size_t nelems);
+
+/* Specialized for a fixed element type with the comparison inlined (see merge_sort_impl.h and quicksort_impl.h) */
+void merge_sort_u32(uint32_t *base, size_t nelems);
+void merge_sort_u64(uint64_t *base, size_t nelems);
+void merge_sort_f64(double *base, size_t nelems);
+void quicksort_u32(uint32_t *base, size_t nelems);
+void quicksort_u64(uint64_t *base, size_t nelems);
+void quicksort_f64(double *base, size_t nelems);
 
 /* Third-party sorting algorithms */
 void bentley_mcilroy_quicksort(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context);
 void ochs_smoothsort(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context);
 int bsd_heapsort(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context);
 int bsd_mergesort(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context);
+int bsd_heapsort_ws(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, struct sort_workspace *ws);
+int bsd_mergesort_ws(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, struct sort_workspace *ws);
 
 #include "../third_party/timsort/timsort.h"
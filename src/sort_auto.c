@@ -0,0 +1,208 @@
+/*
+ * Written by Luke McCarthy <luke@iogopro.co.uk>, Oct-Nov 2025
+ * https://github.com/ljmccarthy/sorting_algorithms
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+ * this software, either in source code form or as a compiled binary, for any
+ * purpose, commercial or non-commercial, and by any means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors of
+ * this software dedicate any and all copyright interest in the software to the
+ * public domain. We make this dedication for the benefit of the public at
+ * large and to the detriment of our heirs and successors. We intend this
+ * dedication to be an overt act of relinquishment in perpetuity of all present
+ * and future rights to this software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org/>
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "sort.h"
+#include "util.h"
+
+/*
+ * sort_auto picks one of the sorts in this repository for the input it is
+ * given. Small arrays are insertion sorted. Otherwise it checks for an array
+ * that is already sorted or strictly descending (scanning the prefix, which
+ * stops at the first out-of-order pair on most inputs), then samples triples
+ * of adjacent elements spread over the array to see if it is made of runs,
+ * and sorts a sample of elements to estimate how many duplicates there are:
+ *
+ * - Runs: timsort, which finds and merges them in O(n log r) for r runs, or
+ *   block merge sort (stable) or pdq_sort (unstable) if memory is limited.
+ * - Unstable: pdq_sort, which handles duplicates with its equal partitions.
+ * - Stable with many duplicates: timsort, whose galloping merges skip over
+ *   runs of equal elements.
+ * - Stable otherwise: merge_sort, or merge_sort_ptr for elements so large
+ *   that moving pointers and placing the elements once is cheaper.
+ *
+ * With SORT_AUTO_LOW_MEMORY the stable sorts are replaced by block merge
+ * sort with a buffer of sqrt(nelems) elements, and with SORT_AUTO_IN_PLACE
+ * by block merge sort with no allocated buffer.
+ */
+
+#define SORT_AUTO_INSERTION_SORT_MAX 16
+#define SORT_AUTO_RUN_SAMPLES 32
+#define SORT_AUTO_DUPLICATE_SAMPLES 32
+#define SORT_AUTO_INDIRECT_MIN_SIZE 256
+
+static const char *const sort_auto_path_names[] = {
+    [SORT_AUTO_SORTED] = "sorted",
+    [SORT_AUTO_REVERSED] = "reversed",
+    [SORT_AUTO_INSERTION_SORT] = "insertion_sort",
+    [SORT_AUTO_TIMSORT] = "timsort",
+    [SORT_AUTO_MERGE_SORT] = "merge_sort",
+    [SORT_AUTO_MERGE_SORT_PTR] = "merge_sort_ptr",
+    [SORT_AUTO_BLOCK_MERGE_SORT] = "block_merge_sort",
+    [SORT_AUTO_PDQ_SORT] = "pdq_sort",
+};
+
+const char *sort_auto_path_name(enum sort_auto_path path)
+{
+    return sort_auto_path_names[path];
+}
+
+/* Returns the length of the ascending (or strictly descending) run at the start of the array */
+static size_t prefix_run_length(const char *base, size_t nelems, size_t size, compare_fn_t compare, void *context, bool descending)
+{
+    size_t i = 1;
+    if (descending) {
+        while (i < nelems && compare(base + (i - 1) * size, base + i * size, context) > 0) {
+            i++;
+        }
+    } else {
+        while (i < nelems && compare(base + (i - 1) * size, base + i * size, context) <= 0) {
+            i++;
+        }
+    }
+    return i;
+}
+
+static void reverse(char *base, size_t nelems, size_t size)
+{
+    char temp_buf[1024];
+    char *temp = size > sizeof(temp_buf) ? malloc(size) : temp_buf;
+    char *lo = base;
+    char *hi = base + (nelems - 1) * size;
+    while (lo < hi) {
+        swap(lo, hi, temp, size);
+        lo += size;
+        hi -= size;
+    }
+    if (temp != temp_buf) {
+        free(temp);
+    }
+}
+
+/*
+ * Samples triples of adjacent elements spread over the array. A triple is in order (ascending or descending)
+ * with probability 1/3 in random data and almost always inside runs, so the input is taken to be made of runs
+ * if at least 5/8 of the triples are in order (over three standard deviations above the mean for random data).
+ */
+static bool has_runs(const char *base, size_t nelems, size_t size, compare_fn_t compare, void *context)
+{
+    size_t in_order = 0;
+    for (size_t i = 0; i < SORT_AUTO_RUN_SAMPLES; i++) {
+        const char *a = base + i * (nelems - 3) / (SORT_AUTO_RUN_SAMPLES - 1) * size;
+        int ab = compare(a, a + size, context);
+        int bc = compare(a + size, a + 2 * size, context);
+        in_order += (ab <= 0 && bc <= 0) || (ab >= 0 && bc >= 0);
+    }
+    return in_order * 8 >= SORT_AUTO_RUN_SAMPLES * 5;
+}
+
+/*
+ * Insertion sorts pointers to a sample of elements spread over the array and counts the equal neighbours.
+ * Duplicates are taken to be dense if at least a quarter of the sample equals its neighbour.
+ */
+static bool has_many_duplicates(const char *base, size_t nelems, size_t size, compare_fn_t compare, void *context)
+{
+    const char *sample[SORT_AUTO_DUPLICATE_SAMPLES];
+    for (size_t i = 0; i < SORT_AUTO_DUPLICATE_SAMPLES; i++) {
+        const char *elem = base + i * (nelems - 1) / (SORT_AUTO_DUPLICATE_SAMPLES - 1) * size;
+        size_t j = i;
+        for (; j > 0 && compare(sample[j - 1], elem, context) > 0; j--) {
+            sample[j] = sample[j - 1];
+        }
+        sample[j] = elem;
+    }
+    size_t equal = 0;
+    for (size_t i = 1; i < SORT_AUTO_DUPLICATE_SAMPLES; i++) {
+        equal += compare(sample[i - 1], sample[i], context) == 0;
+    }
+    return equal * 4 >= SORT_AUTO_DUPLICATE_SAMPLES;
+}
+
+static enum sort_auto_path stable_sort_in_memory_limit(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, unsigned flags)
+{
+    if (flags & SORT_AUTO_IN_PLACE) {
+        block_merge_sort(base, nelems, size, compare, context);
+    } else {
+        size_t buffer_size = (isqrt(nelems) + 1) * size;
+        void *buffer = malloc(buffer_size);
+        block_merge_sort_buffer(base, nelems, size, compare, context, buffer, buffer ? buffer_size : 0);
+        free(buffer);
+    }
+    return SORT_AUTO_BLOCK_MERGE_SORT;
+}
+
+enum sort_auto_path sort_auto(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, unsigned flags)
+{
+    const bool stable = !(flags & SORT_AUTO_UNSTABLE);
+    const bool memory_limited = flags & (SORT_AUTO_LOW_MEMORY | SORT_AUTO_IN_PLACE);
+    if (nelems < 2) {
+        return SORT_AUTO_SORTED;
+    }
+    if (nelems <= SORT_AUTO_INSERTION_SORT_MAX) {
+        insertion_sort(base, nelems, size, compare, context);
+        return SORT_AUTO_INSERTION_SORT;
+    }
+    if (compare(base, (char *) base + size, context) <= 0) {
+        if (prefix_run_length(base, nelems, size, compare, context, false) == nelems) {
+            return SORT_AUTO_SORTED;
+        }
+    } else if (prefix_run_length(base, nelems, size, compare, context, true) == nelems) {
+        /* Reversing a strictly descending array is stable */
+        reverse(base, nelems, size);
+        return SORT_AUTO_REVERSED;
+    }
+    if (has_runs(base, nelems, size, compare, context)) {
+        if (!memory_limited) {
+            timsort_r(base, nelems, size, compare, context);
+            return SORT_AUTO_TIMSORT;
+        }
+        if (stable) {
+            return stable_sort_in_memory_limit(base, nelems, size, compare, context, flags);
+        }
+        pdq_sort(base, nelems, size, compare, context);
+        return SORT_AUTO_PDQ_SORT;
+    }
+    if (!stable) {
+        pdq_sort(base, nelems, size, compare, context);
+        return SORT_AUTO_PDQ_SORT;
+    }
+    if (memory_limited) {
+        return stable_sort_in_memory_limit(base, nelems, size, compare, context, flags);
+    }
+    if (has_many_duplicates(base, nelems, size, compare, context)) {
+        timsort_r(base, nelems, size, compare, context);
+        return SORT_AUTO_TIMSORT;
+    }
+    if (size >= SORT_AUTO_INDIRECT_MIN_SIZE) {
+        merge_sort_ptr(base, nelems, size, compare, context);
+        return SORT_AUTO_MERGE_SORT_PTR;
+    }
+    merge_sort(base, nelems, size, compare, context);
+    return SORT_AUTO_MERGE_SORT;
+}
@@ -0,0 +1,351 @@
+/*
+ * Written by Luke McCarthy <luke@iogopro.co.uk>
+ * https://github.com/ljmccarthy/sorting_algorithms
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+ * this software, either in source code form or as a compiled binary, for any
+ * purpose, commercial or non-commercial, and by any means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors of
+ * this software dedicate any and all copyright interest in the software to the
+ * public domain. We make this dedication for the benefit of the public at
+ * large and to the detriment of our heirs and successors. We intend this
+ * dedication to be an overt act of relinquishment in perpetuity of all present
+ * and future rights to this software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org/>
+ */
+
+/*
+ * All the networks work the same way on a block held in R registers of L
+ * lanes, with R == L:
+ *
+ * 1. Sort each lane "column" across the registers with an optimal network
+ *    of vertical min/max operations.
+ * 2. Transpose, so each register holds a sorted run of L elements.
+ * 3. Bitonic merge pairs of runs until the whole block is sorted: reverse
+ *    the second run so the pair forms a bitonic sequence, then apply
+ *    half-cleaners at distances of w, w/2, ..., 1 registers, and finally at
+ *    distances of L/2, ..., 1 lanes within each register.
+ *
+ * Partial blocks are padded with the maximum value, which sorts to the end.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "sort_network.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_SORT_NETWORK 1
+#include <immintrin.h>
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#ifdef HAVE_X86_SORT_NETWORK
+
+/* Optimal sorting networks for 4 and 8 inputs */
+static const unsigned char network4[][2] = {
+    {0, 1}, {2, 3}, {0, 2}, {1, 3}, {1, 2},
+};
+static const unsigned char network8[][2] = {
+    {0, 2}, {1, 3}, {4, 6}, {5, 7}, {0, 4}, {1, 5}, {2, 6}, {3, 7}, {0, 1}, {2, 3},
+    {4, 5}, {6, 7}, {2, 4}, {3, 5}, {1, 4}, {3, 6}, {1, 2}, {3, 4}, {5, 6},
+};
+
+/* uint32_t x 4 lanes, SSE4.1 */
+
+TARGET_SSE41 static inline void cmpswap_sse41_u32(__m128i *a, __m128i *b)
+{
+    __m128i lo = _mm_min_epu32(*a, *b);
+    *b = _mm_max_epu32(*a, *b);
+    *a = lo;
+}
+
+TARGET_SSE41 static inline __m128i reverse_sse41_u32(__m128i v)
+{
+    return _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+TARGET_SSE41 static inline __m128i clean_sse41_u32(__m128i v)
+{
+    __m128i p = _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+    v = _mm_blend_epi16(_mm_min_epu32(v, p), _mm_max_epu32(v, p), 0xF0);
+    p = _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm_blend_epi16(_mm_min_epu32(v, p), _mm_max_epu32(v, p), 0xCC);
+}
+
+TARGET_SSE41 static inline void transpose_sse41_u32(__m128i *r)
+{
+    __m128i t0 = _mm_unpacklo_epi32(r[0], r[1]);
+    __m128i t1 = _mm_unpacklo_epi32(r[2], r[3]);
+    __m128i t2 = _mm_unpackhi_epi32(r[0], r[1]);
+    __m128i t3 = _mm_unpackhi_epi32(r[2], r[3]);
+    r[0] = _mm_unpacklo_epi64(t0, t1);
+    r[1] = _mm_unpackhi_epi64(t0, t1);
+    r[2] = _mm_unpacklo_epi64(t2, t3);
+    r[3] = _mm_unpackhi_epi64(t2, t3);
+}
+
+TARGET_SSE41 static void sort16_sse41_u32(uint32_t *block)
+{
+    enum { NREGS = 4, NLANES = 4 };
+    __m128i r[NREGS];
+    for (size_t i = 0; i < NREGS; i++) {
+        r[i] = _mm_loadu_si128((const __m128i *) (block + i * NLANES));
+    }
+    for (size_t i = 0; i < sizeof(network4) / sizeof(network4[0]); i++) {
+        cmpswap_sse41_u32(&r[network4[i][0]], &r[network4[i][1]]);
+    }
+    transpose_sse41_u32(r);
+    for (size_t w = 1; w < NREGS; w *= 2) {
+        for (size_t base = 0; base < NREGS; base += 2 * w) {
+            for (size_t i = 0; i < w / 2; i++) {
+                __m128i t = r[base + w + i];
+                r[base + w + i] = r[base + 2 * w - 1 - i];
+                r[base + 2 * w - 1 - i] = t;
+            }
+            for (size_t i = base + w; i < base + 2 * w; i++) {
+                r[i] = reverse_sse41_u32(r[i]);
+            }
+            for (size_t d = w; d >= 1; d /= 2) {
+                for (size_t i = base; i < base + 2 * w; i++) {
+                    if (((i - base) & d) == 0) {
+                        cmpswap_sse41_u32(&r[i], &r[i + d]);
+                    }
+                }
+            }
+            for (size_t i = base; i < base + 2 * w; i++) {
+                r[i] = clean_sse41_u32(r[i]);
+            }
+        }
+    }
+    for (size_t i = 0; i < NREGS; i++) {
+        _mm_storeu_si128((__m128i *) (block + i * NLANES), r[i]);
+    }
+}
+
+/* uint32_t x 8 lanes, AVX2 */
+
+TARGET_AVX2 static inline void cmpswap_avx2_u32(__m256i *a, __m256i *b)
+{
+    __m256i lo = _mm256_min_epu32(*a, *b);
+    *b = _mm256_max_epu32(*a, *b);
+    *a = lo;
+}
+
+TARGET_AVX2 static inline __m256i reverse_avx2_u32(__m256i v)
+{
+    return _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+}
+
+TARGET_AVX2 static inline __m256i clean_avx2_u32(__m256i v)
+{
+    __m256i p = _mm256_permute2x128_si256(v, v, 0x01);
+    v = _mm256_blend_epi32(_mm256_min_epu32(v, p), _mm256_max_epu32(v, p), 0xF0);
+    p = _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+    v = _mm256_blend_epi32(_mm256_min_epu32(v, p), _mm256_max_epu32(v, p), 0xCC);
+    p = _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm256_blend_epi32(_mm256_min_epu32(v, p), _mm256_max_epu32(v, p), 0xAA);
+}
+
+TARGET_AVX2 static inline void transpose_avx2_u32(__m256i *r)
+{
+    __m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+    __m256i t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+    __m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+    __m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+    __m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+    __m256i t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+    __m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+    __m256i t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+    __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+    __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+    __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+    __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+    __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+    __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+    __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+    __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+    r[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+    r[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+    r[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+    r[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+    r[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+    r[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+    r[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+    r[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+TARGET_AVX2 static void sort64_avx2_u32(uint32_t *block)
+{
+    enum { NREGS = 8, NLANES = 8 };
+    __m256i r[NREGS];
+    for (size_t i = 0; i < NREGS; i++) {
+        r[i] = _mm256_loadu_si256((const __m256i *) (block + i * NLANES));
+    }
+    for (size_t i = 0; i < sizeof(network8) / sizeof(network8[0]); i++) {
+        cmpswap_avx2_u32(&r[network8[i][0]], &r[network8[i][1]]);
+    }
+    transpose_avx2_u32(r);
+    for (size_t w = 1; w < NREGS; w *= 2) {
+        for (size_t base = 0; base < NREGS; base += 2 * w) {
+            for (size_t i = 0; i < w / 2; i++) {
+                __m256i t = r[base + w + i];
+                r[base + w + i] = r[base + 2 * w - 1 - i];
+                r[base + 2 * w - 1 - i] = t;
+            }
+            for (size_t i = base + w; i < base + 2 * w; i++) {
+                r[i] = reverse_avx2_u32(r[i]);
+            }
+            for (size_t d = w; d >= 1; d /= 2) {
+                for (size_t i = base; i < base + 2 * w; i++) {
+                    if (((i - base) & d) == 0) {
+                        cmpswap_avx2_u32(&r[i], &r[i + d]);
+                    }
+                }
+            }
+            for (size_t i = base; i < base + 2 * w; i++) {
+                r[i] = clean_avx2_u32(r[i]);
+            }
+        }
+    }
+    for (size_t i = 0; i < NREGS; i++) {
+        _mm256_storeu_si256((__m256i *) (block + i * NLANES), r[i]);
+    }
+}
+
+/* uint64_t x 4 lanes, AVX2 (which only has a signed 64-bit compare) */
+
+TARGET_AVX2 static inline void cmpswap_avx2_u64(__m256i *a, __m256i *b)
+{
+    const __m256i sign = _mm256_set1_epi64x(INT64_MIN);
+    __m256i a_gt_b = _mm256_cmpgt_epi64(_mm256_xor_si256(*a, sign), _mm256_xor_si256(*b, sign));
+    __m256i lo = _mm256_blendv_epi8(*a, *b, a_gt_b);
+    *b = _mm256_blendv_epi8(*b, *a, a_gt_b);
+    *a = lo;
+}
+
+TARGET_AVX2 static inline __m256i reverse_avx2_u64(__m256i v)
+{
+    return _mm256_permute4x64_epi64(v, _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+TARGET_AVX2 static inline __m256i clean_avx2_u64(__m256i v)
+{
+    __m256i p = _mm256_permute4x64_epi64(v, _MM_SHUFFLE(1, 0, 3, 2));
+    __m256i lo = v, hi = p;
+    cmpswap_avx2_u64(&lo, &hi);
+    v = _mm256_blend_epi32(lo, hi, 0xF0);
+    p = _mm256_permute4x64_epi64(v, _MM_SHUFFLE(2, 3, 0, 1));
+    lo = v;
+    hi = p;
+    cmpswap_avx2_u64(&lo, &hi);
+    return _mm256_blend_epi32(lo, hi, 0xCC);
+}
+
+TARGET_AVX2 static inline void transpose_avx2_u64(__m256i *r)
+{
+    __m256i t0 = _mm256_unpacklo_epi64(r[0], r[1]);
+    __m256i t1 = _mm256_unpackhi_epi64(r[0], r[1]);
+    __m256i t2 = _mm256_unpacklo_epi64(r[2], r[3]);
+    __m256i t3 = _mm256_unpackhi_epi64(r[2], r[3]);
+    r[0] = _mm256_permute2x128_si256(t0, t2, 0x20);
+    r[1] = _mm256_permute2x128_si256(t1, t3, 0x20);
+    r[2] = _mm256_permute2x128_si256(t0, t2, 0x31);
+    r[3] = _mm256_permute2x128_si256(t1, t3, 0x31);
+}
+
+TARGET_AVX2 static void sort16_avx2_u64(uint64_t *block)
+{
+    enum { NREGS = 4, NLANES = 4 };
+    __m256i r[NREGS];
+    for (size_t i = 0; i < NREGS; i++) {
+        r[i] = _mm256_loadu_si256((const __m256i *) (block + i * NLANES));
+    }
+    for (size_t i = 0; i < sizeof(network4) / sizeof(network4[0]); i++) {
+        cmpswap_avx2_u64(&r[network4[i][0]], &r[network4[i][1]]);
+    }
+    transpose_avx2_u64(r);
+    for (size_t w = 1; w < NREGS; w *= 2) {
+        for (size_t base = 0; base < NREGS; base += 2 * w) {
+            for (size_t i = 0; i < w / 2; i++) {
+                __m256i t = r[base + w + i];
+                r[base + w + i] = r[base + 2 * w - 1 - i];
+                r[base + 2 * w - 1 - i] = t;
+            }
+            for (size_t i = base + w; i < base + 2 * w; i++) {
+                r[i] = reverse_avx2_u64(r[i]);
+            }
+            for (size_t d = w; d >= 1; d /= 2) {
+                for (size_t i = base; i < base + 2 * w; i++) {
+                    if (((i - base) & d) == 0) {
+                        cmpswap_avx2_u64(&r[i], &r[i + d]);
+                    }
+                }
+            }
+            for (size_t i = base; i < base + 2 * w; i++) {
+                r[i] = clean_avx2_u64(r[i]);
+            }
+        }
+    }
+    for (size_t i = 0; i < NREGS; i++) {
+        _mm256_storeu_si256((__m256i *) (block + i * NLANES), r[i]);
+    }
+}
+
+#endif /* HAVE_X86_SORT_NETWORK */
+
+bool sort_network_u32(uint32_t *array, size_t nelems)
+{
+#ifdef HAVE_X86_SORT_NETWORK
+    uint32_t block[64];
+    if (nelems <= 64 && __builtin_cpu_supports("avx2")) {
+        memcpy(block, array, nelems * sizeof(uint32_t));
+        memset(block + nelems, 0xFF, (64 - nelems) * sizeof(uint32_t));
+        sort64_avx2_u32(block);
+        memcpy(array, block, nelems * sizeof(uint32_t));
+        return true;
+    }
+    if (nelems <= 16 && __builtin_cpu_supports("sse4.1")) {
+        memcpy(block, array, nelems * sizeof(uint32_t));
+        memset(block + nelems, 0xFF, (16 - nelems) * sizeof(uint32_t));
+        sort16_sse41_u32(block);
+        memcpy(array, block, nelems * sizeof(uint32_t));
+        return true;
+    }
+#else
+    (void) array;
+    (void) nelems;
+#endif
+    return false;
+}
+
+bool sort_network_u64(uint64_t *array, size_t nelems)
+{
+#ifdef HAVE_X86_SORT_NETWORK
+    uint64_t block[16];
+    if (nelems <= 16 && __builtin_cpu_supports("avx2")) {
+        memcpy(block, array, nelems * sizeof(uint64_t));
+        memset(block + nelems, 0xFF, (16 - nelems) * sizeof(uint64_t));
+        sort16_avx2_u64(block);
+        memcpy(array, block, nelems * sizeof(uint64_t));
+        return true;
+    }
+#else
+    (void) array;
+    (void) nelems;
+#endif
+    return false;
+}
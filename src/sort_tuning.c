@@ -0,0 +1,121 @@
+/*
+ * Written by Luke McCarthy <luke@iogopro.co.uk>, Oct-Nov 2025
+ * https://github.com/ljmccarthy/sorting_algorithms
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+ * this software, either in source code form or as a compiled binary, for any
+ * purpose, commercial or non-commercial, and by any means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors of
+ * this software dedicate any and all copyright interest in the software to the
+ * public domain. We make this dedication for the benefit of the public at
+ * large and to the detriment of our heirs and successors. We intend this
+ * dedication to be an overt act of relinquishment in perpetuity of all present
+ * and future rights to this software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org/>
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "sort_tuning.h"
+
+struct sort_tuning sort_tuning = SORT_TUNING_DEFAULTS;
+
+struct tuning_field {
+    const char *name;
+    size_t offset;
+    size_t min;
+    size_t max;
+    bool power_of_two;
+};
+
+static const struct tuning_field tuning_fields[] = {
+    {"timsort_min_merge", offsetof(struct sort_tuning, timsort_min_merge), 32, 256, true},
+    {"timsort_min_gallop", offsetof(struct sort_tuning, timsort_min_gallop), 1, 64, false},
+    {"quicksort_insertion_cutoff", offsetof(struct sort_tuning, quicksort_insertion_cutoff), 2, 64, false},
+    {"quicksort_ninther_cutoff", offsetof(struct sort_tuning, quicksort_ninther_cutoff), 7, 1000, false},
+    {"merge_sort_base_case", offsetof(struct sort_tuning, merge_sort_base_case), 3, 32, false},
+};
+
+#define TUNING_FIELD(tuning, field) ((size_t *) ((char *) (tuning) + (field)->offset))
+
+static bool parse_line(struct sort_tuning *tuning, const char *line)
+{
+    char name[64];
+    size_t value;
+    char rest;
+    if (sscanf(line, " %63s %zu %c", name, &value, &rest) != 2) {
+        return false;
+    }
+    for (size_t i = 0; i < sizeof(tuning_fields) / sizeof(tuning_fields[0]); i++) {
+        const struct tuning_field *field = &tuning_fields[i];
+        if (strcmp(name, field->name) == 0) {
+            if (value < field->min || value > field->max || (field->power_of_two && (value & (value - 1)))) {
+                return false;
+            }
+            *TUNING_FIELD(tuning, field) = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+int sort_tuning_load(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return -1;
+    }
+    struct sort_tuning tuning = sort_tuning;
+    char line[256];
+    bool valid = true;
+    while (valid && fgets(line, sizeof(line), file)) {
+        const char *start = line + strspn(line, " \t");
+        if (*start != '#' && start[strspn(start, " \t\r\n")] != '\0') {
+            valid = parse_line(&tuning, start);
+        }
+    }
+    bool read_error = ferror(file);
+    fclose(file);
+    if (read_error) {
+        errno = EIO;
+        return -1;
+    }
+    if (!valid) {
+        errno = EINVAL;
+        return -1;
+    }
+    sort_tuning = tuning;
+    return 0;
+}
+
+int sort_tuning_save(const char *path, const struct sort_tuning *tuning)
+{
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        return -1;
+    }
+    fprintf(file, "# Sort tuning profile written by test_sort --calibrate\n");
+    for (size_t i = 0; i < sizeof(tuning_fields) / sizeof(tuning_fields[0]); i++) {
+        const struct tuning_field *field = &tuning_fields[i];
+        fprintf(file, "%s %zu\n", field->name, *(const size_t *) ((const char *) tuning + field->offset));
+    }
+    bool write_error = ferror(file);
+    if (fclose(file) != 0 || write_error) {
+        return -1;
+    }
+    return 0;
+}
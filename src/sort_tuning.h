@@ -0,0 +1,68 @@
+/*
+ * Written by Luke McCarthy <luke@iogopro.co.uk>, Oct-Nov 2025
+ * https://github.com/ljmccarthy/sorting_algorithms
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+ * this software, either in source code form or as a compiled binary, for any
+ * purpose, commercial or non-commercial, and by any means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors of
+ * this software dedicate any and all copyright interest in the software to the
+ * public domain. We make this dedication for the benefit of the public at
+ * large and to the detriment of our heirs and successors. We intend this
+ * dedication to be an overt act of relinquishment in perpetuity of all present
+ * and future rights to this software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org/>
+ */
+
+/*
+ * Tuning parameters for the algorithm cutoffs that depend on the machine.
+ * The sorts read them from sort_tuning, which starts out with the defaults
+ * below. A program can load a profile written by test_sort --calibrate with
+ * sort_tuning_load at startup to use values measured on the host, without a
+ * rebuild. The values must not be changed while a sort is running.
+ *
+ * A profile is a text file with one "name value" pair per line, using the
+ * field names below. Blank lines and lines starting with # are ignored and
+ * fields that aren't given keep their current values.
+ */
+
+#pragma once
+#include <stddef.h>
+
+struct sort_tuning {
+    /* timsort: MIN_MERGE, binary insertion sorts runs up to between half and all of this (power of 2, 32-256, default 32) */
+    size_t timsort_min_merge;
+    /* timsort: MIN_GALLOP, the initial threshold for entering galloping mode in merges (1-64, default 7) */
+    size_t timsort_min_gallop;
+    /* bentley_mcilroy_quicksort: arrays shorter than this are insertion sorted (2-64, default 7) */
+    size_t quicksort_insertion_cutoff;
+    /* bentley_mcilroy_quicksort: arrays longer than this take the pivot as a pseudomedian of 9 (7-1000, default 40) */
+    size_t quicksort_ninther_cutoff;
+    /* merge_sort, merge_sort_ws and the serial leaves of merge_sort_parallel: subarrays of up to this many elements
+     * are sorted directly instead of merged (3-32, default 3) */
+    size_t merge_sort_base_case;
+};
+
+#define SORT_TUNING_DEFAULTS {32, 7, 7, 40, 3}
+
+extern struct sort_tuning sort_tuning;
+
+/*
+ * Loads a profile into sort_tuning. Returns 0 on success or -1 with errno set on failure, in which case
+ * sort_tuning is unchanged (EINVAL if the file has an unknown name or a value out of range).
+ */
+int sort_tuning_load(const char *path);
+
+/* Writes tuning to a profile that sort_tuning_load can read. Returns 0 on success or -1 with errno set on failure. */
+int sort_tuning_save(const char *path, const struct sort_tuning *tuning);
@@ -0,0 +1,73 @@
+/*
+ * Written by Luke McCarthy <luke@iogopro.co.uk>
+ * https://github.com/ljmccarthy/sorting_algorithms
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+ * this software, either in source code form or as a compiled binary, for any
+ * purpose, commercial or non-commercial, and by any means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors of
+ * this software dedicate any and all copyright interest in the software to the
+ * public domain. We make this dedication for the benefit of the public at
+ * large and to the detriment of our heirs and successors. We intend this
+ * dedication to be an overt act of relinquishment in perpetuity of all present
+ * and future rights to this software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org/>
+ */
+
+#include <stdint.h>
+#include "sort.h"
+#include "sort_network.h"
+
+/* NaNs sort after all other values, so the ordering stays a strict weak ordering. */
+#define F64_LESS(a, b) ((a) < (b) || ((b) != (b) && (a) == (a)))
+
+#define SORT_TYPE uint32_t
+#define SORT_SUFFIX u32
+#define SORT_LESS(a, b) ((a) < (b))
+#define SORT_LINKAGE
+#define SORT_NETWORK(array, nelems) sort_network_u32(array, nelems)
+#define SORT_NETWORK_MAX SORT_NETWORK_U32_MAX
+#include "merge_sort_impl.h"
+
+#define SORT_TYPE uint64_t
+#define SORT_SUFFIX u64
+#define SORT_LESS(a, b) ((a) < (b))
+#define SORT_LINKAGE
+#define SORT_NETWORK(array, nelems) sort_network_u64(array, nelems)
+#define SORT_NETWORK_MAX SORT_NETWORK_U64_MAX
+#include "merge_sort_impl.h"
+
+#define SORT_TYPE double
+#define SORT_SUFFIX f64
+#define SORT_LESS(a, b) F64_LESS(a, b)
+#define SORT_LINKAGE
+#include "merge_sort_impl.h"
+
+#define SORT_TYPE uint32_t
+#define SORT_SUFFIX u32
+#define SORT_LESS(a, b) ((a) < (b))
+#define SORT_LINKAGE
+#include "quicksort_impl.h"
+
+#define SORT_TYPE uint64_t
+#define SORT_SUFFIX u64
+#define SORT_LESS(a, b) ((a) < (b))
+#define SORT_LINKAGE
+#include "quicksort_impl.h"
+
+#define SORT_TYPE double
+#define SORT_SUFFIX f64
+#define SORT_LESS(a, b) F64_LESS(a, b)
+#define SORT_LINKAGE
+#include "quicksort_impl.h"
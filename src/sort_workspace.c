@@ -0,0 +1,66 @@
+/*
+ * Written by Luke McCarthy <luke@iogopro.co.uk>, Oct-Nov 2025
+ * https://github.com/ljmccarthy/sorting_algorithms
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+ * this software, either in source code form or as a compiled binary, for any
+ * purpose, commercial or non-commercial, and by any means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors of
+ * this software dedicate any and all copyright interest in the software to the
+ * public domain. We make this dedication for the benefit of the public at
+ * large and to the detriment of our heirs and successors. We intend this
+ * dedication to be an overt act of relinquishment in perpetuity of all present
+ * and future rights to this software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org/>
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include "sort_workspace.h"
+
+struct sort_workspace {
+    void *buffer;
+    size_t size;
+};
+
+struct sort_workspace *sort_workspace_create(size_t initial_size)
+{
+    struct sort_workspace *ws = malloc(sizeof(struct sort_workspace));
+    if (!ws) {
+        return NULL;
+    }
+    ws->buffer = initial_size ? malloc(initial_size) : NULL;
+    ws->size = ws->buffer ? initial_size : 0;
+    return ws;
+}
+
+void sort_workspace_destroy(struct sort_workspace *ws)
+{
+    if (ws) {
+        free(ws->buffer);
+        free(ws);
+    }
+}
+
+void *sort_workspace_reserve(struct sort_workspace *ws, size_t size)
+{
+    if (size > ws->size) {
+        /* Grow geometrically so a sequence of growing arrays only reallocates O(log n) times */
+        size_t new_size = ws->size * 2 > size ? ws->size * 2 : size;
+        free(ws->buffer);
+        ws->buffer = malloc(new_size);
+        ws->size = ws->buffer ? new_size : 0;
+    }
+    return ws->buffer;
+}
@@ -0,0 +1,487 @@
+/*
+ * Written by Luke McCarthy <luke@iogopro.co.uk>, Oct-Nov 2025
+ * https://github.com/ljmccarthy/sorting_algorithms
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+ * this software, either in source code form or as a compiled binary, for any
+ * purpose, commercial or non-commercial, and by any means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors of
+ * this software dedicate any and all copyright interest in the software to the
+ * public domain. We make this dedication for the benefit of the public at
+ * large and to the detriment of our heirs and successors. We intend this
+ * dedication to be an overt act of relinquishment in perpetuity of all present
+ * and future rights to this software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org/>
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sort.h"
+#include "util.h"
+
+/*
+ * Sorts for string keys, which look at each character of the common prefixes
+ * once or a few times, instead of rescanning them on every comparison as a
+ * comparison sort with strcmp does. Strings are ordered by their bytes as
+ * unsigned char, like strcmp and memcmp, with a proper prefix before the
+ * longer string. None of the sorts are stable.
+ *
+ * multikey_quicksort is Bentley and Sedgewick's three-way radix quicksort: it
+ * partitions on one character at a time, recursing into the less and greater
+ * parts at the same depth and into the equal part at the next character.
+ *
+ * string_radix_sort is an MSD radix sort on one byte at a time, which reads
+ * the byte of each string once into a small oracle array per pass. Buckets
+ * below a cutoff are finished with an LCP merge sort (Ng and Kakehi), which
+ * keeps the longest common prefix of each string with its predecessor and
+ * uses it to skip the characters that two strings being merged are known to
+ * share, so each character is compared about once.
+ *
+ * string_ref_sort sorts (data, length) strings, which may contain NUL bytes,
+ * by multikey quicksort on 8-byte words instead of single characters. The
+ * word at the current depth is cached big-endian next to each string, so most
+ * comparisons are integer compares that don't touch the string data, and the
+ * cache is only refilled for groups of strings that share the whole word.
+ */
+
+/* Groups smaller than this are finished with insertion sort */
+#define MULTIKEY_INSERTION_SORT_CUTOFF 16
+
+/* Buckets smaller than this are finished with the LCP merge sort in string_radix_sort */
+#define STRING_RADIX_CUTOFF 64
+
+/* Sequences shorter than this are insertion sorted in the LCP merge sort */
+#define LCP_INSERTION_SORT_CUTOFF 8
+
+#define STRING_RADIX_BUCKETS 256
+
+static inline int char_at(const char *s, size_t depth)
+{
+    return (unsigned char) s[depth];
+}
+
+/* Sorts strings that share their first depth characters */
+static void string_insertion_sort(const char **strings, size_t nelems, size_t depth)
+{
+    for (size_t i = 1; i < nelems; i++) {
+        const char *s = strings[i];
+        size_t j = i;
+        for (; j > 0 && strcmp(strings[j - 1] + depth, s + depth) > 0; j--) {
+            strings[j] = strings[j - 1];
+        }
+        strings[j] = s;
+    }
+}
+
+/*
+ * Returns the length of the common prefix of all the strings, which share
+ * their first depth characters. Used to jump over a long common prefix in one
+ * pass, scanning each string sequentially, rather than a pass per character.
+ */
+static size_t common_prefix(const char **strings, size_t nelems, size_t depth)
+{
+    const char *first = strings[0];
+    size_t lcp = depth + strlen(first + depth);
+    for (size_t i = 1; i < nelems && lcp > depth; i++) {
+        const char *s = strings[i];
+        size_t h = depth;
+        while (h < lcp && s[h] == first[h]) {
+            h++;
+        }
+        lcp = h;
+    }
+    return lcp;
+}
+
+static inline int median_of_three(int a, int b, int c)
+{
+    if (a < b) {
+        return b < c ? b : (a < c ? c : a);
+    }
+    return a < c ? a : (b < c ? c : b);
+}
+
+static void multikey_quicksort_rec(const char **strings, size_t nelems, size_t depth)
+{
+    while (nelems >= MULTIKEY_INSERTION_SORT_CUTOFF) {
+        int pivot = median_of_three(char_at(strings[0], depth), char_at(strings[nelems / 2], depth),
+                                    char_at(strings[nelems - 1], depth));
+        /* Dijkstra's three-way partition: [0, lt) < pivot, [lt, i) == pivot, [gt, nelems) > pivot */
+        size_t lt = 0, i = 0, gt = nelems;
+        while (i < gt) {
+            const char *s = strings[i];
+            int c = char_at(s, depth);
+            if (c < pivot) {
+                strings[i++] = strings[lt];
+                strings[lt++] = s;
+            } else if (c > pivot) {
+                strings[i] = strings[--gt];
+                strings[gt] = s;
+            } else {
+                i++;
+            }
+        }
+        multikey_quicksort_rec(strings, lt, depth);
+        multikey_quicksort_rec(strings + gt, nelems - gt, depth);
+        if (pivot == 0) {
+            return; /* the equal strings have all ended */
+        }
+        if (lt == 0 && gt == nelems) {
+            depth = common_prefix(strings, nelems, depth + 1);
+            continue;
+        }
+        strings += lt;
+        nelems = gt - lt;
+        depth++;
+    }
+    string_insertion_sort(strings, nelems, depth);
+}
+
+void multikey_quicksort(const char **strings, size_t nelems)
+{
+    multikey_quicksort_rec(strings, nelems, 0);
+}
+
+/*
+ * LCP merge sort. lcps[i] is the length of the longest common prefix of
+ * strings[i - 1] and strings[i] (lcps[0] is not used), and all the strings
+ * share their first depth characters.
+ */
+
+/* Compares a and b, which share their first *lcp characters, and updates *lcp to their whole common prefix */
+static inline int lcp_compare(const char *a, const char *b, size_t *lcp)
+{
+    size_t h = *lcp;
+    while (a[h] != 0 && a[h] == b[h]) {
+        h++;
+    }
+    *lcp = h;
+    int a_char = char_at(a, h), b_char = char_at(b, h);
+    return (a_char > b_char) - (a_char < b_char);
+}
+
+static void lcp_insertion_sort(const char **strings, size_t *lcps, size_t nelems, size_t depth)
+{
+    string_insertion_sort(strings, nelems, depth);
+    for (size_t i = 1; i < nelems; i++) {
+        size_t h = depth;
+        lcp_compare(strings[i - 1], strings[i], &h);
+        lcps[i] = h;
+    }
+}
+
+/*
+ * Merges the sorted sequences lhs and rhs into out. While merging, lhs_lcp
+ * and rhs_lcp are the common prefixes of the next string of each side with the
+ * last string output, which are both no smaller than it. The side with the
+ * longer common prefix is then the smaller, so the strings are only compared,
+ * from that prefix onwards, when the common prefixes are equal.
+ */
+static void lcp_merge(const char **lhs, const size_t *lhs_lcps, size_t lhs_nelems,
+                      const char **rhs, const size_t *rhs_lcps, size_t rhs_nelems,
+                      const char **out, size_t *out_lcps, size_t depth)
+{
+    size_t i = 0, j = 0, k = 0;
+    size_t lhs_lcp = depth, rhs_lcp = depth;
+    while (i < lhs_nelems && j < rhs_nelems) {
+        bool take_lhs;
+        if (lhs_lcp > rhs_lcp) {
+            take_lhs = true;
+        } else if (lhs_lcp < rhs_lcp) {
+            take_lhs = false;
+        } else {
+            size_t h = lhs_lcp;
+            take_lhs = lcp_compare(lhs[i], rhs[j], &h) <= 0;
+            /* h is now the common prefix of the string taken with the one left behind */
+            if (take_lhs) {
+                rhs_lcp = h;
+            } else {
+                lhs_lcp = h;
+            }
+        }
+        if (take_lhs) {
+            out[k] = lhs[i];
+            out_lcps[k++] = lhs_lcp;
+            i++;
+            lhs_lcp = i < lhs_nelems ? lhs_lcps[i] : 0;
+        } else {
+            out[k] = rhs[j];
+            out_lcps[k++] = rhs_lcp;
+            j++;
+            rhs_lcp = j < rhs_nelems ? rhs_lcps[j] : 0;
+        }
+    }
+    /*
+     * Copy the rest of the side that is left, unless it is already in place
+     * (out is just before rhs when merging in place). The common prefix of its
+     * first string with the last string output is in lhs_lcp or rhs_lcp.
+     */
+    if (i < lhs_nelems) {
+        copy(&out[k], &lhs[i], (lhs_nelems - i) * sizeof(*out));
+        copy(&out_lcps[k], &lhs_lcps[i], (lhs_nelems - i) * sizeof(*out_lcps));
+        out_lcps[k] = lhs_lcp;
+    } else if (j < rhs_nelems) {
+        if (&out[k] != &rhs[j]) {
+            copy(&out[k], &rhs[j], (rhs_nelems - j) * sizeof(*out));
+            copy(&out_lcps[k], &rhs_lcps[j], (rhs_nelems - j) * sizeof(*out_lcps));
+        }
+        out_lcps[k] = rhs_lcp;
+    }
+}
+
+/* Sorts strings in place using temp and temp_lcps, with room for (nelems + 1) / 2 entries, to hold the left half */
+static void lcp_merge_sort(const char **strings, size_t *lcps, size_t nelems, const char **temp, size_t *temp_lcps, size_t depth)
+{
+    if (nelems < LCP_INSERTION_SORT_CUTOFF) {
+        lcp_insertion_sort(strings, lcps, nelems, depth);
+        return;
+    }
+    size_t lhs_nelems = nelems / 2;
+    size_t rhs_nelems = nelems - lhs_nelems;
+    lcp_merge_sort(strings, lcps, lhs_nelems, temp, temp_lcps, depth);
+    lcp_merge_sort(strings + lhs_nelems, lcps + lhs_nelems, rhs_nelems, temp, temp_lcps, depth);
+    /* Merging from the front into strings can't overtake the right half, which is read from the same place */
+    copy(temp, strings, lhs_nelems * sizeof(*strings));
+    copy(temp_lcps, lcps, lhs_nelems * sizeof(*lcps));
+    lcp_merge(temp, temp_lcps, lhs_nelems, strings + lhs_nelems, lcps + lhs_nelems, rhs_nelems, strings, lcps, depth);
+}
+
+struct string_radix {
+    const char **temp;
+    unsigned char *oracle;
+    size_t *lcps;
+    size_t *temp_lcps;
+};
+
+static void string_radix_sort_rec(const struct string_radix *radix, const char **strings, size_t nelems, size_t *lcps, size_t depth)
+{
+    while (nelems >= STRING_RADIX_CUTOFF) {
+        size_t counts[STRING_RADIX_BUCKETS] = {0};
+        size_t starts[STRING_RADIX_BUCKETS];
+        unsigned char *oracle = radix->oracle;
+        for (size_t i = 0; i < nelems; i++) {
+            oracle[i] = (unsigned char) strings[i][depth];
+            counts[oracle[i]]++;
+        }
+        /* Skip characters that all the strings share */
+        if (counts[oracle[0]] == nelems) {
+            if (oracle[0] == 0) {
+                return;
+            }
+            depth = common_prefix(strings, nelems, depth + 1);
+            continue;
+        }
+        size_t start = 0;
+        size_t largest = 1;
+        for (size_t c = 0; c < STRING_RADIX_BUCKETS; c++) {
+            starts[c] = start;
+            start += counts[c];
+            if (c > 0 && counts[c] > counts[largest]) {
+                largest = c;
+            }
+        }
+        const char **temp = radix->temp;
+        for (size_t i = 0; i < nelems; i++) {
+            temp[starts[oracle[i]]++] = strings[i];
+        }
+        copy(strings, temp, nelems * sizeof(*strings));
+        /* Bucket 0 holds equal strings that have ended. Recurse into the others except the largest, which is looped on */
+        start = counts[0];
+        for (size_t c = 1; c < STRING_RADIX_BUCKETS; c++) {
+            if (c != largest && counts[c] > 1) {
+                string_radix_sort_rec(radix, strings + start, counts[c], lcps + start, depth + 1);
+            }
+            start += counts[c];
+        }
+        size_t largest_start = starts[largest] - counts[largest];
+        strings += largest_start;
+        lcps += largest_start;
+        nelems = counts[largest];
+        depth++;
+    }
+    lcp_merge_sort(strings, lcps, nelems, radix->temp, radix->temp_lcps, depth);
+}
+
+void string_radix_sort(const char **strings, size_t nelems)
+{
+    if (nelems < 2) {
+        return;
+    }
+    struct string_radix radix;
+    radix.temp = malloc(nelems * sizeof(*radix.temp));
+    radix.oracle = malloc(nelems);
+    radix.lcps = malloc(nelems * sizeof(*radix.lcps));
+    radix.temp_lcps = malloc(nelems * sizeof(*radix.temp_lcps));
+    string_radix_sort_rec(&radix, strings, nelems, radix.lcps, 0);
+    free(radix.temp);
+    free(radix.oracle);
+    free(radix.lcps);
+    free(radix.temp_lcps);
+}
+
+/*
+ * string_ref_sort. Each string is sorted with a cache of the 8-byte word at
+ * the current depth, zero padded past its end, and how many of its bytes are
+ * left from the depth capped at 9. Comparing (word, tail) pairs orders any
+ * two strings that differ within the word, and strings with equal pairs are
+ * equal if the tail is 8 or less, as both end within the word. Only strings
+ * with equal words and a tail of 9 need to go on to the next word.
+ */
+struct cached_string_ref {
+    uint64_t word;
+    size_t tail;
+    struct string_ref ref;
+};
+
+#define STRING_REF_WORD_SIZE 8
+
+static inline void load_word(struct cached_string_ref *s, size_t depth)
+{
+    size_t left = s->ref.len - depth;
+    const unsigned char *data = (const unsigned char *) s->ref.data + depth;
+    uint64_t word = 0;
+    if (left >= STRING_REF_WORD_SIZE) {
+        for (size_t i = 0; i < STRING_REF_WORD_SIZE; i++) {
+            word = word << 8 | data[i];
+        }
+        s->tail = left == STRING_REF_WORD_SIZE ? STRING_REF_WORD_SIZE : STRING_REF_WORD_SIZE + 1;
+    } else {
+        for (size_t i = 0; i < left; i++) {
+            word |= (uint64_t) data[i] << (8 * (STRING_REF_WORD_SIZE - 1 - i));
+        }
+        s->tail = left;
+    }
+    s->word = word;
+}
+
+static inline int cached_compare(const struct cached_string_ref *a, const struct cached_string_ref *b)
+{
+    if (a->word != b->word) {
+        return a->word < b->word ? -1 : 1;
+    }
+    return (a->tail > b->tail) - (a->tail < b->tail);
+}
+
+/* Full comparison of strings that share their first depth bytes */
+static int string_ref_compare(const struct cached_string_ref *a, const struct cached_string_ref *b, size_t depth)
+{
+    int order = cached_compare(a, b);
+    if (order != 0 || a->tail <= STRING_REF_WORD_SIZE) {
+        return order;
+    }
+    depth += STRING_REF_WORD_SIZE;
+    size_t a_len = a->ref.len - depth;
+    size_t b_len = b->ref.len - depth;
+    order = memcmp(a->ref.data + depth, b->ref.data + depth, a_len < b_len ? a_len : b_len);
+    if (order != 0) {
+        return order;
+    }
+    return (a_len > b_len) - (a_len < b_len);
+}
+
+/* Returns the length of the common prefix of all the strings, which share their first depth bytes */
+static size_t string_ref_common_prefix(const struct cached_string_ref *strings, size_t nelems, size_t depth)
+{
+    const char *first = strings[0].ref.data;
+    size_t lcp = strings[0].ref.len;
+    for (size_t i = 1; i < nelems && lcp > depth; i++) {
+        const char *data = strings[i].ref.data;
+        size_t end = strings[i].ref.len < lcp ? strings[i].ref.len : lcp;
+        size_t h = depth;
+        while (h < end && data[h] == first[h]) {
+            h++;
+        }
+        lcp = h;
+    }
+    return lcp;
+}
+
+static void string_ref_insertion_sort(struct cached_string_ref *strings, size_t nelems, size_t depth)
+{
+    for (size_t i = 1; i < nelems; i++) {
+        struct cached_string_ref s = strings[i];
+        size_t j = i;
+        for (; j > 0 && string_ref_compare(&strings[j - 1], &s, depth) > 0; j--) {
+            strings[j] = strings[j - 1];
+        }
+        strings[j] = s;
+    }
+}
+
+static const struct cached_string_ref *cached_median_of_three(const struct cached_string_ref *a, const struct cached_string_ref *b,
+                                                              const struct cached_string_ref *c)
+{
+    if (cached_compare(a, b) < 0) {
+        return cached_compare(b, c) < 0 ? b : (cached_compare(a, c) < 0 ? c : a);
+    }
+    return cached_compare(a, c) < 0 ? a : (cached_compare(b, c) < 0 ? c : b);
+}
+
+static void string_ref_sort_rec(struct cached_string_ref *strings, size_t nelems, size_t depth)
+{
+    while (nelems >= MULTIKEY_INSERTION_SORT_CUTOFF) {
+        struct cached_string_ref pivot = *cached_median_of_three(&strings[0], &strings[nelems / 2], &strings[nelems - 1]);
+        size_t lt = 0, i = 0, gt = nelems;
+        while (i < gt) {
+            int order = cached_compare(&strings[i], &pivot);
+            if (order < 0) {
+                struct cached_string_ref s = strings[i];
+                strings[i++] = strings[lt];
+                strings[lt++] = s;
+            } else if (order > 0) {
+                struct cached_string_ref s = strings[i];
+                strings[i] = strings[--gt];
+                strings[gt] = s;
+            } else {
+                i++;
+            }
+        }
+        string_ref_sort_rec(strings, lt, depth);
+        string_ref_sort_rec(strings + gt, nelems - gt, depth);
+        if (pivot.tail <= STRING_REF_WORD_SIZE) {
+            return; /* the equal strings have all ended */
+        }
+        bool all_equal = lt == 0 && gt == nelems;
+        strings += lt;
+        nelems = gt - lt;
+        depth += STRING_REF_WORD_SIZE;
+        if (all_equal) {
+            depth = string_ref_common_prefix(strings, nelems, depth);
+        }
+        for (size_t j = 0; j < nelems; j++) {
+            load_word(&strings[j], depth);
+        }
+    }
+    string_ref_insertion_sort(strings, nelems, depth);
+}
+
+void string_ref_sort(struct string_ref *strings, size_t nelems)
+{
+    if (nelems < 2) {
+        return;
+    }
+    struct cached_string_ref *cached = malloc(nelems * sizeof(*cached));
+    for (size_t i = 0; i < nelems; i++) {
+        cached[i].ref = strings[i];
+        load_word(&cached[i], 0);
+    }
+    string_ref_sort_rec(cached, nelems, 0);
+    for (size_t i = 0; i < nelems; i++) {
+        strings[i] = cached[i].ref;
+    }
+    free(cached);
+}
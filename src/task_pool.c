@@ -0,0 +1,272 @@
+/*
+ * Written by Luke McCarthy <luke@iogopro.co.uk>
+ * https://github.com/ljmccarthy/sorting_algorithms
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+ * this software, either in source code form or as a compiled binary, for any
+ * purpose, commercial or non-commercial, and by any means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors of
+ * this software dedicate any and all copyright interest in the software to the
+ * public domain. We make this dedication for the benefit of the public at
+ * large and to the detriment of our heirs and successors. We intend this
+ * dedication to be an overt act of relinquishment in perpetuity of all present
+ * and future rights to this software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org/>
+ */
+
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "task_pool.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+
+typedef SRWLOCK lock_t;
+typedef HANDLE thread_t;
+
+static void lock_init(lock_t *lock) { InitializeSRWLock(lock); }
+static void lock_destroy(lock_t *lock) { (void) lock; }
+static void lock_acquire(lock_t *lock) { AcquireSRWLockExclusive(lock); }
+static void lock_release(lock_t *lock) { ReleaseSRWLockExclusive(lock); }
+static void thread_yield(void) { SwitchToThread(); }
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+typedef pthread_mutex_t lock_t;
+typedef pthread_t thread_t;
+
+static void lock_init(lock_t *lock) { pthread_mutex_init(lock, NULL); }
+static void lock_destroy(lock_t *lock) { pthread_mutex_destroy(lock); }
+static void lock_acquire(lock_t *lock) { pthread_mutex_lock(lock); }
+static void lock_release(lock_t *lock) { pthread_mutex_unlock(lock); }
+static void thread_yield(void) { sched_yield(); }
+#endif
+
+struct task_pool {
+    struct task_worker *workers;
+    unsigned nworkers;
+    atomic_bool finished;
+};
+
+struct task_worker {
+    struct task_pool *pool;
+    unsigned index;
+    uint32_t seed;
+    lock_t lock;
+    size_t top;    /* oldest task, stolen by other workers */
+    size_t bottom; /* one past the newest task, pushed and popped by the owner */
+    struct task *deque[TASK_DEQUE_CAPACITY];
+};
+
+unsigned task_pool_default_threads(void)
+{
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (unsigned) info.dwNumberOfProcessors : 1;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (unsigned) n : 1;
+#endif
+}
+
+static void run_task(struct task_worker *worker, struct task *task)
+{
+    task->fn(worker, task->arg);
+    atomic_store_explicit(&task->done, true, memory_order_release);
+}
+
+static struct task *pop_task(struct task_worker *worker)
+{
+    struct task *task = NULL;
+    lock_acquire(&worker->lock);
+    if (worker->bottom != worker->top) {
+        worker->bottom--;
+        task = worker->deque[worker->bottom % TASK_DEQUE_CAPACITY];
+    }
+    lock_release(&worker->lock);
+    return task;
+}
+
+static struct task *steal_task(struct task_worker *victim)
+{
+    struct task *task = NULL;
+    lock_acquire(&victim->lock);
+    if (victim->bottom != victim->top) {
+        task = victim->deque[victim->top % TASK_DEQUE_CAPACITY];
+        victim->top++;
+    }
+    lock_release(&victim->lock);
+    return task;
+}
+
+static struct task *steal_any_task(struct task_worker *worker)
+{
+    struct task_pool *pool = worker->pool;
+    if (pool->nworkers <= 1) {
+        return NULL;
+    }
+    /* LCG, start at a random victim so thieves don't all pile onto worker 0 */
+    worker->seed = 1664525 * worker->seed + 1013904223;
+    unsigned start = (worker->seed >> 16) % pool->nworkers;
+    for (unsigned i = 0; i < pool->nworkers; i++) {
+        unsigned victim = (start + i) % pool->nworkers;
+        if (victim != worker->index) {
+            struct task *task = steal_task(&pool->workers[victim]);
+            if (task) {
+                return task;
+            }
+        }
+    }
+    return NULL;
+}
+
+void task_spawn(struct task_worker *worker, struct task *task, task_fn_t fn, void *arg)
+{
+    task->fn = fn;
+    task->arg = arg;
+    atomic_init(&task->done, false);
+    bool pushed = false;
+    lock_acquire(&worker->lock);
+    if (worker->bottom - worker->top < TASK_DEQUE_CAPACITY) {
+        worker->deque[worker->bottom % TASK_DEQUE_CAPACITY] = task;
+        worker->bottom++;
+        pushed = true;
+    }
+    lock_release(&worker->lock);
+    if (!pushed) {
+        run_task(worker, task);
+    }
+}
+
+void task_wait(struct task_worker *worker, struct task *task)
+{
+    while (!atomic_load_explicit(&task->done, memory_order_acquire)) {
+        /* Tasks are stolen oldest first, so if the task is still ours it is at the bottom. */
+        struct task *next = pop_task(worker);
+        if (!next) {
+            next = steal_any_task(worker);
+        }
+        if (next) {
+            run_task(worker, next);
+        } else {
+            thread_yield();
+        }
+    }
+}
+
+static void worker_loop(struct task_worker *worker)
+{
+    struct task_pool *pool = worker->pool;
+    while (!atomic_load_explicit(&pool->finished, memory_order_acquire)) {
+        struct task *task = steal_any_task(worker);
+        if (task) {
+            run_task(worker, task);
+        } else {
+            thread_yield();
+        }
+    }
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI worker_thread(LPVOID arg)
+{
+    worker_loop(arg);
+    return 0;
+}
+
+static bool thread_start(thread_t *thread, struct task_worker *worker)
+{
+    *thread = CreateThread(NULL, 0, worker_thread, worker, 0, NULL);
+    return *thread != NULL;
+}
+
+static void thread_join(thread_t thread)
+{
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+#else
+static void *worker_thread(void *arg)
+{
+    worker_loop(arg);
+    return NULL;
+}
+
+static bool thread_start(thread_t *thread, struct task_worker *worker)
+{
+    return pthread_create(thread, NULL, worker_thread, worker) == 0;
+}
+
+static void thread_join(thread_t thread)
+{
+    pthread_join(thread, NULL);
+}
+#endif
+
+static void worker_init(struct task_worker *worker, struct task_pool *pool, unsigned index)
+{
+    worker->pool = pool;
+    worker->index = index;
+    worker->seed = 0x9E3779B9u * (index + 1);
+    worker->top = 0;
+    worker->bottom = 0;
+    lock_init(&worker->lock);
+}
+
+void task_pool_run(unsigned nthreads, task_fn_t fn, void *arg)
+{
+    struct task_pool pool;
+    struct task_worker single_worker;
+    if (nthreads == 0) {
+        nthreads = task_pool_default_threads();
+    }
+    pool.nworkers = nthreads;
+    pool.workers = nthreads > 1 ? malloc(nthreads * sizeof(struct task_worker)) : NULL;
+    thread_t *threads = nthreads > 1 ? malloc((nthreads - 1) * sizeof(thread_t)) : NULL;
+    if (!pool.workers || !threads) {
+        free(pool.workers);
+        free(threads);
+        pool.nworkers = 1;
+        pool.workers = &single_worker;
+    }
+    atomic_init(&pool.finished, false);
+    for (unsigned i = 0; i < pool.nworkers; i++) {
+        worker_init(&pool.workers[i], &pool, i);
+    }
+    unsigned nstarted = 0;
+    while (nstarted + 1 < pool.nworkers && thread_start(&threads[nstarted], &pool.workers[nstarted + 1])) {
+        nstarted++;
+    }
+    fn(&pool.workers[0], arg);
+    atomic_store_explicit(&pool.finished, true, memory_order_release);
+    for (unsigned i = 0; i < nstarted; i++) {
+        thread_join(threads[i]);
+    }
+    for (unsigned i = 0; i < pool.nworkers; i++) {
+        lock_destroy(&pool.workers[i].lock);
+    }
+    if (pool.workers != &single_worker) {
+        free(pool.workers);
+        free(threads);
+    }
+}
@@ -0,0 +1,76 @@
+/*
+ * Written by Luke McCarthy <luke@iogopro.co.uk>
+ * https://github.com/ljmccarthy/sorting_algorithms
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+ * this software, either in source code form or as a compiled binary, for any
+ * purpose, commercial or non-commercial, and by any means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors of
+ * this software dedicate any and all copyright interest in the software to the
+ * public domain. We make this dedication for the benefit of the public at
+ * large and to the detriment of our heirs and successors. We intend this
+ * dedication to be an overt act of relinquishment in perpetuity of all present
+ * and future rights to this software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org/>
+ */
+
+/*
+ * Minimal fork/join task pool with work stealing, used by the parallel sorts.
+ *
+ * Each worker owns a deque of spawned tasks. The owner pushes and pops at the
+ * bottom (LIFO, which keeps the working set of the recursion hot in cache) and
+ * idle workers steal from the top, which holds the oldest and therefore
+ * largest pieces of work. A worker waiting on a task that has been stolen
+ * helps by stealing other work instead of blocking.
+ *
+ * Tasks are owned by the caller (usually on the stack of the spawning
+ * function) and must be waited on before they go out of scope.
+ */
+
+#pragma once
+#include <stdatomic.h>
+#include <stdbool.h>
+
+struct task_worker;
+
+/*
+ * Number of tasks a worker can hold spawned and not yet run. A spawn beyond
+ * this runs the task on the spawning thread before returning, so a caller
+ * that spawns many tasks from one frame should keep them below it.
+ */
+#define TASK_DEQUE_CAPACITY 256
+
+typedef void (*task_fn_t)(struct task_worker *worker, void *arg);
+
+struct task {
+    task_fn_t fn;
+    void *arg;
+    atomic_bool done;
+};
+
+/* Number of hardware threads available, or 1 if it can't be determined. */
+unsigned task_pool_default_threads(void);
+
+/*
+ * Run fn(worker, arg) on the calling thread with nthreads - 1 additional
+ * worker threads available to steal spawned tasks. Returns when fn returns.
+ * If nthreads is 0 the number of hardware threads is used.
+ */
+void task_pool_run(unsigned nthreads, task_fn_t fn, void *arg);
+
+/* Make fn(worker, arg) available to be run by any worker. */
+void task_spawn(struct task_worker *worker, struct task *task, task_fn_t fn, void *arg);
+
+/* Wait for a spawned task to complete, running other tasks in the meantime. */
+void task_wait(struct task_worker *worker, struct task *task);
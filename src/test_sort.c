@@ -25,14 +25,21 @@
  * For more information, please refer to <https://unlicense.org/>
  */
 
+#include <errno.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
-#include <time.h>
+#include <math.h>
+#include <stdatomic.h>
 #include "sort.h"
+#include "sort_tuning.h"
+#include "external_sort.h"
+#include "instrument.h"
+#include "timer.h"
 
 #define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
 
@@ -53,6 +60,8 @@ enum sort_function_type {
     SORT_FN_VOID_CONTEXT_THEN_COMPARE_WITH_CONTEXT_FIRST,
     SORT_FN_VOID_CONTEXT_THEN_COMPARE_WITH_CONTEXT_LAST,
     SORT_FN_INT_CONTEXT_THEN_COMPARE_WITH_CONTEXT_LAST,
+    SORT_FN_VOID_TYPED,
+    SORT_FN_VOID_KEYED,
 };
 
 enum performance {
@@ -72,36 +81,492 @@ struct sort_function {
         int (*int_compare_with_context_last_then_context)(void *base, size_t nelems, size_t size, compare_with_context_last_fn_t compare, void *context);
         void (*void_context_then_compare_with_context_first)(void *base, size_t nelems, size_t size, void *context, compare_with_context_first_fn_t compare);
         void (*void_context_then_compare_with_context_last)(void *base, size_t nelems, size_t size, void *context, compare_with_context_last_fn_t compare);
+        void (*void_typed)(void *base, size_t nelems);
+        void (*void_keyed)(void *base, size_t nelems, size_t size);
     } fn;
     enum performance perf;
+    size_t elem_size; /* element size required by typed sort functions, 0 for any */
+    bool stable; /* equal elements keep their order (checked when the elements have room for their index) */
+    bool counts_moves; /* moves elements only through copy() and swap() in util.h, so the Instrumented build counts them */
 };
 
 typedef struct sort_function sort_fn_t;
 
+/* Benchmark mode (--bench) settings */
+enum output_format {
+    OUTPUT_TEXT,
+    OUTPUT_CSV,
+    OUTPUT_JSON,
+};
+
+static bool bench_mode = false;
+static bool merge_bench_mode = false;
+static bool select_bench_mode = false;
+static bool string_bench_mode = false;
+static const char *calibration_profile = NULL; /* profile written by --calibrate */
+static unsigned bench_warmup = 2;
+static unsigned bench_reps = 10;
+static enum output_format output_format = OUTPUT_TEXT;
+static bool json_first_record = true;
+
+/* Operation counts from checking a sort, counters that weren't available are false in has */
+struct op_counts {
+    uint64_t comparisons;
+    uint64_t copies;
+    uint64_t bytes_copied;
+    uint64_t allocations;
+    uint64_t peak_scratch_bytes;
+    struct {
+        bool comparisons;
+        bool copies;
+        bool allocations;
+    } has;
+};
+
+struct bench_result {
+    uint64_t min_ns;
+    uint64_t median_ns;
+    uint64_t p95_ns;
+    struct op_counts counts;
+};
+
+/* Number of threads used by the parallel sorts, 0 means one per hardware thread */
+static unsigned thread_count = 0;
+
+static void merge_sort_parallel_with_thread_count(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context)
+{
+    merge_sort_parallel(base, nelems, size, compare, context, thread_count);
+}
+
+static int timsort_parallel_with_thread_count(void *base, size_t nelems, size_t size, int (*compare)(const void *, const void *, void *), void *context)
+{
+    return timsort_r_parallel(base, nelems, size, compare, context, thread_count);
+}
+
+/* The path taken by the last sort_auto call, reported after each pattern (NULL for other sort functions) */
+static const char *sort_auto_path = NULL;
+
+#define SORT_AUTO_FUNCTION(name, flags) \
+    static void name(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context) \
+    { \
+        sort_auto_path = sort_auto_path_name(sort_auto(base, nelems, size, compare, context, flags)); \
+    }
+
+SORT_AUTO_FUNCTION(sort_auto_stable, 0)
+SORT_AUTO_FUNCTION(sort_auto_unstable, SORT_AUTO_UNSTABLE)
+SORT_AUTO_FUNCTION(sort_auto_low_memory, SORT_AUTO_LOW_MEMORY)
+SORT_AUTO_FUNCTION(sort_auto_in_place, SORT_AUTO_IN_PLACE)
+
+/* Workspace shared by the _ws sort functions, created on first use and kept for the whole run */
+static struct sort_workspace *workspace = NULL;
+
+static struct sort_workspace *get_workspace(void)
+{
+    if (!workspace) {
+        workspace = sort_workspace_create(0);
+    }
+    return workspace;
+}
+
+#define VOID_WORKSPACE_SORT_FUNCTION(name) \
+    static void name##_with_workspace(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context) \
+    { name##_ws(base, nelems, size, compare, context, get_workspace()); }
+
+#define INT_WORKSPACE_SORT_FUNCTION(name) \
+    static int name##_with_workspace(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context) \
+    { return name##_ws(base, nelems, size, compare, context, get_workspace()); }
+
+VOID_WORKSPACE_SORT_FUNCTION(merge_sort)
+VOID_WORKSPACE_SORT_FUNCTION(merge_sort_ptr)
+VOID_WORKSPACE_SORT_FUNCTION(merge_sort_indexed)
+INT_WORKSPACE_SORT_FUNCTION(timsort_r)
+INT_WORKSPACE_SORT_FUNCTION(bsd_heapsort)
+INT_WORKSPACE_SORT_FUNCTION(bsd_mergesort)
+
+#if !defined(_WIN32)
+/* Memory limit for external_sort, small by default so that the test spills to many runs and several merge passes */
+static size_t external_sort_memory = 1024 * 1024;
+
+/* Round-trips the array through temporary files and sorts it with external_sort within the memory limit */
+static int external_sort_with_memory_limit(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context)
+{
+    /* Big elements need room for at least a few of them (see external_sort.h) */
+    size_t memory_limit = external_sort_memory / 6 < size ? 6 * size : external_sort_memory;
+    int result = -1;
+    FILE *input = tmpfile();
+    FILE *output = tmpfile();
+    /* Unbuffered so that the streams don't allocate buffers, external_sort reads and writes in big blocks anyway */
+    if (input && output && setvbuf(input, NULL, _IONBF, 0) == 0 && setvbuf(output, NULL, _IONBF, 0) == 0 &&
+        fwrite(base, size, nelems, input) == nelems && fflush(input) == 0) {
+        rewind(input);
+#ifdef HAVE_MALLOC_WRAP
+        uint64_t allocated_bytes = atomic_load(&instrument_counters.allocated_bytes);
+        instrument_reset_peak();
+#endif
+        result = external_sort(input, output, size, compare, context, memory_limit, NULL);
+#ifdef HAVE_MALLOC_WRAP
+        uint64_t peak_bytes = atomic_load(&instrument_counters.peak_allocated_bytes) - allocated_bytes;
+        /* Allow for malloc rounding big blocks up to whole pages, which the counters include */
+        if (peak_bytes > memory_limit + 16 * 1024) {
+            fprintf(stderr, "\nexternal_sort used %" PRIu64 " bytes, over the memory limit of %zu bytes\n", peak_bytes, memory_limit);
+            result = -1;
+        }
+#endif
+        rewind(output);
+        if (result == 0 && fread(base, size, nelems, output) != nelems) {
+            result = -1;
+        }
+    }
+    if (result != 0) {
+        perror("external_sort");
+    }
+    if (input) {
+        fclose(input);
+    }
+    if (output) {
+        fclose(output);
+    }
+    return result;
+}
+#endif
+
+/* The _out sorts are tested by sorting into a separate array and copying it back */
+#define OUT_SORT_FUNCTION(name) \
+    static void name##_with_out(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context) \
+    { \
+        void *out = malloc(nelems * size); \
+        name##_out(base, nelems, size, compare, context, out); \
+        memcpy(base, out, nelems * size); \
+        free(out); \
+    }
+
+OUT_SORT_FUNCTION(merge_sort_ptr)
+OUT_SORT_FUNCTION(merge_sort_indexed)
+
+/* merge_batch is tested by building up the sorted array from MERGE_BATCH_COUNT batches of the input */
+#define MERGE_BATCH_COUNT 16
+
+static void merge_batches(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, struct sort_workspace *ws)
+{
+    char *batches = malloc(nelems * size);
+    memcpy(batches, base, nelems * size);
+    size_t batch_nelems = (nelems + MERGE_BATCH_COUNT - 1) / MERGE_BATCH_COUNT;
+    for (size_t start = 0; start < nelems; start += batch_nelems) {
+        size_t n = nelems - start < batch_nelems ? nelems - start : batch_nelems;
+        if (ws) {
+            merge_batch_ws(base, start, size, compare, context, batches + start * size, n, ws);
+        } else {
+            merge_batch(base, start, size, compare, context, batches + start * size, n);
+        }
+    }
+    free(batches);
+}
+
+static void merge_batch_all(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context)
+{
+    merge_batches(base, nelems, size, compare, context, NULL);
+}
+
+static void merge_batch_all_with_workspace(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context)
+{
+    struct sort_workspace *ws = sort_workspace_create(0);
+    merge_batches(base, nelems, size, compare, context, ws);
+    sort_workspace_destroy(ws);
+}
+
+/* merge_k is tested by sorting MERGE_K_TEST_RUNS runs of the input with merge_sort and merging them */
+#define MERGE_K_TEST_RUNS 16
+
+static void merge_k_sorted_runs(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context)
+{
+    const void *runs[MERGE_K_TEST_RUNS];
+    size_t lens[MERGE_K_TEST_RUNS];
+    for (size_t i = 0; i < MERGE_K_TEST_RUNS; i++) {
+        size_t start = nelems * i / MERGE_K_TEST_RUNS;
+        lens[i] = nelems * (i + 1) / MERGE_K_TEST_RUNS - start;
+        runs[i] = (char *) base + start * size;
+        merge_sort((char *) base + start * size, lens[i], size, compare, context);
+    }
+    char *out = malloc(nelems * size);
+    merge_k(runs, lens, MERGE_K_TEST_RUNS, size, compare, context, out);
+    memcpy(base, out, nelems * size);
+    free(out);
+}
+
+/* block_merge_sort_buffer with a buffer of sqrt(n) elements and of n/2 elements, to show the memory/time tradeoff */
+static void block_merge_sort_with_buffer(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context, size_t buffer_nelems)
+{
+    void *buffer = malloc(buffer_nelems * size + 1);
+    block_merge_sort_buffer(base, nelems, size, compare, context, buffer, buffer_nelems * size);
+    free(buffer);
+}
+
+static void block_merge_sort_sqrt_buffer(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context)
+{
+    size_t buffer_nelems = 1;
+    while (buffer_nelems * buffer_nelems < nelems) {
+        buffer_nelems++;
+    }
+    block_merge_sort_with_buffer(base, nelems, size, compare, context, buffer_nelems);
+}
+
+static void block_merge_sort_half_buffer(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context)
+{
+    block_merge_sort_with_buffer(base, nelems, size, compare, context, nelems / 2 + 1);
+}
+
+/* The argsorts are tested by putting the elements in the order of the permutation */
+static void apply_argsort(void *base, size_t nelems, size_t size, const void *perm, size_t index_width)
+{
+    char *sorted = malloc(nelems * size);
+    for (size_t i = 0; i < nelems; i++) {
+        uint64_t index = index_width == sizeof(uint16_t) ? ((const uint16_t *) perm)[i]
+                       : index_width == sizeof(uint32_t) ? ((const uint32_t *) perm)[i]
+                       : ((const uint64_t *) perm)[i];
+        memcpy(sorted + i * size, (char *) base + index * size, size);
+    }
+    memcpy(base, sorted, nelems * size);
+    free(sorted);
+}
+
+#define ARGSORT_FUNCTION(name) \
+    static void name##_and_apply(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context) \
+    { \
+        size_t index_width; \
+        void *perm = name(base, nelems, size, compare, context, &index_width); \
+        apply_argsort(base, nelems, size, perm, index_width); \
+        free(perm); \
+    }
+
+ARGSORT_FUNCTION(argsort)
+ARGSORT_FUNCTION(argsort_unstable)
+
+/*
+ * The key/value sorts are tested by splitting the elements into an array of
+ * keys (the first 4 bytes, which are all compare_elem looks at) and an array
+ * of values (the rest of each element), and joining them back after sorting.
+ * The split and join are included in the benchmark times.
+ */
+#define KV_SORT_FUNCTION(name) \
+    static void name##_split(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context) \
+    { \
+        const size_t value_size = size - sizeof(elem_t); \
+        char *keys = malloc(nelems * sizeof(elem_t) + 1); \
+        char *values = malloc(nelems * value_size + 1); \
+        for (size_t i = 0; i < nelems; i++) { \
+            memcpy(keys + i * sizeof(elem_t), (char *) base + i * size, sizeof(elem_t)); \
+            memcpy(values + i * value_size, (char *) base + i * size + sizeof(elem_t), value_size); \
+        } \
+        name(keys, nelems, sizeof(elem_t), compare, context, values, value_size); \
+        for (size_t i = 0; i < nelems; i++) { \
+            memcpy((char *) base + i * size, keys + i * sizeof(elem_t), sizeof(elem_t)); \
+            memcpy((char *) base + i * size + sizeof(elem_t), values + i * value_size, value_size); \
+        } \
+        free(keys); \
+        free(values); \
+    }
+
+KV_SORT_FUNCTION(kv_sort)
+KV_SORT_FUNCTION(kv_sort_lockstep)
+KV_SORT_FUNCTION(kv_sort_gather)
+
+/*
+ * The typed sorts compare whole elements as integers. With the key in the first
+ * 4 bytes and the rest zeroed this gives the same order as compare_elem on
+ * either byte order.
+ */
+#define TYPED_SORT_FUNCTION(name, type) \
+    static void name##_elems(void *base, size_t nelems) { name((type *) base, nelems); }
+
+TYPED_SORT_FUNCTION(merge_sort_u32, uint32_t)
+TYPED_SORT_FUNCTION(merge_sort_u64, uint64_t)
+TYPED_SORT_FUNCTION(quicksort_u32, uint32_t)
+TYPED_SORT_FUNCTION(quicksort_u64, uint64_t)
+
+/*
+ * The double sorts are run on the keys converted to doubles relative to the
+ * first key, which becomes 0.0 and -0.0 in turn, with the largest key as NaN
+ * and -NaN in turn, which sort after everything else. The sorted doubles are
+ * converted back to the keys for the check.
+ */
+static void f64_sort_elems(void *base, size_t nelems, void (*sort)(double *base, size_t nelems))
+{
+    char *array = base;
+    if (nelems == 0) {
+        return;
+    }
+    elem_t zero_key, max_key;
+    memcpy(&zero_key, array, sizeof(elem_t));
+    max_key = zero_key;
+    for (size_t i = 0; i < nelems; i++) {
+        elem_t key;
+        memcpy(&key, array + i * sizeof(double), sizeof(elem_t));
+        max_key = key > max_key ? key : max_key;
+    }
+    for (size_t i = 0; i < nelems; i++) {
+        elem_t key;
+        memcpy(&key, array + i * sizeof(double), sizeof(elem_t));
+        double value;
+        if (key == max_key) {
+            value = i % 2 ? NAN : -NAN;
+        } else if (key == zero_key) {
+            value = i % 2 ? 0.0 : -0.0;
+        } else {
+            value = (double) key - (double) zero_key;
+        }
+        memcpy(array + i * sizeof(double), &value, sizeof(double));
+    }
+    sort((double *) base, nelems);
+    for (size_t i = 0; i < nelems; i++) {
+        double value;
+        memcpy(&value, array + i * sizeof(double), sizeof(double));
+        elem_t key = isnan(value) ? max_key : (elem_t) (value + (double) zero_key);
+        memset(array + i * sizeof(double), 0, sizeof(double));
+        memcpy(array + i * sizeof(double), &key, sizeof(elem_t));
+    }
+}
+
+#define F64_SORT_FUNCTION(name) \
+    static void name##_elems(void *base, size_t nelems) { f64_sort_elems(base, nelems, name); }
+
+F64_SORT_FUNCTION(merge_sort_f64)
+F64_SORT_FUNCTION(quicksort_f64)
+
+/* The radix sorts take the key location (or a function returning the key) instead of a comparison function */
+static uint64_t elem_key(const void *elem, void *context)
+{
+    (void) context;
+    elem_t key;
+    memcpy(&key, elem, sizeof(key));
+    return key;
+}
+
+static void radix_sort_elems(void *base, size_t nelems, size_t size)
+{
+    radix_sort(base, nelems, size, 0, sizeof(elem_t));
+}
+
+/* With an 8-byte key radix_sort_fn uses MSD radix sort from MSD_MIN_NELEMS (65536) elements and LSD below that */
+static void radix_sort_fn_elems(void *base, size_t nelems, size_t size)
+{
+    radix_sort_fn(base, nelems, size, elem_key, NULL, sizeof(uint64_t));
+}
+
+static void radix_sort_lsd_elems(void *base, size_t nelems, size_t size)
+{
+    radix_sort_lsd(base, nelems, size, 0, sizeof(elem_t));
+}
+
+static void radix_sort_msd_elems(void *base, size_t nelems, size_t size)
+{
+    radix_sort_msd(base, nelems, size, 0, sizeof(elem_t));
+}
+
+static void radix_sort_lsd_fn_elems(void *base, size_t nelems, size_t size)
+{
+    radix_sort_lsd_fn(base, nelems, size, elem_key, NULL, sizeof(elem_t));
+}
+
+static void radix_sort_msd_fn_elems(void *base, size_t nelems, size_t size)
+{
+    radix_sort_msd_fn(base, nelems, size, elem_key, NULL, sizeof(elem_t));
+}
+
+/*
+ * The 32-bit prefix is the key without its low 8 bits so that nearby keys tie and
+ * fall back to the comparison, the 64-bit prefix is the whole key.
+ */
+static uint64_t elem_key_prefix(const void *elem, void *context)
+{
+    return elem_key(elem, context) >> 8;
+}
+
+static void merge_sort_indexed_prefix32(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context)
+{
+    merge_sort_indexed_prefix(base, nelems, size, compare, context, elem_key_prefix, sizeof(uint32_t));
+}
+
+static void merge_sort_indexed_prefix64(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context)
+{
+    merge_sort_indexed_prefix(base, nelems, size, compare, context, elem_key, sizeof(uint64_t));
+}
+
+static void merge_sort_indexed_prefix_with_workspace(void *base, size_t nelems, size_t size, compare_fn_t compare, void *context)
+{
+    merge_sort_indexed_prefix_ws(base, nelems, size, compare, context, elem_key, sizeof(uint64_t), get_workspace());
+}
+
 static const sort_fn_t sort_functions[] = {
     /* system-provided sort functions */
     {"qsort", SORT_FN_VOID_NO_CONTEXT, {.void_no_context = qsort}, .perf = PERF_FAST},
 #if defined(LIBBSD_OVERLAY) || defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__) || defined(__DragonFly__)
-    {"mergesort", SORT_FN_INT_NO_CONTEXT, {.int_no_context = mergesort}, .perf = PERF_FAST},
+    {"mergesort", SORT_FN_INT_NO_CONTEXT, {.int_no_context = mergesort}, .perf = PERF_FAST, .stable = true},
     {"heapsort", SORT_FN_INT_NO_CONTEXT, {.int_no_context = heapsort}, .perf = PERF_MID},
 #endif
 #if defined(__APPLE__)
     {"psort", SORT_FN_VOID_NO_CONTEXT, {.void_no_context = psort}, .perf = PERF_FAST},
 #endif
     /* our implementations */
-    {"merge_sort", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = merge_sort}, .perf = PERF_FAST},
-    {"merge_sort_ptr", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = merge_sort_ptr}, .perf = PERF_FAST},
-    {"merge_sort_indexed", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = merge_sort_indexed}, .perf = PERF_FAST},
-    {"insertion_sort", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = insertion_sort}, .perf = PERF_SLOW},
-    {"insertion_sort_v2", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = insertion_sort_v2}, .perf = PERF_SLOW},
-    {"selection_sort", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = selection_sort}, .perf = PERF_SLOW},
-    {"minmax_selection_sort", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = minmax_selection_sort}, .perf = PERF_SLOW},
+    {"merge_sort", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = merge_sort}, .perf = PERF_FAST, .stable = true, .counts_moves = true},
+    {"merge_sort_bottom_up", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = merge_sort_bottom_up}, .perf = PERF_FAST, .stable = true, .counts_moves = true},
+    {"merge_sort_parallel", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = merge_sort_parallel_with_thread_count}, .perf = PERF_FAST, .stable = true, .counts_moves = true},
+    {"merge_sort_ptr", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = merge_sort_ptr}, .perf = PERF_FAST, .stable = true, .counts_moves = true},
+    {"merge_sort_indexed", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = merge_sort_indexed}, .perf = PERF_FAST, .stable = true, .counts_moves = true},
+    {"merge_sort_indexed_prefix32", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = merge_sort_indexed_prefix32}, .perf = PERF_FAST, .stable = true, .counts_moves = true},
+    {"merge_sort_indexed_prefix64", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = merge_sort_indexed_prefix64}, .perf = PERF_FAST, .stable = true, .counts_moves = true},
+    {"merge_sort_ptr_out", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = merge_sort_ptr_with_out}, .perf = PERF_FAST, .stable = true, .counts_moves = true},
+    {"merge_sort_indexed_out", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = merge_sort_indexed_with_out}, .perf = PERF_FAST, .stable = true, .counts_moves = true},
+    {"block_merge_sort", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = block_merge_sort}, .perf = PERF_FAST, .stable = true, .counts_moves = true},
+    {"block_merge_sort_sqrt_buffer", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = block_merge_sort_sqrt_buffer}, .perf = PERF_FAST, .stable = true, .counts_moves = true},
+    {"block_merge_sort_half_buffer", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = block_merge_sort_half_buffer}, .perf = PERF_FAST, .stable = true, .counts_moves = true},
+    {"argsort", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = argsort_and_apply}, .perf = PERF_FAST, .stable = true},
+    {"argsort_unstable", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = argsort_unstable_and_apply}, .perf = PERF_FAST},
+    {"sort_auto", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = sort_auto_stable}, .perf = PERF_FAST, .stable = true},
+    {"sort_auto_unstable", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = sort_auto_unstable}, .perf = PERF_FAST},
+    {"sort_auto_low_memory", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = sort_auto_low_memory}, .perf = PERF_FAST, .stable = true},
+    {"sort_auto_in_place", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = sort_auto_in_place}, .perf = PERF_FAST, .stable = true},
+    {"kv_sort", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = kv_sort_split}, .perf = PERF_FAST, .stable = true, .counts_moves = true},
+    {"kv_sort_lockstep", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = kv_sort_lockstep_split}, .perf = PERF_FAST, .stable = true, .counts_moves = true},
+    {"kv_sort_gather", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = kv_sort_gather_split}, .perf = PERF_FAST, .stable = true, .counts_moves = true},
+    {"merge_batch", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = merge_batch_all}, .perf = PERF_MID, .stable = true, .counts_moves = true},
+    {"merge_batch_ws", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = merge_batch_all_with_workspace}, .perf = PERF_MID, .stable = true, .counts_moves = true},
+    {"merge_k", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = merge_k_sorted_runs}, .perf = PERF_FAST, .stable = true, .counts_moves = true},
+    {"merge_sort_ws", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = merge_sort_with_workspace}, .perf = PERF_FAST, .stable = true, .counts_moves = true},
+    {"merge_sort_ptr_ws", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = merge_sort_ptr_with_workspace}, .perf = PERF_FAST, .stable = true, .counts_moves = true},
+    {"merge_sort_indexed_ws", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = merge_sort_indexed_with_workspace}, .perf = PERF_FAST, .stable = true, .counts_moves = true},
+    {"merge_sort_indexed_prefix_ws", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = merge_sort_indexed_prefix_with_workspace}, .perf = PERF_FAST, .stable = true, .counts_moves = true},
+    {"merge_sort_u32", SORT_FN_VOID_TYPED, {.void_typed = merge_sort_u32_elems}, .perf = PERF_FAST, .elem_size = sizeof(uint32_t)},
+    {"merge_sort_u64", SORT_FN_VOID_TYPED, {.void_typed = merge_sort_u64_elems}, .perf = PERF_FAST, .elem_size = sizeof(uint64_t)},
+    {"quicksort_u32", SORT_FN_VOID_TYPED, {.void_typed = quicksort_u32_elems}, .perf = PERF_FAST, .elem_size = sizeof(uint32_t)},
+    {"quicksort_u64", SORT_FN_VOID_TYPED, {.void_typed = quicksort_u64_elems}, .perf = PERF_FAST, .elem_size = sizeof(uint64_t)},
+    {"merge_sort_f64", SORT_FN_VOID_TYPED, {.void_typed = merge_sort_f64_elems}, .perf = PERF_FAST, .elem_size = sizeof(double)},
+    {"quicksort_f64", SORT_FN_VOID_TYPED, {.void_typed = quicksort_f64_elems}, .perf = PERF_FAST, .elem_size = sizeof(double)},
+    {"pdq_sort", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = pdq_sort}, .perf = PERF_FAST, .counts_moves = true},
+    {"pdq_sort_branchless", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = pdq_sort_branchless}, .perf = PERF_FAST, .counts_moves = true},
+    {"radix_sort", SORT_FN_VOID_KEYED, {.void_keyed = radix_sort_elems}, .perf = PERF_FAST, .counts_moves = true},
+    {"radix_sort_fn", SORT_FN_VOID_KEYED, {.void_keyed = radix_sort_fn_elems}, .perf = PERF_FAST, .counts_moves = true},
+    {"radix_sort_lsd", SORT_FN_VOID_KEYED, {.void_keyed = radix_sort_lsd_elems}, .perf = PERF_FAST, .stable = true, .counts_moves = true},
+    {"radix_sort_msd", SORT_FN_VOID_KEYED, {.void_keyed = radix_sort_msd_elems}, .perf = PERF_FAST, .counts_moves = true},
+    {"radix_sort_lsd_fn", SORT_FN_VOID_KEYED, {.void_keyed = radix_sort_lsd_fn_elems}, .perf = PERF_FAST, .stable = true, .counts_moves = true},
+    {"radix_sort_msd_fn", SORT_FN_VOID_KEYED, {.void_keyed = radix_sort_msd_fn_elems}, .perf = PERF_FAST, .counts_moves = true},
+    {"insertion_sort", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = insertion_sort}, .perf = PERF_SLOW, .stable = true, .counts_moves = true},
+    {"insertion_sort_v2", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = insertion_sort_v2}, .perf = PERF_SLOW, .stable = true},
+    {"selection_sort", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = selection_sort}, .perf = PERF_SLOW, .counts_moves = true},
+    {"minmax_selection_sort", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = minmax_selection_sort}, .perf = PERF_SLOW, .counts_moves = true},
     /* third-party sort functions */
     {"bentley_mcilroy_quicksort", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = bentley_mcilroy_quicksort}, .perf = PERF_FAST},
     {"ochs_smoothsort", SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.void_compare_with_context_last_then_context = ochs_smoothsort}, .perf = PERF_FAST},
-    {"timsort", SORT_FN_INT_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.int_compare_with_context_last_then_context = timsort_r}, .perf = PERF_FAST},
+    {"timsort", SORT_FN_INT_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.int_compare_with_context_last_then_context = timsort_r}, .perf = PERF_FAST, .stable = true},
     {"bsd_heapsort", SORT_FN_INT_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.int_compare_with_context_last_then_context = bsd_heapsort}, .perf = PERF_FAST},
-    {"bsd_mergesort", SORT_FN_INT_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.int_compare_with_context_last_then_context = bsd_mergesort}, .perf = PERF_FAST},
+    {"bsd_mergesort", SORT_FN_INT_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.int_compare_with_context_last_then_context = bsd_mergesort}, .perf = PERF_FAST, .stable = true},
+    {"timsort_ws", SORT_FN_INT_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.int_compare_with_context_last_then_context = timsort_r_with_workspace}, .perf = PERF_FAST, .stable = true},
+    {"timsort_powersort", SORT_FN_INT_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.int_compare_with_context_last_then_context = timsort_r_powersort}, .perf = PERF_FAST, .stable = true},
+    {"timsort_parallel", SORT_FN_INT_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.int_compare_with_context_last_then_context = timsort_parallel_with_thread_count}, .perf = PERF_FAST, .stable = true},
+    {"bsd_heapsort_ws", SORT_FN_INT_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.int_compare_with_context_last_then_context = bsd_heapsort_with_workspace}, .perf = PERF_FAST},
+    {"bsd_mergesort_ws", SORT_FN_INT_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.int_compare_with_context_last_then_context = bsd_mergesort_with_workspace}, .perf = PERF_FAST, .stable = true},
+#if !defined(_WIN32)
+    {"external_sort", SORT_FN_INT_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT, {.int_compare_with_context_last_then_context = external_sort_with_memory_limit}, .perf = PERF_MID, .stable = true},
+#endif
 };
 
 static int compare_elem(const void *a_ptr, const void *b_ptr)
@@ -112,6 +577,19 @@ static int compare_elem(const void *a_ptr, const void *b_ptr)
     return (a > b) - (a < b);
 }
 
+/* Orders elements by key and then by their index in the input (see array_set_indices) */
+static int compare_elem_then_index(const void *a_ptr, const void *b_ptr)
+{
+    int result = compare_elem(a_ptr, b_ptr);
+    if (result == 0) {
+        elem_t a, b;
+        memcpy(&a, (const char *) a_ptr + sizeof(elem_t), sizeof(a));
+        memcpy(&b, (const char *) b_ptr + sizeof(elem_t), sizeof(b));
+        result = (a > b) - (a < b);
+    }
+    return result;
+}
+
 static int compare_elem_with_context(void *context, const void *a_ptr, const void *b_ptr)
 {
     (void) context;
@@ -124,30 +602,76 @@ static int compare_elem_with_context_last(const void *a_ptr, const void *b_ptr,
     return compare_elem(a_ptr, b_ptr);
 }
 
-static int call_sort_function(const sort_fn_t *sort, void *base, size_t nelems, size_t size, void *context)
+/*
+ * Counting comparators, used when checking a sort in benchmark mode. The
+ * count is passed as the comparator context, except to the sorts that don't
+ * take a context.
+ */
+static atomic_uint_least64_t comparison_count;
+
+static int compare_elem_counting(const void *a_ptr, const void *b_ptr)
+{
+    atomic_fetch_add_explicit(&comparison_count, 1, memory_order_relaxed);
+    return compare_elem(a_ptr, b_ptr);
+}
+
+static int compare_elem_with_context_counting(void *context, const void *a_ptr, const void *b_ptr)
+{
+    atomic_fetch_add_explicit((atomic_uint_least64_t *) context, 1, memory_order_relaxed);
+    return compare_elem(a_ptr, b_ptr);
+}
+
+static int compare_elem_with_context_last_counting(const void *a_ptr, const void *b_ptr, void *context)
+{
+    atomic_fetch_add_explicit((atomic_uint_least64_t *) context, 1, memory_order_relaxed);
+    return compare_elem(a_ptr, b_ptr);
+}
+
+struct comparators {
+    compare_without_context_fn_t no_context;
+    compare_with_context_first_fn_t context_first;
+    compare_with_context_last_fn_t context_last;
+};
+
+static const struct comparators plain_comparators = {
+    compare_elem, compare_elem_with_context, compare_elem_with_context_last,
+};
+
+static const struct comparators counting_comparators = {
+    compare_elem_counting, compare_elem_with_context_counting, compare_elem_with_context_last_counting,
+};
+
+static int call_sort_function(const sort_fn_t *sort, void *base, size_t nelems, size_t size, const struct comparators *compare, void *context)
 {
     int result = 0;
     switch (sort->type) {
         case SORT_FN_VOID_NO_CONTEXT:
-            sort->fn.void_no_context(base, nelems, size, compare_elem);
+            sort->fn.void_no_context(base, nelems, size, compare->no_context);
             break;
         case SORT_FN_INT_NO_CONTEXT:
-            result = sort->fn.int_no_context(base, nelems, size, compare_elem);
+            result = sort->fn.int_no_context(base, nelems, size, compare->no_context);
             break;
         case SORT_FN_VOID_COMPARE_WITH_CONTEXT_FIRST_THEN_CONTEXT:
-            sort->fn.void_compare_with_context_first_then_context(base, nelems, size, compare_elem_with_context, context);
+            sort->fn.void_compare_with_context_first_then_context(base, nelems, size, compare->context_first, context);
             break;
         case SORT_FN_VOID_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT:
-            sort->fn.void_compare_with_context_last_then_context(base, nelems, size, compare_elem_with_context_last, context);
+            sort->fn.void_compare_with_context_last_then_context(base, nelems, size, compare->context_last, context);
             break;
         case SORT_FN_INT_COMPARE_WITH_CONTEXT_LAST_THEN_CONTEXT:
-            result = sort->fn.int_compare_with_context_last_then_context(base, nelems, size, compare_elem_with_context_last, context);
+            result = sort->fn.int_compare_with_context_last_then_context(base, nelems, size, compare->context_last, context);
             break;
         case SORT_FN_VOID_CONTEXT_THEN_COMPARE_WITH_CONTEXT_FIRST:
-            sort->fn.void_context_then_compare_with_context_first(base, nelems, size, context, compare_elem_with_context);
+            sort->fn.void_context_then_compare_with_context_first(base, nelems, size, context, compare->context_first);
             break;
         case SORT_FN_VOID_CONTEXT_THEN_COMPARE_WITH_CONTEXT_LAST:
-            sort->fn.void_context_then_compare_with_context_last(base, nelems, size, context, compare_elem_with_context_last);
+            sort->fn.void_context_then_compare_with_context_last(base, nelems, size, context, compare->context_last);
+            break;
+        case SORT_FN_VOID_TYPED:
+            assert(size == sort->elem_size);
+            sort->fn.void_typed(base, nelems);
+            break;
+        case SORT_FN_VOID_KEYED:
+            sort->fn.void_keyed(base, nelems, size);
             break;
         default:
             assert(0 && "unknown sort function type");
@@ -155,13 +679,54 @@ static int call_sort_function(const sort_fn_t *sort, void *base, size_t nelems,
     return result;
 }
 
+/* Starts counting comparisons, copies and allocations, keeping the current counter values in counts */
+static void op_counts_begin(struct op_counts *counts)
+{
+    atomic_store(&comparison_count, 0);
+    counts->copies = atomic_load(&instrument_counters.copies);
+    counts->bytes_copied = atomic_load(&instrument_counters.bytes_copied);
+    counts->allocations = atomic_load(&instrument_counters.allocations);
+    counts->peak_scratch_bytes = atomic_load(&instrument_counters.allocated_bytes);
+    instrument_reset_peak();
+}
+
+/* Replaces the counter values saved by op_counts_begin with the counts since then */
+static void op_counts_end(struct op_counts *counts, bool has_comparisons, bool has_copies)
+{
+    counts->comparisons = atomic_load(&comparison_count);
+    counts->copies = atomic_load(&instrument_counters.copies) - counts->copies;
+    counts->bytes_copied = atomic_load(&instrument_counters.bytes_copied) - counts->bytes_copied;
+    counts->allocations = atomic_load(&instrument_counters.allocations) - counts->allocations;
+    counts->peak_scratch_bytes = atomic_load(&instrument_counters.peak_allocated_bytes) - counts->peak_scratch_bytes;
+    counts->has.comparisons = has_comparisons;
+#ifdef SORT_INSTRUMENT
+    counts->has.copies = has_copies;
+#else
+    (void) has_copies;
+    counts->has.copies = false;
+#endif
+#ifdef HAVE_MALLOC_WRAP
+    counts->has.allocations = true;
+#else
+    counts->has.allocations = false;
+#endif
+}
+
+/* Sorts the array with counting comparators, copies and allocations */
+static void call_sort_function_counting(const sort_fn_t *sort, void *base, size_t nelems, size_t size, struct op_counts *out_counts)
+{
+    op_counts_begin(out_counts);
+    call_sort_function(sort, base, nelems, size, &counting_comparators, &comparison_count);
+    op_counts_end(out_counts, sort->type != SORT_FN_VOID_TYPED && sort->type != SORT_FN_VOID_KEYED, sort->counts_moves);
+}
+
 static void print_array(char *array, size_t nelems, size_t size)
 {
     printf("[\n");
     for (size_t i = 0; i < nelems; i++) {
-        size_t key;
-        memcpy(&key, array + i * size, sizeof(size_t));
-        printf("  %zu", key);
+        elem_t key;
+        memcpy(&key, array + i * size, sizeof(elem_t));
+        printf("  %" PRIu32, key);
         if (i < nelems - 1) {
             printf(",\n");
         }
@@ -169,32 +734,201 @@ static void print_array(char *array, size_t nelems, size_t size)
     printf("\n]\n");
 }
 
-static bool test_sort(void *array, size_t size, size_t nelems, const sort_fn_t *sort, const char *test_name, clock_t *out_time)
+/*
+ * Elements with room for it after the key hold their index in the input, so that the check can tell equal
+ * elements apart. Not for the typed sorts, which compare whole elements.
+ */
+static bool has_index(size_t size, const sort_fn_t *sort)
+{
+    return size >= 2 * sizeof(elem_t) && sort->type != SORT_FN_VOID_TYPED;
+}
+
+static void array_set_indices(char *array, elem_t array_size, size_t elem_size, const sort_fn_t *sort)
+{
+    if (has_index(elem_size, sort)) {
+        for (elem_t i = 0; i < array_size; i++) {
+            memcpy(array + i * elem_size + sizeof(elem_t), &i, sizeof(elem_t));
+        }
+    }
+}
+
+/* Checks the sort against qsort. If out_counts is given the sort is instrumented, otherwise it's timed. */
+static bool test_sort(const void *array, size_t size, size_t nelems, const sort_fn_t *sort, const char *pattern_name, uint64_t *out_time, struct op_counts *out_counts)
 {
-    printf("\r\x1b[K> Testing %s...", test_name);
-    fflush(stdout);
-    void *array_copy_test = calloc(nelems, size);
-    void *array_copy_check = calloc(nelems, size);
+    if (output_format == OUTPUT_TEXT) {
+        printf("\r\x1b[K> Testing %s array...", pattern_name);
+        fflush(stdout);
+    }
+    void *array_copy_test = malloc(nelems * size);
+    void *array_copy_check = malloc(nelems * size);
     memcpy(array_copy_test, array, nelems * size);
     memcpy(array_copy_check, array, nelems * size);
-    clock_t start_time = clock();
-    call_sort_function(sort, array_copy_test, nelems, size, NULL);
-    *out_time = clock() - start_time;
-    qsort(array_copy_check, nelems, size, compare_elem);
-    bool result = (memcmp(array_copy_test, array_copy_check, nelems * size) == 0);
+    if (out_counts) {
+        call_sort_function_counting(sort, array_copy_test, nelems, size, out_counts);
+        *out_time = 0;
+    } else {
+        uint64_t start_time = monotonic_time_ns();
+        call_sort_function(sort, array_copy_test, nelems, size, &plain_comparators, NULL);
+        *out_time = monotonic_time_ns() - start_time;
+    }
+    bool result;
+    if (has_index(size, sort)) {
+        /* Equal keys must be in input order for stable sorts, and in any order of the same elements otherwise */
+        qsort(array_copy_check, nelems, size, compare_elem_then_index);
+        result = true;
+        for (size_t i = 0; i < nelems && result; i++) {
+            result = compare_elem((char *) array_copy_test + i * size, (char *) array_copy_check + i * size) == 0;
+        }
+        if (result && !sort->stable) {
+            qsort(array_copy_test, nelems, size, compare_elem_then_index);
+        }
+        if (result && memcmp(array_copy_test, array_copy_check, nelems * size) != 0) {
+            printf("\n%s\n", sort->stable ? "Equal elements are out of input order." : "Elements were lost or changed.");
+            result = false;
+        }
+    } else {
+        qsort(array_copy_check, nelems, size, compare_elem);
+        result = (memcmp(array_copy_test, array_copy_check, nelems * size) == 0);
+    }
     if (!result) {
         printf("\nArray after sort:\n");
         print_array(array_copy_test, nelems, size);
-        printf("Test '%s' failed for sort function %s!\n", test_name, sort->name);
+        printf("Test '%s array' failed for sort function %s!\n", pattern_name, sort->name);
     }
     free(array_copy_test);
     free(array_copy_check);
-    if (result) {
+    if (result && output_format == OUTPUT_TEXT) {
         printf("\r\x1b[K");
     }
     return result;
 }
 
+static int compare_uint64(const void *a_ptr, const void *b_ptr)
+{
+    uint64_t a = *(const uint64_t *) a_ptr;
+    uint64_t b = *(const uint64_t *) b_ptr;
+    return (a > b) - (a < b);
+}
+
+/* Sorts the bench_reps timing samples and returns the minimum, median and 95th percentile */
+static struct bench_result bench_summary(uint64_t *samples)
+{
+    struct bench_result result;
+    qsort(samples, bench_reps, sizeof(uint64_t), compare_uint64);
+    size_t middle = bench_reps / 2;
+    result.min_ns = samples[0];
+    result.median_ns = bench_reps % 2 ? samples[middle] : (samples[middle - 1] + samples[middle]) / 2;
+    result.p95_ns = samples[((size_t) bench_reps * 95 + 99) / 100 - 1]; /* nearest rank */
+    return result;
+}
+
+/* Times bench_reps sorts of copies of the array after bench_warmup untimed sorts. Only the sort itself is timed. */
+static struct bench_result bench_sort(const void *array, size_t size, size_t nelems, const sort_fn_t *sort)
+{
+    uint64_t *samples = malloc(bench_reps * sizeof(uint64_t));
+    void *array_copy = malloc(nelems * size);
+    for (unsigned i = 0; i < bench_warmup + bench_reps; i++) {
+        memcpy(array_copy, array, nelems * size);
+        uint64_t start_time = monotonic_time_ns();
+        call_sort_function(sort, array_copy, nelems, size, &plain_comparators, NULL);
+        uint64_t elapsed = monotonic_time_ns() - start_time;
+        if (i >= bench_warmup) {
+            samples[i - bench_warmup] = elapsed;
+        }
+    }
+    struct bench_result result = bench_summary(samples);
+    free(array_copy);
+    free(samples);
+    return result;
+}
+
+static void print_bench_header(void)
+{
+    if (output_format == OUTPUT_CSV) {
+        printf("function,pattern,nelems,elem_size,warmup,reps,min_ns,median_ns,p95_ns,ns_per_elem,"
+            "comparisons,moves,bytes_copied,allocations,peak_scratch_bytes\n");
+    } else if (output_format == OUTPUT_JSON) {
+        printf("[");
+    }
+}
+
+static void print_bench_footer(void)
+{
+    if (output_format == OUTPUT_JSON) {
+        printf("\n]\n");
+    }
+}
+
+/* Prints a counter, or the placeholder if it wasn't available */
+static void print_count(bool has_count, uint64_t count, const char *placeholder)
+{
+    if (has_count) {
+        printf("%" PRIu64, count);
+    } else {
+        printf("%s", placeholder);
+    }
+}
+
+static void print_bench_result(const char *function_name, const char *pattern_name, size_t nelems, size_t size, const struct bench_result *result)
+{
+    const struct op_counts *counts = &result->counts;
+    double ns_per_elem = (double) result->median_ns / (double) nelems;
+    /* Element moves are counted as bytes copied divided by the element size */
+    uint64_t moves = counts->bytes_copied / size;
+    const char *placeholder = output_format == OUTPUT_TEXT ? "-" : output_format == OUTPUT_JSON ? "null" : "";
+    switch (output_format) {
+        case OUTPUT_TEXT:
+            printf("  %-26s min %10.3f ms  median %10.3f ms  p95 %10.3f ms  %8.2f ns/elem\n",
+                pattern_name, (double) result->min_ns / 1e6, (double) result->median_ns / 1e6,
+                (double) result->p95_ns / 1e6, ns_per_elem);
+            printf("  %-26s comparisons ", "");
+            print_count(counts->has.comparisons, counts->comparisons, placeholder);
+            printf("  moves ");
+            print_count(counts->has.copies, moves, placeholder);
+            printf("  bytes copied ");
+            print_count(counts->has.copies, counts->bytes_copied, placeholder);
+            printf("  allocations ");
+            print_count(counts->has.allocations, counts->allocations, placeholder);
+            printf("  peak scratch bytes ");
+            print_count(counts->has.allocations, counts->peak_scratch_bytes, placeholder);
+            printf("\n");
+            break;
+        case OUTPUT_CSV:
+            printf("%s,%s,%zu,%zu,%u,%u,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%.3f,",
+                function_name, pattern_name, nelems, size, bench_warmup, bench_reps,
+                result->min_ns, result->median_ns, result->p95_ns, ns_per_elem);
+            print_count(counts->has.comparisons, counts->comparisons, placeholder);
+            printf(",");
+            print_count(counts->has.copies, moves, placeholder);
+            printf(",");
+            print_count(counts->has.copies, counts->bytes_copied, placeholder);
+            printf(",");
+            print_count(counts->has.allocations, counts->allocations, placeholder);
+            printf(",");
+            print_count(counts->has.allocations, counts->peak_scratch_bytes, placeholder);
+            printf("\n");
+            break;
+        case OUTPUT_JSON:
+            printf("%s\n  {\"function\": \"%s\", \"pattern\": \"%s\", \"nelems\": %zu, \"elem_size\": %zu, "
+                "\"warmup\": %u, \"reps\": %u, \"min_ns\": %" PRIu64 ", \"median_ns\": %" PRIu64 ", "
+                "\"p95_ns\": %" PRIu64 ", \"ns_per_elem\": %.3f, \"comparisons\": ",
+                json_first_record ? "" : ",", function_name, pattern_name, nelems, size, bench_warmup, bench_reps,
+                result->min_ns, result->median_ns, result->p95_ns, ns_per_elem);
+            print_count(counts->has.comparisons, counts->comparisons, placeholder);
+            printf(", \"moves\": ");
+            print_count(counts->has.copies, moves, placeholder);
+            printf(", \"bytes_copied\": ");
+            print_count(counts->has.copies, counts->bytes_copied, placeholder);
+            printf(", \"allocations\": ");
+            print_count(counts->has.allocations, counts->allocations, placeholder);
+            printf(", \"peak_scratch_bytes\": ");
+            print_count(counts->has.allocations, counts->peak_scratch_bytes, placeholder);
+            printf("}");
+            json_first_record = false;
+            break;
+    }
+}
+
 // LCG algorithm
 typedef uint32_t random_seed_t;
 static inline uint32_t random_uint32(random_seed_t *seed)
@@ -244,142 +978,1218 @@ static void array_random_shuffle(char *array, size_t array_size, size_t elem_siz
     }
 }
 
-static bool test_ascending_array(const sort_fn_t *sort, elem_t array_size, size_t elem_size, clock_t *out_time)
+/*
+ * Fills the array with a test pattern. The sort is only used by the adversarial
+ * patterns that depend on how it compares elements. Returns false if the
+ * pattern can't be generated for this sort.
+ */
+typedef bool (*pattern_init_fn_t)(char *array, elem_t array_size, size_t elem_size, random_seed_t *seed, const sort_fn_t *sort);
+
+static bool pattern_ascending(char *array, elem_t array_size, size_t elem_size, random_seed_t *seed, const sort_fn_t *sort)
 {
-    char *array = calloc(array_size, elem_size);
+    (void) sort;
+    (void) seed;
     array_init_ascending(array, array_size, elem_size);
-    bool result = test_sort(array, elem_size, array_size, sort, "ascending array", out_time);
-    free(array);
-    return result;
+    return true;
 }
 
-static bool test_mostly_ascending_array(const sort_fn_t *sort, elem_t array_size, size_t elem_size, random_seed_t *seed, clock_t *out_time)
+static bool pattern_mostly_ascending(char *array, elem_t array_size, size_t elem_size, random_seed_t *seed, const sort_fn_t *sort)
 {
-    char *array = calloc(array_size, elem_size);
+    (void) sort;
     array_init_ascending(array, array_size, elem_size);
     for (size_t i = 0; i < array_size / 10; i++) {
         size_t j = random_uint32(seed) % array_size;
         array_swap(array, elem_size, i, j);
     }
-    bool result = test_sort(array, elem_size, array_size, sort, "mostly ascending array", out_time);
-    free(array);
-    return result;
+    return true;
 }
 
-static bool test_descending_array(const sort_fn_t *sort, elem_t array_size, size_t elem_size, clock_t *out_time)
+static bool pattern_descending(char *array, elem_t array_size, size_t elem_size, random_seed_t *seed, const sort_fn_t *sort)
 {
-    char *array = calloc(array_size, elem_size);
+    (void) sort;
+    (void) seed;
     array_init_descending(array, array_size, elem_size);
-    bool result = test_sort(array, elem_size, array_size, sort, "descending array", out_time);
-    free(array);
-    return result;
+    return true;
 }
 
-static bool test_ascending_then_descending_array(const sort_fn_t *sort, elem_t array_size, size_t elem_size, clock_t *out_time)
+static bool pattern_ascending_then_descending(char *array, elem_t array_size, size_t elem_size, random_seed_t *seed, const sort_fn_t *sort)
 {
-    char *array = calloc(array_size, elem_size);
+    (void) sort;
+    (void) seed;
     elem_t middle = array_size / 2;
     array_init_ascending(array, middle, elem_size);
     array_init_descending(array + middle * elem_size, array_size - middle, elem_size);
-    bool result = test_sort(array, elem_size, array_size, sort, "ascending then descending array", out_time);
-    free(array);
-    return result;
+    return true;
 }
 
-static bool test_sawtooth_array(const sort_fn_t *sort, elem_t array_size, size_t elem_size, clock_t *out_time)
+static bool pattern_sawtooth(char *array, elem_t array_size, size_t elem_size, random_seed_t *seed, const sort_fn_t *sort)
 {
-    char *array = calloc(array_size, elem_size);
+    (void) sort;
+    (void) seed;
     elem_t segment_size = 10;
     for (elem_t i = 0; i < array_size; i += segment_size) {
         elem_t current_segment_size = (i + segment_size <= array_size) ? segment_size : (array_size - i);
         array_init_ascending(array + i * elem_size, current_segment_size, elem_size);
     }
-    bool result = test_sort(array, elem_size, array_size, sort, "sawtooth array", out_time);
-    free(array);
-    return result;
+    return true;
 }
 
-static bool test_reverse_sawtooth_array(const sort_fn_t *sort, elem_t array_size, size_t elem_size, clock_t *out_time)
+static bool pattern_reverse_sawtooth(char *array, elem_t array_size, size_t elem_size, random_seed_t *seed, const sort_fn_t *sort)
 {
-    char *array = calloc(array_size, elem_size);
+    (void) sort;
+    (void) seed;
     elem_t segment_size = 10;
     for (elem_t i = 0; i < array_size; i += segment_size) {
         elem_t current_segment_size = (i + segment_size <= array_size) ? segment_size : (array_size - i);
         array_init_descending(array + i * elem_size, current_segment_size, elem_size);
     }
-    bool result = test_sort(array, elem_size, array_size, sort, "reverse sawtooth array", out_time);
-    free(array);
-    return result;
+    return true;
 }
 
-static bool test_random_array(const sort_fn_t *sort, elem_t array_size, size_t elem_size, random_seed_t *seed, clock_t *out_time)
+static bool pattern_random(char *array, elem_t array_size, size_t elem_size, random_seed_t *seed, const sort_fn_t *sort)
 {
-    char *array = calloc(array_size, elem_size);
+    (void) sort;
     array_init_ascending(array, array_size, elem_size);
     array_random_shuffle(array, array_size, elem_size, seed);
-    bool result = test_sort(array, elem_size, array_size, sort, "random array", out_time);
-    free(array);
-    return result;
+    return true;
 }
 
-static bool run_tests(const sort_fn_t *sort, random_seed_t seed, elem_t array_size, size_t elem_size)
+
+static void array_set_key(char *array, size_t elem_size, size_t i, elem_t key)
 {
-    printf("Testing sort function: %s\n", sort->name);
+    memcpy(array + i * elem_size, &key, sizeof(elem_t));
+}
 
-    clock_t total_time = 0;
-    clock_t time = 0;
+/* Only a few distinct keys, in random order */
+static bool pattern_few_unique(char *array, elem_t array_size, size_t elem_size, random_seed_t *seed, const sort_fn_t *sort)
+{
+    (void) sort;
+    for (elem_t i = 0; i < array_size; i++) {
+        array_set_key(array, elem_size, i, random_uint32(seed) % 16);
+    }
+    return true;
+}
 
-    if (!test_ascending_array(sort, array_size, elem_size, &time)) {
-        return false;
+static bool pattern_all_equal(char *array, elem_t array_size, size_t elem_size, random_seed_t *seed, const sort_fn_t *sort)
+{
+    (void) seed;
+    (void) sort;
+    for (elem_t i = 0; i < array_size; i++) {
+        array_set_key(array, elem_size, i, 42);
     }
-    total_time += time;
-    if (!test_mostly_ascending_array(sort, array_size, elem_size, &seed, &time)) {
-        return false;
+    return true;
+}
+
+/*
+ * Keys drawn from a Zipf distribution (exponent 1) over array_size ranks, so
+ * a few keys are very common and most are rare. The ranks are scrambled with a
+ * multiplicative hash so the common keys aren't all the smallest.
+ */
+static bool pattern_zipf(char *array, elem_t array_size, size_t elem_size, random_seed_t *seed, const sort_fn_t *sort)
+{
+    (void) sort;
+    double *cumulative = malloc(array_size * sizeof(double));
+    double total = 0.0;
+    for (elem_t rank = 0; rank < array_size; rank++) {
+        total += 1.0 / ((double) rank + 1.0);
+        cumulative[rank] = total;
     }
-    total_time += time;
-    if (!test_descending_array(sort, array_size, elem_size, &time)) {
-        return false;
+    for (elem_t i = 0; i < array_size; i++) {
+        double target = (double) random_uint32(seed) / 4294967296.0 * total;
+        elem_t lo = 0, hi = array_size - 1;
+        while (lo < hi) {
+            elem_t mid = lo + (hi - lo) / 2;
+            if (cumulative[mid] <= target) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        array_set_key(array, elem_size, i, (elem_t) (lo * UINT32_C(2654435761)));
     }
-    total_time += time;
-    if (!test_ascending_then_descending_array(sort, array_size, elem_size, &time)) {
-        return false;
+    free(cumulative);
+    return true;
+}
+
+/* Ascending runs of random length (up to twice the square root of the array size) of random keys */
+static bool pattern_random_runs(char *array, elem_t array_size, size_t elem_size, random_seed_t *seed, const sort_fn_t *sort)
+{
+    (void) sort;
+    elem_t max_run = 2;
+    while ((uint64_t) max_run * max_run < (uint64_t) array_size * 4) {
+        max_run++;
     }
-    total_time += time;
-    if (!test_sawtooth_array(sort, array_size, elem_size, &time)) {
-        return false;
+    array_init_ascending(array, array_size, elem_size);
+    array_random_shuffle(array, array_size, elem_size, seed);
+    for (elem_t start = 0; start < array_size;) {
+        elem_t run = 1 + random_uint32(seed) % max_run;
+        if (run > array_size - start) {
+            run = array_size - start;
+        }
+        qsort(array + (size_t) start * elem_size, run, elem_size, compare_elem);
+        start += run;
     }
-    total_time += time;
-    if (!test_reverse_sawtooth_array(sort, array_size, elem_size, &time)) {
-        return false;
+    return true;
+}
+
+/* Sorts each run of random keys, given by their lengths, into ascending order */
+static void array_sort_runs(char *array, elem_t array_size, size_t elem_size, random_seed_t *seed, const elem_t *runs, size_t nruns)
+{
+    array_init_ascending(array, array_size, elem_size);
+    array_random_shuffle(array, array_size, elem_size, seed);
+    elem_t start = 0;
+    for (size_t i = 0; i < nruns; i++) {
+        qsort(array + (size_t) start * elem_size, runs[i], elem_size, compare_elem);
+        start += runs[i];
     }
-    total_time += time;
-    if (!test_random_array(sort, array_size, elem_size, &seed, &time)) {
-        return false;
+}
+
+/*
+ * Buss and Knop's run lengths R(n) on which the TimSort merge policy does about
+ * 1.5 times the optimal merge cost: R(n) = R(n/2), R(n/2 - 1), 1 or 2, and R(n)
+ * = n for n <= 3. Each unit is 32 elements so the runs are at least as long as
+ * timsort's minimum run.
+ */
+#define TIMSORT_DRAG_UNIT 32
+
+static size_t timsort_drag_runs(elem_t n, elem_t *runs, size_t nruns)
+{
+    if (n <= 3) {
+        runs[nruns++] = n * TIMSORT_DRAG_UNIT;
+        return nruns;
+    }
+    elem_t half = n / 2;
+    nruns = timsort_drag_runs(half, runs, nruns);
+    nruns = timsort_drag_runs(half - 1, runs, nruns);
+    runs[nruns++] = (n - 2 * half + 1) * TIMSORT_DRAG_UNIT;
+    return nruns;
+}
+
+static bool pattern_timsort_drag(char *array, elem_t array_size, size_t elem_size, random_seed_t *seed, const sort_fn_t *sort)
+{
+    (void) sort;
+    elem_t units = array_size / TIMSORT_DRAG_UNIT;
+    elem_t *runs = malloc(((size_t) units + 1) * sizeof(elem_t));
+    size_t nruns = units ? timsort_drag_runs(units, runs, 0) : 0;
+    runs[nruns++] = array_size % TIMSORT_DRAG_UNIT;
+    array_sort_runs(array, array_size, elem_size, seed, runs, nruns);
+    free(runs);
+    return true;
+}
+
+/*
+ * Runs with lengths spread evenly over the orders of magnitude from 1 to the
+ * array size (2 to the power of a random exponent), so long runs sit next to
+ * many short ones.
+ */
+static bool pattern_geometric_runs(char *array, elem_t array_size, size_t elem_size, random_seed_t *seed, const sort_fn_t *sort)
+{
+    (void) sort;
+    unsigned max_log = 0;
+    while (max_log < 31 && (UINT32_C(2) << max_log) <= array_size) {
+        max_log++;
+    }
+    elem_t *runs = malloc(array_size * sizeof(elem_t));
+    size_t nruns = 0;
+    for (elem_t start = 0; start < array_size;) {
+        elem_t run = UINT32_C(1) << (random_uint32(seed) % (max_log + 1));
+        run += random_uint32(seed) % run;
+        if (run > array_size - start) {
+            run = array_size - start;
+        }
+        runs[nruns++] = run;
+        start += run;
+    }
+    array_sort_runs(array, array_size, elem_size, seed, runs, nruns);
+    free(runs);
+    return true;
+}
+
+/* Sorted, then the largest element moved to the front */
+static bool pattern_push_front(char *array, elem_t array_size, size_t elem_size, random_seed_t *seed, const sort_fn_t *sort)
+{
+    (void) seed;
+    (void) sort;
+    for (elem_t i = 1; i < array_size; i++) {
+        array_set_key(array, elem_size, i, i - 1);
+    }
+    array_set_key(array, elem_size, 0, array_size - 1);
+    return true;
+}
+
+/* Sorted, then the smallest element moved to the back */
+static bool pattern_push_back(char *array, elem_t array_size, size_t elem_size, random_seed_t *seed, const sort_fn_t *sort)
+{
+    (void) seed;
+    (void) sort;
+    for (elem_t i = 0; i + 1 < array_size; i++) {
+        array_set_key(array, elem_size, i, i + 1);
+    }
+    array_set_key(array, elem_size, array_size - 1, 0);
+    return true;
+}
+
+/* Musser's median-of-3 killer sequence, which makes median-of-3 quicksort go quadratic */
+static bool pattern_median_of_3_killer(char *array, elem_t array_size, size_t elem_size, random_seed_t *seed, const sort_fn_t *sort)
+{
+    (void) seed;
+    (void) sort;
+    elem_t k = array_size / 2;
+    for (elem_t i = 1; i <= k; i++) {
+        if (i % 2 == 1) {
+            array_set_key(array, elem_size, i - 1, i - 1);
+            array_set_key(array, elem_size, i, k + i - 1);
+        }
+        array_set_key(array, elem_size, k + i - 1, 2 * i - 1);
+    }
+    if (array_size % 2 == 1) {
+        array_set_key(array, elem_size, array_size - 1, array_size - 1);
+    }
+    return true;
+}
+
+/*
+ * McIlroy's "A Killer Adversary for Quicksort". The sort is run on the element
+ * indices with a comparator that decides the values lazily: every element
+ * starts as "gas" (greater than every solid value), and when two gas elements
+ * are compared the one that looks like the pivot candidate is frozen to the
+ * next solid value. The values decided this way form an input that makes the
+ * sort do the same comparisons again, which is quadratic for most quicksorts.
+ */
+struct antiqsort_state {
+    elem_t *values;
+    elem_t gas;
+    elem_t nsolid;
+    elem_t candidate;
+    atomic_flag lock; /* the parallel sorts compare from several threads */
+};
+
+static struct antiqsort_state antiqsort = {.lock = ATOMIC_FLAG_INIT};
+
+static int compare_antiqsort(const void *a_ptr, const void *b_ptr)
+{
+    elem_t a, b;
+    memcpy(&a, a_ptr, sizeof(a));
+    memcpy(&b, b_ptr, sizeof(b));
+    while (atomic_flag_test_and_set_explicit(&antiqsort.lock, memory_order_acquire)) {
+    }
+    elem_t *values = antiqsort.values;
+    if (values[a] == antiqsort.gas && values[b] == antiqsort.gas) {
+        values[a == antiqsort.candidate ? a : b] = antiqsort.nsolid++;
+    }
+    if (values[a] == antiqsort.gas) {
+        antiqsort.candidate = a;
+    } else if (values[b] == antiqsort.gas) {
+        antiqsort.candidate = b;
+    }
+    int result = (values[a] > values[b]) - (values[a] < values[b]);
+    atomic_flag_clear_explicit(&antiqsort.lock, memory_order_release);
+    return result;
+}
+
+static int compare_antiqsort_with_context(void *context, const void *a_ptr, const void *b_ptr)
+{
+    (void) context;
+    return compare_antiqsort(a_ptr, b_ptr);
+}
+
+static int compare_antiqsort_with_context_last(const void *a_ptr, const void *b_ptr, void *context)
+{
+    (void) context;
+    return compare_antiqsort(a_ptr, b_ptr);
+}
+
+static const struct comparators antiqsort_comparators = {
+    compare_antiqsort, compare_antiqsort_with_context, compare_antiqsort_with_context_last,
+};
+
+static bool pattern_antiqsort(char *array, elem_t array_size, size_t elem_size, random_seed_t *seed, const sort_fn_t *sort)
+{
+    (void) seed;
+    if (!sort || sort->type == SORT_FN_VOID_TYPED || sort->type == SORT_FN_VOID_KEYED) {
+        return false; /* no comparator to drive */
+    }
+    antiqsort.values = malloc(array_size * sizeof(elem_t));
+    antiqsort.gas = array_size;
+    antiqsort.nsolid = 0;
+    antiqsort.candidate = 0;
+    for (elem_t i = 0; i < array_size; i++) {
+        antiqsort.values[i] = antiqsort.gas;
+    }
+    array_init_ascending(array, array_size, elem_size);
+    call_sort_function(sort, array, array_size, elem_size, &antiqsort_comparators, NULL);
+    for (elem_t i = 0; i < array_size; i++) {
+        elem_t value = antiqsort.values[i];
+        memset(array + (size_t) i * elem_size, 0, elem_size);
+        array_set_key(array, elem_size, i, value == antiqsort.gas ? array_size - 1 : value);
+    }
+    free(antiqsort.values);
+    antiqsort.values = NULL;
+    return true;
+}
+
+struct test_pattern {
+    const char *id; /* for the -p option */
+    const char *name;
+    pattern_init_fn_t init;
+    bool opt_in; /* adversarial patterns that are only run when selected with -p */
+};
+
+static const struct test_pattern test_patterns[] = {
+    {"ascending", "ascending", pattern_ascending},
+    {"mostly-ascending", "mostly ascending", pattern_mostly_ascending},
+    {"descending", "descending", pattern_descending},
+    {"ascending-descending", "ascending then descending", pattern_ascending_then_descending},
+    {"sawtooth", "sawtooth", pattern_sawtooth},
+    {"reverse-sawtooth", "reverse sawtooth", pattern_reverse_sawtooth},
+    {"random", "random", pattern_random},
+    {"few-unique", "few unique", pattern_few_unique},
+    {"all-equal", "all equal", pattern_all_equal},
+    {"zipf", "Zipf", pattern_zipf},
+    {"random-runs", "random runs", pattern_random_runs},
+    {"timsort-drag", "TimSort drag runs", pattern_timsort_drag},
+    {"geometric-runs", "geometric runs", pattern_geometric_runs},
+    {"push-front", "push front", pattern_push_front},
+    {"push-back", "push back", pattern_push_back},
+    {"median-of-3-killer", "median-of-3 killer", pattern_median_of_3_killer, .opt_in = true},
+    {"antiqsort", "antiqsort adversary", pattern_antiqsort, .opt_in = true},
+};
+
+/* Pattern selected with -p, NULL for all patterns that aren't opt-in, or "all" for every pattern */
+static const char *selected_pattern = NULL;
+
+static bool run_tests(const sort_fn_t *sort, random_seed_t seed, elem_t array_size, size_t elem_size)
+{
+    if (output_format == OUTPUT_TEXT) {
+        printf("%s sort function: %s\n", bench_mode ? "Benchmarking" : "Testing", sort->name);
+    }
+
+    uint64_t total_time = 0;
+
+    for (size_t i = 0; i < ARRAY_SIZE(test_patterns); i++) {
+        const struct test_pattern *pattern = &test_patterns[i];
+        if (selected_pattern ? strcmp(selected_pattern, "all") != 0 && strcmp(selected_pattern, pattern->id) != 0 : pattern->opt_in) {
+            continue;
+        }
+        char *array = calloc(array_size, elem_size);
+        uint64_t time = 0;
+        struct op_counts counts;
+        if (!pattern->init(array, array_size, elem_size, &seed, sort)) {
+            if (output_format == OUTPUT_TEXT) {
+                printf("  %-26s skipped (not applicable to this sort function)\n", pattern->name);
+            }
+            free(array);
+            continue;
+        }
+        array_set_indices(array, array_size, elem_size, sort);
+        if (!test_sort(array, elem_size, array_size, sort, pattern->name, &time, bench_mode ? &counts : NULL)) {
+            free(array);
+            return false;
+        }
+        total_time += time;
+        if (bench_mode) {
+            struct bench_result result = bench_sort(array, elem_size, array_size, sort);
+            result.counts = counts;
+            print_bench_result(sort->name, pattern->name, array_size, elem_size, &result);
+        }
+        if (sort_auto_path && output_format == OUTPUT_TEXT) {
+            printf("  %-26s sort_auto path: %s\n", pattern->name, sort_auto_path);
+        }
+        sort_auto_path = NULL;
+        free(array);
     }
-    total_time += time;
 
     // Don't print timing information in debug builds to avoid unfair comparisons
 #ifdef NDEBUG
-    double total_time_seconds = (double) total_time / CLOCKS_PER_SEC;
-    if (total_time_seconds > 0.1) {
-        printf("Time: %.2f seconds\n", total_time_seconds);
-    } else if (total_time_seconds > 0.001) {
-        printf("Time: %.2f milliseconds\n", total_time_seconds * 1000.0);
-    } else {
-        printf("Time: %.2f microseconds\n", total_time_seconds * 1000000.0);
+    if (!bench_mode) {
+        double total_time_seconds = (double) total_time / 1e9;
+        if (total_time_seconds > 0.1) {
+            printf("Time: %.2f seconds\n", total_time_seconds);
+        } else if (total_time_seconds > 0.001) {
+            printf("Time: %.2f milliseconds\n", total_time_seconds * 1000.0);
+        } else {
+            printf("Time: %.2f microseconds\n", total_time_seconds * 1000000.0);
+        }
     }
+#else
+    (void) total_time;
 #endif
 
     return true;
 }
 
+/*
+ * Merge benchmark: merges k sorted runs for k = 2, 4, ..., 1024 with the loser
+ * tree merges and, for comparison, with rounds of two-way merges.
+ */
+typedef void (*merge_method_fn_t)(const char *runs, const size_t *run_starts, size_t k, size_t size, compare_fn_t compare, void *context, char *out);
+
+struct merge_method {
+    const char *name;
+    merge_method_fn_t merge;
+    bool counts_moves; /* moves the elements only through copy() in util.h */
+};
+
+#define MERGE_BENCH_MAX_RUNS 1024
+
+static void merge_k_runs(const char *runs, const size_t *run_starts, size_t k, size_t size, compare_fn_t compare, void *context, char *out)
+{
+    const void **run_ptrs = malloc(k * sizeof(const void *));
+    size_t *lens = malloc(k * sizeof(size_t));
+    for (size_t i = 0; i < k; i++) {
+        run_ptrs[i] = runs + run_starts[i] * size;
+        lens[i] = run_starts[i + 1] - run_starts[i];
+    }
+    merge_k(run_ptrs, lens, k, size, compare, context, out);
+    free(run_ptrs);
+    free(lens);
+}
+
+struct merge_stream_runs {
+    const char **heads;
+    const char **ends;
+    size_t size;
+};
+
+struct merge_stream_out {
+    char *dst;
+    size_t size;
+};
+
+static const void *merge_stream_pull(size_t run, void *pull_context)
+{
+    struct merge_stream_runs *runs = pull_context;
+    const char *elem = runs->heads[run];
+    if (elem == runs->ends[run]) {
+        return NULL;
+    }
+    runs->heads[run] = elem + runs->size;
+    return elem;
+}
+
+static void merge_stream_push(const void *elem, void *push_context)
+{
+    struct merge_stream_out *out = push_context;
+    memcpy(out->dst, elem, out->size);
+    out->dst += out->size;
+}
+
+static void merge_k_stream_runs(const char *runs, const size_t *run_starts, size_t k, size_t size, compare_fn_t compare, void *context, char *out)
+{
+    struct merge_stream_runs stream_runs = {malloc(k * sizeof(const char *)), malloc(k * sizeof(const char *)), size};
+    struct merge_stream_out stream_out = {out, size};
+    for (size_t i = 0; i < k; i++) {
+        stream_runs.heads[i] = runs + run_starts[i] * size;
+        stream_runs.ends[i] = runs + run_starts[i + 1] * size;
+    }
+    merge_k_stream(k, merge_stream_pull, &stream_runs, merge_stream_push, &stream_out, compare, context);
+    free(stream_runs.heads);
+    free(stream_runs.ends);
+}
+
+static void merge_two(const char *a, size_t a_nelems, const char *b, size_t b_nelems, size_t size, compare_fn_t compare, void *context, char *out)
+{
+    const char *a_end = a + a_nelems * size;
+    const char *b_end = b + b_nelems * size;
+    while (a != a_end && b != b_end) {
+        if (compare(b, a, context) < 0) {
+            memcpy(out, b, size);
+            b += size;
+        } else {
+            memcpy(out, a, size);
+            a += size;
+        }
+        out += size;
+    }
+    memcpy(out, a, (size_t) (a_end - a));
+    out += a_end - a;
+    memcpy(out, b, (size_t) (b_end - b));
+}
+
+/* Merges neighbouring pairs of runs until one is left, going back and forth between out and a temporary array so the last round writes to out */
+static void merge_pairwise(const char *runs, const size_t *run_starts, size_t k, size_t size, compare_fn_t compare, void *context, char *out)
+{
+    size_t nelems = run_starts[k];
+    size_t *starts = malloc((k + 1) * sizeof(size_t));
+    char *temp = malloc(nelems * size);
+    memcpy(starts, run_starts, (k + 1) * sizeof(size_t));
+    unsigned nrounds = 0;
+    for (size_t n = k; n > 1; n = (n + 1) / 2) {
+        nrounds++;
+    }
+    const char *src = runs;
+    char *dst = nrounds % 2 ? out : temp;
+    if (nrounds == 0) {
+        memcpy(out, runs, nelems * size);
+    }
+    while (k > 1) {
+        size_t nmerged = 0;
+        for (size_t i = 0; i < k; i += 2) {
+            size_t start = starts[i];
+            size_t middle = starts[i + 1];
+            size_t end = starts[i + 2 <= k ? i + 2 : k];
+            merge_two(src + start * size, middle - start, src + middle * size, end - middle, size, compare, context, dst + start * size);
+            starts[nmerged++] = start;
+        }
+        starts[nmerged] = nelems;
+        k = nmerged;
+        src = dst;
+        dst = dst == out ? temp : out;
+    }
+    free(starts);
+    free(temp);
+}
+
+static const struct merge_method merge_methods[] = {
+    {"merge_k", merge_k_runs, true},
+    {"merge_k_stream", merge_k_stream_runs, false},
+    {"pairwise_merge", merge_pairwise, false},
+};
+
+static bool run_merge_benchmark(const struct merge_method *method, random_seed_t seed, elem_t array_size, size_t elem_size)
+{
+    if (output_format == OUTPUT_TEXT) {
+        printf("Benchmarking merge function: %s\n", method->name);
+    }
+    char *array = calloc(array_size, elem_size);
+    char *runs = malloc(array_size * elem_size);
+    char *check = malloc(array_size * elem_size);
+    char *out = malloc(array_size * elem_size);
+    uint64_t *samples = malloc(bench_reps * sizeof(uint64_t));
+    size_t *run_starts = malloc((MERGE_BENCH_MAX_RUNS + 1) * sizeof(size_t));
+    pattern_random(array, array_size, elem_size, &seed, NULL);
+    memcpy(check, array, array_size * elem_size);
+    qsort(check, array_size, elem_size, compare_elem);
+
+    bool result = true;
+    for (size_t k = 2; k <= MERGE_BENCH_MAX_RUNS && k <= array_size && result; k *= 2) {
+        char pattern_name[32];
+        snprintf(pattern_name, sizeof(pattern_name), "%zu runs", k);
+        memcpy(runs, array, array_size * elem_size);
+        for (size_t i = 0; i <= k; i++) {
+            run_starts[i] = array_size * i / k;
+        }
+        for (size_t i = 0; i < k; i++) {
+            merge_sort(runs + run_starts[i] * elem_size, run_starts[i + 1] - run_starts[i], elem_size, compare_elem_with_context_last, NULL);
+        }
+
+        struct bench_result bench;
+        op_counts_begin(&bench.counts);
+        method->merge(runs, run_starts, k, elem_size, compare_elem_with_context_last_counting, &comparison_count, out);
+        op_counts_end(&bench.counts, true, method->counts_moves);
+        if (memcmp(out, check, array_size * elem_size) != 0) {
+            printf("Test '%s' failed for merge function %s!\n", pattern_name, method->name);
+            result = false;
+            break;
+        }
+
+        for (unsigned i = 0; i < bench_warmup + bench_reps; i++) {
+            uint64_t start_time = monotonic_time_ns();
+            method->merge(runs, run_starts, k, elem_size, compare_elem_with_context_last, NULL, out);
+            uint64_t elapsed = monotonic_time_ns() - start_time;
+            if (i >= bench_warmup) {
+                samples[i - bench_warmup] = elapsed;
+            }
+        }
+        struct op_counts counts = bench.counts;
+        bench = bench_summary(samples);
+        bench.counts = counts;
+        print_bench_result(method->name, pattern_name, array_size, elem_size, &bench);
+    }
+
+    free(array);
+    free(runs);
+    free(check);
+    free(out);
+    free(samples);
+    free(run_starts);
+    return result;
+}
+
+/*
+ * Selection benchmark: finds the median with select_nth and the smallest k
+ * elements with partial_sort and the top_k heap, and for comparison sorts the
+ * whole array with pdq_sort, on each pattern.
+ */
+#define TOP_K_BATCH_SIZE 4096
+
+/* Number of smallest elements found by partial_sort and top_k (-k option) */
+static size_t select_k = 100;
+
+typedef void (*select_method_fn_t)(char *array, size_t nelems, size_t size, size_t k, compare_fn_t compare, void *context, char *out);
+
+enum select_check {
+    SELECT_CHECK_MEDIAN, /* the median is in the middle of the array, partitioned */
+    SELECT_CHECK_PREFIX, /* the k smallest elements are sorted at the front of the array */
+    SELECT_CHECK_OUT,    /* the k smallest elements are written to out */
+    SELECT_CHECK_SORTED, /* the array is sorted */
+};
+
+struct select_method {
+    const char *name;
+    select_method_fn_t select;
+    enum select_check check;
+    bool counts_moves; /* moves the elements only through copy() and swap() in util.h */
+};
+
+static void select_median(char *array, size_t nelems, size_t size, size_t k, compare_fn_t compare, void *context, char *out)
+{
+    (void) k;
+    (void) out;
+    select_nth(array, nelems, size, compare, context, nelems / 2);
+}
+
+static void partial_sort_k(char *array, size_t nelems, size_t size, size_t k, compare_fn_t compare, void *context, char *out)
+{
+    (void) out;
+    partial_sort(array, nelems, size, compare, context, k);
+}
+
+/* Streams the array to the heap in batches */
+static void top_k_batches(char *array, size_t nelems, size_t size, size_t k, compare_fn_t compare, void *context, char *out)
+{
+    struct top_k *top = top_k_create(k, size, compare, context);
+    for (size_t i = 0; i < nelems; i += TOP_K_BATCH_SIZE) {
+        top_k_push(top, array + i * size, nelems - i < TOP_K_BATCH_SIZE ? nelems - i : TOP_K_BATCH_SIZE);
+    }
+    top_k_result(top, out);
+    top_k_destroy(top);
+}
+
+static void full_sort(char *array, size_t nelems, size_t size, size_t k, compare_fn_t compare, void *context, char *out)
+{
+    (void) k;
+    (void) out;
+    pdq_sort(array, nelems, size, compare, context);
+}
+
+static const struct select_method select_methods[] = {
+    {"select_nth", select_median, SELECT_CHECK_MEDIAN, true},
+    {"partial_sort", partial_sort_k, SELECT_CHECK_PREFIX, true},
+    {"top_k", top_k_batches, SELECT_CHECK_OUT, true},
+    {"pdq_sort", full_sort, SELECT_CHECK_SORTED, true},
+};
+
+/* Checks the result of a selection against the sorted array, and that the array is still a permutation of it */
+static bool check_select(const struct select_method *method, char *array, const char *sorted, const char *out, size_t nelems, size_t size, size_t k)
+{
+    switch (method->check) {
+        case SELECT_CHECK_MEDIAN: {
+            size_t nth = nelems / 2;
+            if (compare_elem(array + nth * size, sorted + nth * size) != 0) {
+                return false;
+            }
+            for (size_t i = 0; i < nelems; i++) {
+                int order = compare_elem(array + i * size, array + nth * size);
+                if (i < nth ? order > 0 : order < 0) {
+                    return false;
+                }
+            }
+            break;
+        }
+        case SELECT_CHECK_PREFIX:
+            if (memcmp(array, sorted, k * size) != 0) {
+                return false;
+            }
+            break;
+        case SELECT_CHECK_OUT:
+            return memcmp(out, sorted, k * size) == 0;
+        case SELECT_CHECK_SORTED:
+            break;
+    }
+    qsort(array, nelems, size, compare_elem);
+    return memcmp(array, sorted, nelems * size) == 0;
+}
+
+static bool run_select_benchmark(const struct select_method *method, random_seed_t seed, elem_t array_size, size_t elem_size)
+{
+    if (output_format == OUTPUT_TEXT) {
+        printf("Benchmarking selection function: %s\n", method->name);
+    }
+    size_t k = select_k < array_size ? select_k : array_size;
+    char *array = malloc(array_size * elem_size);
+    char *sorted = malloc(array_size * elem_size);
+    char *work = malloc(array_size * elem_size);
+    char *out = malloc(k * elem_size + 1);
+    uint64_t *samples = malloc(bench_reps * sizeof(uint64_t));
+
+    bool result = true;
+    for (size_t i = 0; i < ARRAY_SIZE(test_patterns) && result; i++) {
+        const struct test_pattern *pattern = &test_patterns[i];
+        if (selected_pattern ? strcmp(selected_pattern, "all") != 0 && strcmp(selected_pattern, pattern->id) != 0 : pattern->opt_in) {
+            continue;
+        }
+        memset(array, 0, array_size * elem_size);
+        if (!pattern->init(array, array_size, elem_size, &seed, NULL)) {
+            continue; /* needs a sort function */
+        }
+        memcpy(sorted, array, array_size * elem_size);
+        qsort(sorted, array_size, elem_size, compare_elem);
+
+        struct bench_result bench;
+        memcpy(work, array, array_size * elem_size);
+        op_counts_begin(&bench.counts);
+        method->select(work, array_size, elem_size, k, compare_elem_with_context_last_counting, &comparison_count, out);
+        op_counts_end(&bench.counts, true, method->counts_moves);
+        if (!check_select(method, work, sorted, out, array_size, elem_size, k)) {
+            printf("Test '%s array' failed for selection function %s!\n", pattern->name, method->name);
+            result = false;
+            break;
+        }
+
+        for (unsigned j = 0; j < bench_warmup + bench_reps; j++) {
+            memcpy(work, array, array_size * elem_size);
+            uint64_t start_time = monotonic_time_ns();
+            method->select(work, array_size, elem_size, k, compare_elem_with_context_last, NULL, out);
+            uint64_t elapsed = monotonic_time_ns() - start_time;
+            if (j >= bench_warmup) {
+                samples[j - bench_warmup] = elapsed;
+            }
+        }
+        struct op_counts counts = bench.counts;
+        bench = bench_summary(samples);
+        bench.counts = counts;
+        print_bench_result(method->name, pattern->name, array_size, elem_size, &bench);
+    }
+
+    free(array);
+    free(sorted);
+    free(work);
+    free(out);
+    free(samples);
+    return result;
+}
+
+/*
+ * String tests and benchmark: sorts arrays of strings from each string pattern
+ * with the string sorts, and for comparison with pdq_sort and merge_sort on the
+ * string pointers with a strcmp comparator. The array size is the number of
+ * strings. The default test mode checks them without timing.
+ */
+#define STRING_MAX_LENGTH 128
+
+/* Writes string i of a pattern, NUL-terminated, to dst and returns its length */
+typedef size_t (*string_pattern_fn_t)(char *dst, size_t i, random_seed_t *seed);
+
+static size_t string_append_lowercase(char *dst, size_t len, random_seed_t *seed)
+{
+    for (size_t i = 0; i < len; i++) {
+        dst[i] = (char) ('a' + random_uint32(seed) % 26);
+    }
+    dst[len] = 0;
+    return len;
+}
+
+/* Random lowercase strings of 1 to 32 characters */
+static size_t string_pattern_random(char *dst, size_t i, random_seed_t *seed)
+{
+    (void) i;
+    return string_append_lowercase(dst, 1 + random_uint32(seed) % 32, seed);
+}
+
+/* URLs on one site, in a few sections, with random numeric IDs */
+static size_t string_pattern_urls(char *dst, size_t i, random_seed_t *seed)
+{
+    static const char *sections[] = {"users", "items", "search/results", "static/images"};
+    (void) i;
+    const char *section = sections[random_uint32(seed) % ARRAY_SIZE(sections)];
+    return (size_t) snprintf(dst, STRING_MAX_LENGTH + 1, "https://www.example.com/%s/%08" PRIu32 "/view",
+                             section, random_uint32(seed) % 100000000);
+}
+
+/* A common prefix of 100 characters followed by 6 random characters */
+static size_t string_pattern_long_prefix(char *dst, size_t i, random_seed_t *seed)
+{
+    (void) i;
+    size_t prefix_len = 100;
+    memset(dst, 'p', prefix_len);
+    return prefix_len + string_append_lowercase(dst + prefix_len, 6, seed);
+}
+
+/* Runs of up to 63 'a' characters, half of them followed by a 'b', so many strings are prefixes of others */
+static size_t string_pattern_nested_prefixes(char *dst, size_t i, random_seed_t *seed)
+{
+    (void) i;
+    size_t len = random_uint32(seed) % 64;
+    memset(dst, 'a', len);
+    if (random_uint32(seed) % 2) {
+        dst[len++] = 'b';
+    }
+    dst[len] = 0;
+    return len;
+}
+
+/* Up to 23 bytes of NUL, 'a' and 0xff, so many strings are prefixes of others or differ only in trailing NULs */
+static size_t string_pattern_nul_bytes(char *dst, size_t i, random_seed_t *seed)
+{
+    static const char bytes[] = {0, 0, 'a', (char) 0xff};
+    (void) i;
+    /* The low bits of random_uint32 repeat with short periods, so take the high bits */
+    size_t len = (random_uint32(seed) >> 16) % 24;
+    for (size_t j = 0; j < len; j++) {
+        dst[j] = bytes[random_uint32(seed) >> 30];
+    }
+    dst[len] = 0;
+    return len;
+}
+
+/* 16 distinct strings with a common prefix */
+static size_t string_pattern_few_unique(char *dst, size_t i, random_seed_t *seed)
+{
+    (void) i;
+    return (size_t) snprintf(dst, STRING_MAX_LENGTH + 1, "customer-account-identifier-%02" PRIu32, random_uint32(seed) % 16);
+}
+
+struct string_pattern {
+    const char *id; /* for the -p option */
+    const char *name;
+    string_pattern_fn_t init;
+    bool has_nul_bytes; /* only the sorts of (data, length) refs can sort it */
+};
+
+static const struct string_pattern string_patterns[] = {
+    {"random", "random strings", string_pattern_random},
+    {"urls", "URLs", string_pattern_urls},
+    {"long-prefix", "long common prefix", string_pattern_long_prefix},
+    {"nested-prefixes", "nested prefixes", string_pattern_nested_prefixes},
+    {"few-unique", "few unique strings", string_pattern_few_unique},
+    {"nul-bytes", "embedded NUL bytes", string_pattern_nul_bytes, .has_nul_bytes = true},
+};
+
+typedef void (*string_method_fn_t)(const char **strings, struct string_ref *refs, size_t nelems, compare_fn_t compare, void *context);
+
+struct string_method {
+    const char *name;
+    string_method_fn_t sort;
+    bool sorts_refs;  /* sorts the (data, length) refs rather than the string pointers */
+    bool compares;    /* uses the strcmp comparator */
+    bool counts_moves; /* moves the strings only through copy() and swap() in util.h */
+};
+
+static int compare_string_ptrs(const void *a_ptr, const void *b_ptr, void *context)
+{
+    (void) context;
+    return strcmp(*(const char *const *) a_ptr, *(const char *const *) b_ptr);
+}
+
+static int compare_string_refs(const void *a_ptr, const void *b_ptr, void *context)
+{
+    const struct string_ref *a = a_ptr;
+    const struct string_ref *b = b_ptr;
+    (void) context;
+    int result = memcmp(a->data, b->data, a->len < b->len ? a->len : b->len);
+    return result ? result : (a->len > b->len) - (a->len < b->len);
+}
+
+static int compare_string_ptrs_counting(const void *a_ptr, const void *b_ptr, void *context)
+{
+    atomic_fetch_add_explicit((atomic_uint_least64_t *) context, 1, memory_order_relaxed);
+    return compare_string_ptrs(a_ptr, b_ptr, NULL);
+}
+
+static void string_multikey_quicksort(const char **strings, struct string_ref *refs, size_t nelems, compare_fn_t compare, void *context)
+{
+    (void) refs;
+    (void) compare;
+    (void) context;
+    multikey_quicksort(strings, nelems);
+}
+
+static void string_radix(const char **strings, struct string_ref *refs, size_t nelems, compare_fn_t compare, void *context)
+{
+    (void) refs;
+    (void) compare;
+    (void) context;
+    string_radix_sort(strings, nelems);
+}
+
+static void string_refs(const char **strings, struct string_ref *refs, size_t nelems, compare_fn_t compare, void *context)
+{
+    (void) strings;
+    (void) compare;
+    (void) context;
+    string_ref_sort(refs, nelems);
+}
+
+static void string_pdq_sort(const char **strings, struct string_ref *refs, size_t nelems, compare_fn_t compare, void *context)
+{
+    (void) refs;
+    pdq_sort(strings, nelems, sizeof(*strings), compare, context);
+}
+
+static void string_merge_sort(const char **strings, struct string_ref *refs, size_t nelems, compare_fn_t compare, void *context)
+{
+    (void) refs;
+    merge_sort(strings, nelems, sizeof(*strings), compare, context);
+}
+
+static const struct string_method string_methods[] = {
+    {"multikey_quicksort", string_multikey_quicksort, false, false, false},
+    {"string_radix_sort", string_radix, false, false, false},
+    {"string_ref_sort", string_refs, true, false, false},
+    {"pdq_sort_strcmp", string_pdq_sort, false, true, true},
+    {"merge_sort_strcmp", string_merge_sort, false, true, true},
+};
+
+/* Generates the strings of a pattern into one buffer, returning it, and pointers to the strings and their refs */
+static char *string_pattern_generate(const struct string_pattern *pattern, size_t nelems, random_seed_t *seed,
+                                     const char **strings, struct string_ref *refs)
+{
+    size_t capacity = nelems * 16 + STRING_MAX_LENGTH + 1;
+    size_t used = 0;
+    char *chars = malloc(capacity);
+    size_t *offsets = malloc(nelems * sizeof(size_t));
+    size_t *lens = malloc(nelems * sizeof(size_t));
+    for (size_t i = 0; i < nelems; i++) {
+        if (capacity - used < STRING_MAX_LENGTH + 1) {
+            capacity *= 2;
+            chars = realloc(chars, capacity);
+        }
+        offsets[i] = used;
+        lens[i] = pattern->init(chars + used, i, seed);
+        used += lens[i] + 1;
+    }
+    for (size_t i = 0; i < nelems; i++) {
+        strings[i] = chars + offsets[i];
+        refs[i].data = strings[i];
+        refs[i].len = lens[i];
+    }
+    free(offsets);
+    free(lens);
+    return chars;
+}
+
+static bool check_strings(const struct string_method *method, const char **strings, const struct string_ref *refs,
+                          const char **sorted, const struct string_ref *sorted_refs, size_t nelems)
+{
+    for (size_t i = 0; i < nelems; i++) {
+        if (method->sorts_refs) {
+            if (compare_string_refs(&refs[i], &sorted_refs[i], NULL) != 0) {
+                return false;
+            }
+        } else if (strcmp(strings[i], sorted[i]) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Checks a string sort on each string pattern, and benchmarks it in benchmark mode */
+static bool run_string_tests(const struct string_method *method, random_seed_t seed, elem_t array_size)
+{
+    if (output_format == OUTPUT_TEXT) {
+        printf("%s string sort function: %s\n", bench_mode ? "Benchmarking" : "Testing", method->name);
+    }
+    const char **strings = malloc(array_size * sizeof(*strings));
+    const char **sorted = malloc(array_size * sizeof(*sorted));
+    const char **work = malloc(array_size * sizeof(*work));
+    struct string_ref *refs = malloc(array_size * sizeof(*refs));
+    struct string_ref *sorted_refs = malloc(array_size * sizeof(*sorted_refs));
+    struct string_ref *work_refs = malloc(array_size * sizeof(*work_refs));
+    uint64_t *samples = malloc(bench_reps * sizeof(uint64_t));
+    size_t elem_size = method->sorts_refs ? sizeof(*refs) : sizeof(*strings);
+
+    bool result = true;
+    for (size_t i = 0; i < ARRAY_SIZE(string_patterns) && result; i++) {
+        const struct string_pattern *pattern = &string_patterns[i];
+        if (selected_pattern && strcmp(selected_pattern, "all") != 0 && strcmp(selected_pattern, pattern->id) != 0) {
+            continue;
+        }
+        char *chars = string_pattern_generate(pattern, array_size, &seed, strings, refs);
+        if (pattern->has_nul_bytes && !method->sorts_refs) {
+            free(chars);
+            continue;
+        }
+        memcpy(sorted, strings, array_size * sizeof(*strings));
+        merge_sort(sorted, array_size, sizeof(*sorted), compare_string_ptrs, NULL);
+        memcpy(sorted_refs, refs, array_size * sizeof(*refs));
+        merge_sort(sorted_refs, array_size, sizeof(*sorted_refs), compare_string_refs, NULL);
+
+        struct bench_result bench;
+        memcpy(work, strings, array_size * sizeof(*strings));
+        memcpy(work_refs, refs, array_size * sizeof(*refs));
+        op_counts_begin(&bench.counts);
+        method->sort(work, work_refs, array_size, compare_string_ptrs_counting, &comparison_count);
+        op_counts_end(&bench.counts, method->compares, method->counts_moves);
+        if (!check_strings(method, work, work_refs, sorted, sorted_refs, array_size)) {
+            printf("Test '%s' failed for string sort function %s!\n", pattern->name, method->name);
+            result = false;
+        } else if (bench_mode) {
+            for (unsigned j = 0; j < bench_warmup + bench_reps; j++) {
+                memcpy(work, strings, array_size * sizeof(*strings));
+                memcpy(work_refs, refs, array_size * sizeof(*refs));
+                uint64_t start_time = monotonic_time_ns();
+                method->sort(work, work_refs, array_size, compare_string_ptrs, NULL);
+                uint64_t elapsed = monotonic_time_ns() - start_time;
+                if (j >= bench_warmup) {
+                    samples[j - bench_warmup] = elapsed;
+                }
+            }
+            struct op_counts counts = bench.counts;
+            bench = bench_summary(samples);
+            bench.counts = counts;
+            print_bench_result(method->name, pattern->name, array_size, elem_size, &bench);
+        }
+        free(chars);
+    }
+
+    free(strings);
+    free(sorted);
+    free(work);
+    free(refs);
+    free(sorted_refs);
+    free(work_refs);
+    free(samples);
+    return result;
+}
+
+/*
+ * Calibration (--calibrate): times the sorts whose cutoffs are in sort_tuning
+ * with each candidate value of each cutoff in turn, on random and run patterns
+ * at several array sizes (fractions of -n) and element widths, and keeps the
+ * value with the lowest mean time relative to the fastest candidate for each
+ * case. The cutoffs are tuned one after another, each with the ones before it
+ * already set, and the result is written as a profile for sort_tuning_load.
+ */
+#define CALIBRATION_MAX_CANDIDATES 8
+#define CALIBRATION_MIN_NELEMS 100
+
+struct calibration_param {
+    size_t *value;
+    const char *name;
+    const char *sort_name;
+    size_t candidates[CALIBRATION_MAX_CANDIDATES]; /* terminated by 0 */
+};
+
+static const struct calibration_param calibration_params[] = {
+    {&sort_tuning.timsort_min_merge, "timsort_min_merge", "timsort", {32, 64, 128, 256}},
+    {&sort_tuning.timsort_min_gallop, "timsort_min_gallop", "timsort", {3, 5, 7, 10, 14, 20}},
+    {&sort_tuning.quicksort_insertion_cutoff, "quicksort_insertion_cutoff", "bentley_mcilroy_quicksort", {4, 7, 10, 14, 20}},
+    {&sort_tuning.quicksort_ninther_cutoff, "quicksort_ninther_cutoff", "bentley_mcilroy_quicksort", {20, 40, 60, 100, 200}},
+    {&sort_tuning.merge_sort_base_case, "merge_sort_base_case", "merge_sort", {3, 4, 6, 8, 12, 16}},
+};
+
+static const char *const calibration_patterns[] = {"random", "random-runs"};
+static const size_t calibration_elem_sizes[] = {4, 16, 64};
+static const elem_t calibration_size_divisors[] = {1000, 100, 10};
+
+static const sort_fn_t *find_sort_function(const char *name)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(sort_functions); i++) {
+        if (strcmp(name, sort_functions[i].name) == 0) {
+            return &sort_functions[i];
+        }
+    }
+    return NULL;
+}
+
+static const struct test_pattern *find_test_pattern(const char *id)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(test_patterns); i++) {
+        if (strcmp(id, test_patterns[i].id) == 0) {
+            return &test_patterns[i];
+        }
+    }
+    return NULL;
+}
+
+/* Adds the time of each candidate relative to the fastest one to scores, or returns false if a sort failed */
+static bool calibrate_case(const struct calibration_param *param, size_t ncandidates, const sort_fn_t *sort,
+                           const struct test_pattern *pattern, elem_t nelems, size_t elem_size, random_seed_t seed, double *scores)
+{
+    char *array = calloc(nelems, elem_size);
+    pattern->init(array, nelems, elem_size, &seed, sort);
+    array_set_indices(array, nelems, elem_size, sort);
+    const size_t value = *param->value;
+    uint64_t times[CALIBRATION_MAX_CANDIDATES];
+    uint64_t fastest = UINT64_MAX;
+    bool result = true;
+    for (size_t i = 0; i < ncandidates && result; i++) {
+        *param->value = param->candidates[i];
+        uint64_t time;
+        result = test_sort(array, elem_size, nelems, sort, pattern->name, &time, NULL);
+        if (result) {
+            times[i] = bench_sort(array, elem_size, nelems, sort).median_ns + 1;
+            fastest = times[i] < fastest ? times[i] : fastest;
+        }
+    }
+    *param->value = value;
+    for (size_t i = 0; i < ncandidates && result; i++) {
+        scores[i] += (double) times[i] / (double) fastest;
+    }
+    free(array);
+    return result;
+}
+
+static bool run_calibration(random_seed_t seed, elem_t array_size)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(calibration_params); i++) {
+        const struct calibration_param *param = &calibration_params[i];
+        const sort_fn_t *sort = find_sort_function(param->sort_name);
+        size_t ncandidates = 0;
+        while (ncandidates < CALIBRATION_MAX_CANDIDATES && param->candidates[ncandidates]) {
+            ncandidates++;
+        }
+        double scores[CALIBRATION_MAX_CANDIDATES] = {0};
+        size_t ncases = 0;
+        printf("Calibrating %s (%s)\n", param->name, sort->name);
+        for (size_t j = 0; j < ARRAY_SIZE(calibration_size_divisors); j++) {
+            elem_t nelems = array_size / calibration_size_divisors[j];
+            if (nelems < CALIBRATION_MIN_NELEMS) {
+                continue;
+            }
+            for (size_t k = 0; k < ARRAY_SIZE(calibration_elem_sizes); k++) {
+                for (size_t l = 0; l < ARRAY_SIZE(calibration_patterns); l++) {
+                    const struct test_pattern *pattern = find_test_pattern(calibration_patterns[l]);
+                    if (!calibrate_case(param, ncandidates, sort, pattern, nelems, calibration_elem_sizes[k], seed, scores)) {
+                        return false;
+                    }
+                    ncases++;
+                }
+            }
+        }
+        if (ncases == 0) {
+            printf("  no cases with at least %d elements, keeping %zu\n", CALIBRATION_MIN_NELEMS, *param->value);
+            continue;
+        }
+        size_t best = 0;
+        printf("  mean time relative to the fastest:");
+        for (size_t j = 0; j < ncandidates; j++) {
+            printf("  %zu: %.3f", param->candidates[j], scores[j] / (double) ncases);
+            best = scores[j] < scores[best] ? j : best;
+        }
+        printf("\n  %s = %zu\n", param->name, param->candidates[best]);
+        *param->value = param->candidates[best];
+    }
+    if (sort_tuning_save(calibration_profile, &sort_tuning) != 0) {
+        fprintf(stderr, "error: can't write tuning profile %s: %s\n", calibration_profile, strerror(errno));
+        return false;
+    }
+    printf("Wrote tuning profile to %s\n", calibration_profile);
+    return true;
+}
+
 static void usage(void)
 {
     static const char *perf_names[] = {"\x1b[31mslow\x1b[0m", "\x1b[33m mid\x1b[0m", "\x1b[32mfast\x1b[0m"};
-    printf("usage: test_sort [-f <function>] [-n <array-size>] [-s <elem-size>] [-r <seed>]\n");
+    printf("usage: test_sort [-f <function>] [-p <pattern>] [-n <array-size>] [-s <elem-size>] [-r <seed>] [-t <threads>]\n");
+    printf("                 [-m <bytes>] [-k <count>] [--bench] [--merge] [--select] [--strings] [--reps <count>]\n");
+    printf("                 [--warmup <count>] [--format text|csv|json] [--calibrate <file>] [--tuning <file>]\n");
     printf("available sort functions:\n");
     for (size_t i = 0; i < ARRAY_SIZE(sort_functions); i++) {
-        printf("    %s  %s\n", perf_names[sort_functions[i].perf], sort_functions[i].name);
+        printf("    %s  %s", perf_names[sort_functions[i].perf], sort_functions[i].name);
+        if (sort_functions[i].elem_size) {
+            printf(" (-s %zu only)", sort_functions[i].elem_size);
+        }
+        printf("\n");
+    }
+    printf("available patterns (* only run when selected, -p all runs every pattern):\n");
+    for (size_t i = 0; i < ARRAY_SIZE(test_patterns); i++) {
+        printf("    %s%s\n", test_patterns[i].id, test_patterns[i].opt_in ? " *" : "");
+    }
+    printf("available string patterns (--strings):\n");
+    for (size_t i = 0; i < ARRAY_SIZE(string_patterns); i++) {
+        printf("    %s\n", string_patterns[i].id);
     }
 }
 
@@ -410,6 +2220,26 @@ int main(int argc, char **argv)
             if (!sort) {
                 fprintf(stderr, "error: unknown sort function: %s\n", sort_name);
                 usage();
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-p") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "error: missing argument to -p\n");
+                usage();
+                return 1;
+            }
+            selected_pattern = argv[++i];
+            bool found = strcmp(selected_pattern, "all") == 0;
+            for (size_t j = 0; j < ARRAY_SIZE(test_patterns) && !found; j++) {
+                found = strcmp(selected_pattern, test_patterns[j].id) == 0;
+            }
+            for (size_t j = 0; j < ARRAY_SIZE(string_patterns) && !found; j++) {
+                found = strcmp(selected_pattern, string_patterns[j].id) == 0;
+            }
+            if (!found) {
+                fprintf(stderr, "error: unknown pattern: %s\n", selected_pattern);
+                usage();
+                return 1;
             }
         } else if (strcmp(argv[i], "-n") == 0) {
             if (i + 1 >= argc) {
@@ -444,6 +2274,116 @@ int main(int argc, char **argv)
                 return 1;
             }
             seed = (random_seed_t) strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-t") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "error: missing argument to -t\n");
+                usage();
+                return 1;
+            }
+            unsigned long threads = strtoul(argv[++i], NULL, 10);
+            if (threads == 0 || threads > 1024) {
+                fprintf(stderr, "error: invalid thread count: %lu\n", threads);
+                usage();
+                return 1;
+            }
+            thread_count = (unsigned) threads;
+#if !defined(_WIN32)
+        } else if (strcmp(argv[i], "-m") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "error: missing argument to -m\n");
+                usage();
+                return 1;
+            }
+            unsigned long long memory = strtoull(argv[++i], NULL, 10);
+            if (memory < 1024 || memory > SIZE_MAX) {
+                fprintf(stderr, "error: invalid memory limit: %llu\n", memory);
+                usage();
+                return 1;
+            }
+            external_sort_memory = (size_t) memory;
+#endif
+        } else if (strcmp(argv[i], "-k") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "error: missing argument to -k\n");
+                usage();
+                return 1;
+            }
+            unsigned long long count = strtoull(argv[++i], NULL, 10);
+            if (count > ELEM_MAX) {
+                fprintf(stderr, "error: invalid count for -k: %llu\n", count);
+                usage();
+                return 1;
+            }
+            select_k = (size_t) count;
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            bench_mode = true;
+        } else if (strcmp(argv[i], "--merge") == 0) {
+            merge_bench_mode = true;
+            bench_mode = true;
+        } else if (strcmp(argv[i], "--select") == 0) {
+            select_bench_mode = true;
+            bench_mode = true;
+        } else if (strcmp(argv[i], "--strings") == 0) {
+            string_bench_mode = true;
+            bench_mode = true;
+        } else if (strcmp(argv[i], "--calibrate") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "error: missing argument to --calibrate\n");
+                usage();
+                return 1;
+            }
+            calibration_profile = argv[++i];
+            bench_mode = true;
+        } else if (strcmp(argv[i], "--tuning") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "error: missing argument to --tuning\n");
+                usage();
+                return 1;
+            }
+            const char *path = argv[++i];
+            if (sort_tuning_load(path) != 0) {
+                fprintf(stderr, "error: can't load tuning profile %s: %s\n", path, strerror(errno));
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--reps") == 0 || strcmp(argv[i], "--warmup") == 0) {
+            const char *option = argv[i];
+            if (i + 1 >= argc) {
+                fprintf(stderr, "error: missing argument to %s\n", option);
+                usage();
+                return 1;
+            }
+            unsigned long count = strtoul(argv[++i], NULL, 10);
+            bool is_reps = strcmp(option, "--reps") == 0;
+            if ((is_reps && count == 0) || count > 100000) {
+                fprintf(stderr, "error: invalid count for %s: %lu\n", option, count);
+                usage();
+                return 1;
+            }
+            if (is_reps) {
+                bench_reps = (unsigned) count;
+            } else {
+                bench_warmup = (unsigned) count;
+            }
+            bench_mode = true;
+        } else if (strcmp(argv[i], "--format") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "error: missing argument to --format\n");
+                usage();
+                return 1;
+            }
+            const char *format = argv[++i];
+            if (strcmp(format, "text") == 0) {
+                output_format = OUTPUT_TEXT;
+            } else if (strcmp(format, "csv") == 0) {
+                output_format = OUTPUT_CSV;
+            } else if (strcmp(format, "json") == 0) {
+                output_format = OUTPUT_JSON;
+            } else {
+                fprintf(stderr, "error: unknown output format: %s\n", format);
+                usage();
+                return 1;
+            }
+            bench_mode = true;
         } else {
             fprintf(stderr, "error: unknown argument: %s\n", argv[i]);
             usage();
@@ -451,20 +2391,81 @@ int main(int argc, char **argv)
         }
     }
 
-    printf("Array size: %u, Element size: %zu, Random seed: %u\n", array_size, elem_size, seed);
-    if (!sort) {
+    if (output_format == OUTPUT_TEXT) {
+        printf("Array size: %u, Element size: %zu, Random seed: %u", array_size, elem_size, seed);
+        if (thread_count) {
+            printf(", Threads: %u", thread_count);
+        }
+        if (bench_mode) {
+            printf(", Warmup: %u, Repetitions: %u", bench_warmup, bench_reps);
+        }
+        printf("\n");
+    }
+    if (sort && sort->elem_size && sort->elem_size != elem_size) {
+        fprintf(stderr, "error: sort function %s requires element size %zu\n", sort->name, sort->elem_size);
+        return 1;
+    }
+#ifndef NDEBUG
+    if (bench_mode) {
+        fprintf(stderr, "warning: benchmarking a debug build\n");
+    }
+#endif
+#ifdef SORT_INSTRUMENT
+    if (bench_mode) {
+        fprintf(stderr, "warning: benchmarking an instrumented build, counting copies slows down the sorts\n");
+    }
+#endif
+    if (bench_mode) {
+        print_bench_header();
+    }
+    if (calibration_profile) {
+        if (!run_calibration(seed, array_size)) {
+            return 1;
+        }
+    } else if (merge_bench_mode) {
+        for (size_t i = 0; i < ARRAY_SIZE(merge_methods); i++) {
+            if (!run_merge_benchmark(&merge_methods[i], seed, array_size, elem_size)) {
+                return 1;
+            }
+        }
+    } else if (select_bench_mode) {
+        for (size_t i = 0; i < ARRAY_SIZE(select_methods); i++) {
+            if (!run_select_benchmark(&select_methods[i], seed, array_size, elem_size)) {
+                return 1;
+            }
+        }
+    } else if (string_bench_mode) {
+        for (size_t i = 0; i < ARRAY_SIZE(string_methods); i++) {
+            if (!run_string_tests(&string_methods[i], seed, array_size)) {
+                return 1;
+            }
+        }
+    } else if (!sort) {
         for (size_t i = 0; i < ARRAY_SIZE(sort_functions); i++) {
+            if (sort_functions[i].elem_size && sort_functions[i].elem_size != elem_size) {
+                continue;
+            }
             if (sort_functions[i].perf > PERF_SLOW || array_size <= 10000) {
                 if (!run_tests(&sort_functions[i], seed, array_size, elem_size)) {
                     return 1;
                 }
             }
         }
+        for (size_t i = 0; i < ARRAY_SIZE(string_methods) && !bench_mode; i++) {
+            if (!run_string_tests(&string_methods[i], seed, array_size)) {
+                return 1;
+            }
+        }
     } else {
         if (!run_tests(sort, seed, array_size, elem_size)) {
             return 1;
         }
     }
-    printf("All tests passed.\n");
+    if (bench_mode) {
+        print_bench_footer();
+    }
+    if (output_format == OUTPUT_TEXT) {
+        printf("All tests passed.\n");
+    }
     return 0;
 }
@@ -29,6 +29,10 @@
 #include <stddef.h>
 #include <string.h>
 
+#ifdef SORT_INSTRUMENT
+#include "instrument.h"
+#endif
+
 #if defined(__GNUC__) || defined(__clang__)
 #define unlikely(x) __builtin_expect(!!(x), 0)
 #else
@@ -37,6 +41,9 @@
 
 static inline void copy(void *dst_ptr, const void *src_ptr, size_t size)
 {
+#ifdef SORT_INSTRUMENT
+    instrument_count_copy(size);
+#endif
 #if defined(__APPLE__)
     /* for some unknown reason this is faster than calling memcpy on Apple Silicon Macs */
     char *dst = dst_ptr;
@@ -54,3 +61,19 @@ static inline void swap(void *a_ptr, void *b_ptr, void *temp, size_t size)
     copy(a_ptr, b_ptr, size);
     copy(b_ptr, temp, size);
 }
+
+/* Integer square root, rounded down, by Newton's method */
+static inline size_t isqrt(size_t n)
+{
+    if (n < 2) {
+        return n;
+    }
+    /* Start from above the root without overflowing x + n / x */
+    size_t x = n / 2 + 1;
+    size_t y = (x + n / x) / 2;
+    while (y < x) {
+        x = y;
+        y = (x + n / x) / 2;
+    }
+    return x;
+}
@@ -2,11 +2,13 @@
  * From "Engineering a Sort Function" by Jon L. Bentley and M. Douglas McIlroy (November 1993)
  * Software: Practice and Experience, Volume 23, Issue 11, 1249–1265
  * 
- * With some minor modifications and cleanup.
+ * With some minor modifications and cleanup. The insertion sort and pseudomedian of 9 cutoffs
+ * (originally 7 and 40) are read from sort_tuning so they can be calibrated for the machine.
  */
 
 #include <stddef.h>
 #include <stdint.h>
+#include "../src/sort_tuning.h"
 
 typedef size_t WORD;
 
@@ -43,7 +45,7 @@ void bentley_mcilroy_quicksort(char *a, size_t n, size_t es, int (*cmp)(const vo
     WORD t, v;
     size_t s;
     const int swaptype = ((uintptr_t)a | es) % W ? 2 : es > W ? 1 : 0;
-    if (n < 7) { /* Insertion sort on smallest arrays */
+    if (n < sort_tuning.quicksort_insertion_cutoff) { /* Insertion sort on smallest arrays */
         for (pm = a + es; pm < a + n * es; pm += es) {
             for (pl = pm; pl > a && cmp(pl - es, pl, ctx) > 0; pl -= es) {
                 swap(pl, pl - es);
@@ -55,7 +57,7 @@ void bentley_mcilroy_quicksort(char *a, size_t n, size_t es, int (*cmp)(const vo
     if (n > 7) {
         pl = a;
         pn = a + (n - 1) * es;
-        if (n > 40) { /* Big arrays, pseudomedian of 9 */
+        if (n > sort_tuning.quicksort_ninther_cutoff) { /* Big arrays, pseudomedian of 9 */
             s = (n / 8) * es;
             pl = med3(pl, pl + s, pl + 2 * s, cmp, ctx);
             pm = med3(pm - s, pm, pm + s, cmp, ctx);
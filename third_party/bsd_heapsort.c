@@ -33,6 +33,7 @@
 #include <errno.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include "../src/sort_workspace.h"
 
 /*
  * Swap two areas of size number of bytes.  Although qsort(3) permits random
@@ -129,9 +130,10 @@
  * a data set that will trigger the worst case is nonexistent.  Heapsort's
  * only advantage over quicksort is that it requires little additional memory.
  */
-int
-bsd_heapsort(void *vbase, size_t nmemb, size_t size,
-    int (*compar)(const void *, const void *, void *), void *ctx)
+static int
+heapsort_ws(void *vbase, size_t nmemb, size_t size,
+    int (*compar)(const void *, const void *, void *), void *ctx,
+    struct sort_workspace *ws)
 {
 	size_t cnt, i, j, l;
 	char tmp, *tmp1, *tmp2;
@@ -145,7 +147,7 @@ bsd_heapsort(void *vbase, size_t nmemb, size_t size,
 		return (-1);
 	}
 
-	if ((k = malloc(size)) == NULL)
+	if ((k = ws ? sort_workspace_reserve(ws, size) : malloc(size)) == NULL)
 		return (-1);
 
 	/*
@@ -168,6 +170,22 @@ bsd_heapsort(void *vbase, size_t nmemb, size_t size,
 		--nmemb;
 		SELECT(i, j, nmemb, t, p, size, k, cnt, tmp1, tmp2);
 	}
-	free(k);
+	if (!ws)
+		free(k);
 	return (0);
 }
+
+int
+bsd_heapsort(void *vbase, size_t nmemb, size_t size,
+    int (*compar)(const void *, const void *, void *), void *ctx)
+{
+	return (heapsort_ws(vbase, nmemb, size, compar, ctx, NULL));
+}
+
+int
+bsd_heapsort_ws(void *vbase, size_t nmemb, size_t size,
+    int (*compar)(const void *, const void *, void *), void *ctx,
+    struct sort_workspace *ws)
+{
+	return (heapsort_ws(vbase, nmemb, size, compar, ctx, ws));
+}
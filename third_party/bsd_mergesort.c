@@ -47,8 +47,10 @@
  */
 
 #include <errno.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include "../src/sort_workspace.h"
 
 #if defined(__clang__)
 #define align_up(x, y) __builtin_align_up(x, y)
@@ -103,10 +105,12 @@ static void insertionsort(unsigned char *, size_t, size_t, cmp_t, void *);
 #define EVAL(p) (unsigned char **)roundup2((uintptr_t)p, PSIZE)
 
 /*
- * Arguments are as for qsort.
+ * Arguments are as for qsort, plus an optional workspace to take the
+ * scratch list from instead of allocating it.
  */
-int
-bsd_mergesort(void *base, size_t nmemb, size_t size, cmp_t cmp, void *ctx)
+static int
+mergesort_ws(void *base, size_t nmemb, size_t size, cmp_t cmp, void *ctx,
+    struct sort_workspace *ws)
 {
 	size_t i;
 	int sense;
@@ -126,7 +130,8 @@ bsd_mergesort(void *base, size_t nmemb, size_t size, cmp_t cmp, void *ctx)
 	if (is_aligned(size, ISIZE) && is_aligned(base, ISIZE))
 		iflag = 1;
 
-	if ((list2 = malloc(nmemb * size + PSIZE)) == NULL)
+	if ((list2 = ws ? sort_workspace_reserve(ws, nmemb * size + PSIZE) :
+	    malloc(nmemb * size + PSIZE)) == NULL)
 		return (-1);
 
 	list1 = base;
@@ -233,10 +238,24 @@ COPY:	    			b = t;
 		memmove(list2, list1, nmemb*size);
 		list2 = list1;
 	}
-	free(list2);
+	if (!ws)
+		free(list2);
 	return (0);
 }
 
+int
+bsd_mergesort(void *base, size_t nmemb, size_t size, cmp_t cmp, void *ctx)
+{
+	return (mergesort_ws(base, nmemb, size, cmp, ctx, NULL));
+}
+
+int
+bsd_mergesort_ws(void *base, size_t nmemb, size_t size, cmp_t cmp, void *ctx,
+    struct sort_workspace *ws)
+{
+	return (mergesort_ws(base, nmemb, size, cmp, ctx, ws));
+}
+
 #define	swap(a, b) {					\
 		s = b;					\
 		i = size;				\
@@ -23,7 +23,11 @@ static size_t NAME(countRunAndMakeAscending) (void *a, size_t hi,
 static void NAME(reverseRange) (void *a, size_t hi, size_t width);
 static int NAME(mergeCollapse) (struct timsort * ts, size_t width);
 static int NAME(mergeForceCollapse) (struct timsort * ts, size_t width);
+static int NAME(mergePowersort) (struct timsort * ts, size_t runLen,
+				 size_t width);
 static int NAME(mergeAt) (struct timsort * ts, size_t i, size_t width);
+static int NAME(mergeRuns) (struct timsort * ts, void *base1, size_t len1,
+			    void *base2, size_t len2, size_t width);
 static size_t NAME(gallopLeft) (void *key, void *base, size_t len,
 				size_t hint, CMPPARAMS(compare, carg),
 				size_t width);
@@ -35,7 +39,8 @@ static int NAME(mergeLo) (struct timsort * ts, void *base1, size_t len1,
 static int NAME(mergeHi) (struct timsort * ts, void *base1, size_t len1,
 			  void *base2, size_t len2, size_t width);
 
-static int NAME(timsort) (void *a, size_t nel, size_t width, CMPPARAMS(c, carg))
+static int NAME(timsort) (void *a, size_t nel, size_t width, CMPPARAMS(c, carg),
+			  struct sort_workspace *ws, int powersort)
 {
 	int err = SUCCESS;
 	struct timsort ts;
@@ -60,8 +65,9 @@ static int NAME(timsort) (void *a, size_t nel, size_t width, CMPPARAMS(c, carg))
          * extending short natural runs to minRun elements, and merging runs
          * to maintain stack invariant.
          */
-	if ((err = timsort_init(&ts, a, nel, CMPARGS(c, carg), width)))
+	if ((err = timsort_init(&ts, a, nel, CMPARGS(c, carg), width, ws)))
 		return err;
+	ts.powersort = powersort;
 
 	minRun = minRunLength(nel);
 	do {
@@ -76,9 +82,15 @@ static int NAME(timsort) (void *a, size_t nel, size_t width, CMPPARAMS(c, carg))
 			runLen = force;
 		}
 		// Push run onto pending-run stack, and maybe merge
-		pushRun(&ts, a, runLen);
-		if ((err = CALL(mergeCollapse) (&ts, width)))
-			goto out;
+		if (ts.powersort) {
+			if ((err = CALL(mergePowersort) (&ts, runLen, width)))
+				goto out;
+			pushRun(&ts, a, runLen);
+		} else {
+			pushRun(&ts, a, runLen);
+			if ((err = CALL(mergeCollapse) (&ts, width)))
+				goto out;
+		}
 
 		// Advance to find next run
 		a = ELEM(a, runLen);
@@ -288,6 +300,38 @@ static int NAME(mergeCollapse) (struct timsort * ts, size_t width) {
 	return err;
 }
 
+/**
+ * The Powersort merge policy, called before pushing each new run of
+ * runLen elements.  The boundary between the top run on the stack and the
+ * new run is given a node power (see nodePower), and runs on the stack are
+ * merged while the boundary below the top run has a greater power, so the
+ * powers on the stack are strictly increasing.  The merges approximate a
+ * nearly-optimal merge tree for the run lengths, where the TimSort stack
+ * invariants can make unbalanced merges on some run length distributions.
+ */
+static int NAME(mergePowersort) (struct timsort * ts, size_t runLen,
+				 size_t width) {
+	int err = SUCCESS;
+	struct timsort_run *top;
+	size_t s1;
+	unsigned power;
+
+	if (ts->stackSize == 0)
+		return err;
+
+	top = &ts->run[ts->stackSize - 1];
+	s1 = (size_t)((char *)top->base - (char *)ts->a) / WIDTH;
+	power = nodePower(s1, top->len, runLen, ts->a_length);
+	while (ts->stackSize > 1 && ts->run[ts->stackSize - 2].power > power) {
+		err = CALL(mergeAt) (ts, ts->stackSize - 2, width);
+		if (err)
+			return err;
+	}
+	ts->run[ts->stackSize - 1].power = power;
+	(void)width;
+	return err;
+}
+
 /**
  * Merges all runs on the stack until only one remains.  This method is
  * called once, to complete the sort.
@@ -318,7 +362,6 @@ static int NAME(mergeAt) (struct timsort * ts, size_t i, size_t width) {
 	size_t len1 = ts->run[i].len;
 	void *base2 = ts->run[i + 1].base;
 	size_t len2 = ts->run[i + 1].len;
-        size_t k;
 
 	assert(ts->stackSize >= 2);
 	assert(i == ts->stackSize - 2 || i == ts->stackSize - 3);
@@ -336,6 +379,20 @@ static int NAME(mergeAt) (struct timsort * ts, size_t i, size_t width) {
 	}
 	ts->stackSize--;
 
+	return CALL(mergeRuns) (ts, base1, len1, base2, len2, width);
+}
+
+/**
+ * Merges the two adjacent runs base1[0..len1) and base2[0..len2), which
+ * need not be on the run stack.
+ */
+static int NAME(mergeRuns) (struct timsort * ts, void *base1, size_t len1,
+			    void *base2, size_t len2, size_t width) {
+	size_t k;
+
+	assert(len1 > 0 && len2 > 0);
+	assert(ELEM(base1, len1) == base2);
+
 	/*
 	 * Find where the first element of run2 goes in run1. Prior elements
 	 * in run1 can be ignored (because they're already in place).
@@ -835,3 +892,339 @@ outer:
 
 	return SUCCESS;
 }
+
+#ifdef IS_TIMSORT_R
+/*
+ * Parallel timsort.  The array is split into chunks and each chunk is
+ * divided into runs as timsort would: natural runs, with short ones
+ * extended to minRun by binary insertion sort.  Runs that continue across
+ * chunk boundaries are stitched back together, then the runs are merged
+ * in the same order as timsort's run stack would merge them, with merges
+ * of independent runs done in parallel and large merges split in two by
+ * co-ranking until the pieces are small enough.
+ *
+ * Ascending and strictly descending inputs still take O(n) comparisons, as
+ * they come out of stitching as a single run.
+ */
+
+/**
+ * Divides a chunk into runs.
+ */
+static void NAME(findRuns) (struct task_worker *worker, void *arg)
+{
+	struct parallel_chunk *chunk = arg;
+	struct parallel_sort *ps = chunk->ps;
+	size_t width = ps->width;
+	char *a = chunk->base;
+	size_t nel = chunk->len;
+
+	(void)worker;
+	(void)width;
+	chunk->nruns = 0;
+	do {
+		int descending = nel > 1
+		    && CMP(ps->c, ps->carg, ELEM(a, 1), a) < 0;
+		size_t runLen =
+		    CALL(countRunAndMakeAscending) (a, nel, CMPARGS(ps->c, ps->carg), width);
+
+		// If run is short, extend to min(minRun, nel)
+		if (runLen < ps->minRun && runLen < nel) {
+			size_t force = nel <= ps->minRun ? nel : ps->minRun;
+			CALL(binarySort) (a, force, runLen, CMPARGS(ps->c, ps->carg), width);
+			runLen = force;
+			descending = 0;
+		}
+		chunk->runs[chunk->nruns].base = a;
+		chunk->runs[chunk->nruns].len = runLen;
+		chunk->runs[chunk->nruns].reversed = descending;
+		chunk->nruns++;
+
+		a = ELEM(a, runLen);
+		nel -= runLen;
+	} while (nel != 0);
+}
+
+/**
+ * Gathers the runs of all the chunks into ps->runs, joining runs that
+ * continue across chunk boundaries.
+ */
+static void NAME(stitchRuns) (struct parallel_sort *ps)
+{
+	size_t width = ps->width;
+	struct parallel_run *runs = ps->runs;
+	size_t nruns = 0;
+	size_t out = 0;
+	size_t i, r;
+
+	(void)width;
+	for (i = 0; i < ps->nchunks; i++) {
+		memmove(&runs[nruns], ps->chunks[i].runs,
+			ps->chunks[i].nruns * sizeof(runs[0]));
+		nruns += ps->chunks[i].nruns;
+	}
+
+	/*
+	 * A strictly descending run split by chunk boundaries has been
+	 * reversed piecewise.  If the first (originally last) element of one
+	 * reversed run is greater than the last (originally first) element of
+	 * the next, the descent continues: undo the reversals and reverse the
+	 * pieces as a whole.
+	 */
+	for (r = 0; r < nruns; ) {
+		size_t end = r + 1;
+		size_t len = runs[r].len;
+
+		while (end < nruns && runs[end - 1].reversed && runs[end].reversed
+		       && CMP(ps->c, ps->carg, runs[end - 1].base,
+			      ELEM(runs[end].base, runs[end].len - 1)) > 0) {
+			len += runs[end].len;
+			end++;
+		}
+		if (end - r > 1) {
+			for (i = r; i < end; i++)
+				CALL(reverseRange) (runs[i].base, runs[i].len, width);
+			CALL(reverseRange) (runs[r].base, len, width);
+		}
+		runs[out] = runs[r];
+		runs[out].len = len;
+		out++;
+		r = end;
+	}
+	nruns = out;
+
+	// Concatenate runs that are already in order
+	out = 0;
+	for (r = 1; r < nruns; r++) {
+		if (CMP(ps->c, ps->carg, ELEM(runs[out].base, runs[out].len - 1),
+			runs[r].base) <= 0)
+			runs[out].len += runs[r].len;
+		else
+			runs[++out] = runs[r];
+	}
+	ps->nruns = out + 1;
+}
+
+/**
+ * Co-ranking: returns how many elements of src1 are among the first k
+ * elements of the stable merge of src1 and src2.
+ */
+static size_t NAME(corank) (size_t k, char *src1, size_t len1,
+			    char *src2, size_t len2,
+			    CMPPARAMS(compare, carg), size_t width)
+{
+	size_t lo = k > len2 ? k - len2 : 0;
+	size_t hi = k < len1 ? k : len1;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (CMP(compare, carg, ELEM(src1, mid), ELEM(src2, k - mid - 1)) <= 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	(void)width;
+	return lo;
+}
+
+/**
+ * Merges src1 and src2 into dst, splitting the merge into independent
+ * halves while it is large.
+ */
+static void NAME(parallelMerge) (struct task_worker *worker, void *arg)
+{
+	const struct parallel_merge_args *m = arg;
+	struct parallel_sort *ps = m->ps;
+	size_t width = ps->width;
+	char *src1 = m->src1;
+	char *src2 = m->src2;
+	char *dst = m->dst;
+	char *end1 = ELEM(src1, m->len1);
+	char *end2 = ELEM(src2, m->len2);
+
+	(void)width;
+	if (m->len1 + m->len2 > PARALLEL_MERGE_CUTOFF) {
+		size_t k = (m->len1 + m->len2) / 2;
+		size_t i = CALL(corank) (k, src1, m->len1, src2, m->len2,
+					 CMPARGS(ps->c, ps->carg), width);
+		size_t j = k - i;
+		struct parallel_merge_args front = {
+			ps, src1, i, src2, j, dst
+		};
+		struct parallel_merge_args back = {
+			ps, ELEM(src1, i), m->len1 - i, ELEM(src2, j), m->len2 - j,
+			ELEM(dst, k)
+		};
+		struct task task;
+
+		task_spawn(worker, &task, NAME(parallelMerge), &front);
+		NAME(parallelMerge) (worker, &back);
+		task_wait(worker, &task);
+		return;
+	}
+
+	while (src1 < end1 && src2 < end2) {
+		if (CMP(ps->c, ps->carg, src2, src1) < 0) {
+			ASSIGN(dst, src2);
+			src2 = INCPTR(src2);
+		} else {
+			ASSIGN(dst, src1);
+			src1 = INCPTR(src1);
+		}
+		dst = INCPTR(dst);
+	}
+	memcpy(dst, src1, (size_t)(end1 - src1));
+	dst += end1 - src1;
+	memcpy(dst, src2, (size_t)(end2 - src2));
+}
+
+/**
+ * Merges the two children of a merge tree node, after merging each of
+ * them (in parallel when both have merges to do).
+ */
+static void NAME(mergeTreeNode) (struct task_worker *worker, void *arg)
+{
+	const struct merge_node_args *args = arg;
+	struct parallel_sort *ps = args->ps;
+	const struct merge_node *node = &ps->nodes[args->node];
+	struct merge_node_args left = { ps, node->left };
+	struct merge_node_args right = { ps, node->right };
+	size_t width = ps->width;
+	char *base1, *base2, *src;
+	size_t len1, len2, k;
+	struct task task;
+
+	(void)width;
+	if (node->left == NO_NODE)
+		return;		// a run, already sorted
+
+	if (ps->nodes[node->left].left != NO_NODE) {
+		task_spawn(worker, &task, NAME(mergeTreeNode), &left);
+		NAME(mergeTreeNode) (worker, &right);
+		task_wait(worker, &task);
+	} else {
+		NAME(mergeTreeNode) (worker, &right);
+	}
+	if (atomic_load(&ps->error))
+		return;
+
+	base1 = ps->nodes[node->left].base;
+	len1 = ps->nodes[node->left].len;
+	base2 = ps->nodes[node->right].base;
+	len2 = ps->nodes[node->right].len;
+
+	src = ps->scratch + (base1 - (char *)ps->a);
+	if (len1 + len2 <= PARALLEL_MERGE_CUTOFF) {
+		struct timsort ts;
+		parallelMergeState(&ts, ps, src, len1 + len2);
+		if (CALL(mergeRuns) (&ts, base1, len1, base2, len2, width))
+			parallel_fail(ps, errno);
+		return;
+	}
+
+	// Trim the elements already in place, as mergeRuns does
+	k = CALL(gallopRight) (base2, base1, len1, 0, CMPARGS(ps->c, ps->carg), width);
+	base1 = ELEM(base1, k);
+	len1 -= k;
+	if (len1 == 0)
+		return;
+	len2 = CALL(gallopLeft) (ELEM(base1, len1 - 1), base2, len2, len2 - 1,
+				 CMPARGS(ps->c, ps->carg), width);
+	if (len2 == 0)
+		return;
+
+	// Merge from the same place in the scratch copy back into the array
+	src = ps->scratch + (base1 - (char *)ps->a);
+	memcpy(src, base1, LEN(len1 + len2));
+	{
+		struct parallel_merge_args merge = {
+			ps, src, len1, ELEM(src, len1), len2, base1
+		};
+		NAME(parallelMerge) (worker, &merge);
+	}
+}
+
+static void NAME(sortParallel) (struct task_worker *worker, void *arg)
+{
+	struct parallel_sort *ps = arg;
+	struct merge_node_args root;
+	size_t i;
+
+	for (i = 0; i < ps->nchunks; i++)
+		task_spawn(worker, &ps->chunks[i].task, NAME(findRuns),
+			   &ps->chunks[i]);
+	for (i = ps->nchunks; i-- > 0; )
+		task_wait(worker, &ps->chunks[i].task);
+
+	NAME(stitchRuns) (ps);
+	root.ps = ps;
+	root.node = buildMergeTree(ps);
+
+	if (ps->nodes[root.node].left != NO_NODE) {
+		ps->scratch = malloc(ps->nel * ps->width);
+		if (ps->scratch == NULL) {
+			parallel_fail(ps, ENOMEM);
+			return;
+		}
+	}
+	NAME(mergeTreeNode) (worker, &root);
+}
+
+static int NAME(timsortParallel) (void *a, size_t nel, size_t width,
+				  CMPPARAMS(c, carg), unsigned nthreads)
+{
+	struct parallel_sort ps;
+	size_t maxChunks, maxRuns, chunkLen, i;
+	int err;
+
+	if (nthreads == 0)
+		nthreads = task_pool_default_threads();
+	maxChunks = (size_t)nthreads * PARALLEL_CHUNKS_PER_THREAD;
+	ps.nchunks = nel / PARALLEL_MIN_CHUNK;
+	if (maxChunks > TASK_DEQUE_CAPACITY)
+		maxChunks = TASK_DEQUE_CAPACITY;
+	if (ps.nchunks > maxChunks)
+		ps.nchunks = maxChunks;
+	if (ps.nchunks < 2 || nthreads < 2 || !width)
+		return CALL(timsort) (a, nel, width, CMPARGS(c, carg), NULL, 0);
+
+	ps.a = a;
+	ps.nel = nel;
+	ps.width = width;
+	ps.c = c;
+	ps.carg = carg;
+	ps.minRun = minRunLength(nel);
+	maxRuns = nel / ps.minRun + ps.nchunks;
+	ps.chunks = malloc(ps.nchunks * sizeof(ps.chunks[0]));
+	ps.runs = malloc(maxRuns * sizeof(ps.runs[0]));
+	ps.nodes = malloc(2 * maxRuns * sizeof(ps.nodes[0]));
+	ps.scratch = NULL;
+	atomic_init(&ps.error, 0);
+	if (!ps.chunks || !ps.runs || !ps.nodes) {
+		err = ENOMEM;
+		goto out;
+	}
+
+	chunkLen = nel / ps.nchunks;
+	for (i = 0; i < ps.nchunks; i++) {
+		struct parallel_chunk *chunk = &ps.chunks[i];
+		chunk->ps = &ps;
+		chunk->base = ELEM(a, i * chunkLen);
+		chunk->len = i + 1 < ps.nchunks ? chunkLen : nel - i * chunkLen;
+		chunk->runs = &ps.runs[i * (chunkLen / ps.minRun + 1)];
+		chunk->nruns = 0;
+	}
+
+	task_pool_run(nthreads, NAME(sortParallel), &ps);
+	err = atomic_load(&ps.error);
+out:
+	free(ps.chunks);
+	free(ps.runs);
+	free(ps.nodes);
+	free(ps.scratch);
+	if (err) {
+		errno = err;
+		return FAILURE;
+	}
+	return SUCCESS;
+}
+#endif /* IS_TIMSORT_R */
@@ -24,6 +24,8 @@
 #include <stdlib.h>		// malloc, free
 #include <string.h>		// memcpy, memmove
 #include "timsort.h"
+#include "../../src/sort_workspace.h"
+#include "../../src/sort_tuning.h"
 
 /**
  * This is the minimum sized sequence that will be merged.  Shorter
@@ -41,14 +43,18 @@
  * ArrayOutOfBounds exception.  See listsort.txt for a discussion
  * of the minimum stack length required as a function of the length
  * of the array being sorted and the minimum merge sequence length.
+ *
+ * It is read from sort_tuning (see src/sort_tuning.h) so it can be
+ * calibrated for the machine, which only allows powers of two of 32 or
+ * more, so MAX_STACK is always enough.
  */
-#define MIN_MERGE 32
+#define MIN_MERGE (sort_tuning.timsort_min_merge)
 
 /**
  * When we get into galloping mode, we stay there until both runs win less
- * often than MIN_GALLOP consecutive times.
+ * often than MIN_GALLOP consecutive times.  Also read from sort_tuning.
  */
-#define MIN_GALLOP 7
+#define MIN_GALLOP (sort_tuning.timsort_min_gallop)
 
 /**
  * Maximum initial size of tmp array, which is used for merging.  The array
@@ -103,6 +109,8 @@ typedef int (*comparator) (const void *x, const void *y, void *thunk);
 #define CMPARGS(compar, thunk) (compar), (thunk)
 #define CMP(compar, thunk, x, y) (compar((x), (y), (thunk)))
 #define TIMSORT timsort_r
+#define TIMSORT_WS timsort_r_ws
+#define TIMSORT_POWERSORT timsort_r_powersort
 
 #else
 
@@ -111,12 +119,15 @@ typedef int (*comparator) (const void *x, const void *y);
 #define CMPARGS(compar, thunk) (compar)
 #define CMP(compar, thunk, x, y) (compar((x), (y)))
 #define TIMSORT timsort
+#define TIMSORT_WS timsort_ws
+#define TIMSORT_POWERSORT timsort_powersort
 
 #endif /* IS_TIMSORT_R */
 
 struct timsort_run {
 	void *base;
 	size_t len;
+	unsigned power;		// Powersort node power of the boundary with the next run
 };
 
 struct timsort {
@@ -141,12 +152,23 @@ struct timsort {
 	 */
 	size_t minGallop;
 
+	/**
+	 * Merge runs by the Powersort policy rather than the TimSort stack
+	 * invariants (see mergePowersort).
+	 */
+	int powersort;
+
 	/**
 	 * Temp storage for merges.
 	 */
 	void *tmp;
 	size_t tmp_length;
 
+	/**
+	 * Workspace the temp storage is taken from, or NULL to allocate it.
+	 */
+	struct sort_workspace *ws;
+
 	/**
 	 * A stack of pending runs yet to be merged.  Run i starts at
 	 * address base[i] and extends for len[i] elements.  It's always
@@ -168,9 +190,10 @@ struct timsort {
 
 static int timsort_init(struct timsort *ts, void *a, size_t len,
 			CMPPARAMS(c, carg),
-			size_t width);
+			size_t width, struct sort_workspace *ws);
 static void timsort_deinit(struct timsort *ts);
 static size_t minRunLength(size_t n);
+static unsigned nodePower(size_t s1, size_t n1, size_t n2, size_t n);
 static void pushRun(struct timsort *ts, void *runBase, size_t runLen);
 static void *ensureCapacity(struct timsort *ts, size_t minCapacity,
 			    size_t width);
@@ -185,7 +208,7 @@ static void *ensureCapacity(struct timsort *ts, size_t minCapacity,
  */
 static int timsort_init(struct timsort *ts, void *a, size_t len,
 			CMPPARAMS(c, carg),
-			size_t width)
+			size_t width, struct sort_workspace *ws)
 {
 	int err = 0;
 
@@ -195,11 +218,13 @@ static int timsort_init(struct timsort *ts, void *a, size_t len,
 	assert(width);
 
 	ts->minGallop = MIN_GALLOP;
+	ts->powersort = 0;
 	ts->stackSize = 0;
 
 	ts->a = a;
 	ts->a_length = len;
 	ts->c = c;
+	ts->ws = ws;
 #ifdef IS_TIMSORT_R
 	ts->carg = carg;
 #endif
@@ -208,7 +233,8 @@ static int timsort_init(struct timsort *ts, void *a, size_t len,
 	ts->tmp_length = (len < 2 * INITIAL_TMP_STORAGE_LENGTH ?
 			  len >> 1 : INITIAL_TMP_STORAGE_LENGTH);
 	if (ts->tmp_length) {
-		ts->tmp = malloc(ts->tmp_length * width);
+		ts->tmp = ws ? sort_workspace_reserve(ws, ts->tmp_length * width)
+			: malloc(ts->tmp_length * width);
 		err |= ts->tmp == NULL;
 	} else {
 		ts->tmp = NULL;
@@ -303,7 +329,8 @@ static int timsort_init(struct timsort *ts, void *a, size_t len,
 
 static void timsort_deinit(struct timsort *ts)
 {
-	free(ts->tmp);
+	if (!ts->ws)
+		free(ts->tmp);
 #ifdef MALLOC_STACK
 	free(ts->run);
 #endif
@@ -336,6 +363,38 @@ static size_t minRunLength(size_t n)
 	return n + r;
 }
 
+/**
+ * Returns the Powersort node power of the boundary between the run
+ * a[s1..s1+n1) and the run of length n2 that follows it, in an array of
+ * length n.  This is the depth of the boundary in a perfectly balanced
+ * merge tree: the number of leading bits that the midpoints of the two
+ * runs, as fractions of n, have in common, plus one.  Computed bit by bit
+ * with integers as in CPython's powerloop.
+ *
+ * See "Nearly-Optimal Mergesorts: Fast, Practical Sorting Methods That
+ * Optimally Adapt to Existing Runs", J. Ian Munro and Sebastian Wild,
+ * ESA 2018.
+ */
+static unsigned nodePower(size_t s1, size_t n1, size_t n2, size_t n)
+{
+	unsigned result = 0;
+	size_t a = 2 * s1 + n1;	// 2 * midpoint of run1
+	size_t b = a + n1 + n2;	// 2 * midpoint of run2
+
+	for (;;) {
+		++result;
+		if (a >= n) {	// both quotient bits are 1
+			a -= n;
+			b -= n;
+		} else if (b >= n) {	// a/n bit is 0, b/n bit is 1
+			break;
+		}
+		a <<= 1;
+		b <<= 1;
+	}
+	return result;
+}
+
 /**
  * Pushes the specified run onto the pending-run stack.
  *
@@ -379,14 +438,191 @@ static void *ensureCapacity(struct timsort *ts, size_t minCapacity,
 			newSize = minCapacity;
 		}
 
-		free(ts->tmp);
 		ts->tmp_length = newSize;
-		ts->tmp = malloc(ts->tmp_length * width);
+		if (ts->ws) {
+			ts->tmp = sort_workspace_reserve(ts->ws, ts->tmp_length * width);
+		} else {
+			free(ts->tmp);
+			ts->tmp = malloc(ts->tmp_length * width);
+		}
 	}
 
 	return ts->tmp;
 }
 
+#ifdef IS_TIMSORT_R
+#include <stdatomic.h>
+#include "../../src/task_pool.h"
+
+/**
+ * The parallel sort splits arrays into chunks of at least this many
+ * elements to find the runs, up to PARALLEL_CHUNKS_PER_THREAD per thread
+ * so that a chunk of long natural runs doesn't hold up the others.  The
+ * chunk tasks are all spawned from one frame, so there are never more of
+ * them than fit in the task deque.
+ * Merges of fewer than PARALLEL_MERGE_CUTOFF elements are not split.
+ */
+#define PARALLEL_MIN_CHUNK 8192
+#define PARALLEL_CHUNKS_PER_THREAD 4
+#define PARALLEL_MERGE_CUTOFF 8192
+
+#define NO_NODE ((size_t) -1)
+
+/**
+ * A run found by the parallel sort.  reversed is set if the run is a
+ * strictly descending natural run that countRunAndMakeAscending reversed.
+ */
+struct parallel_run {
+	void *base;
+	size_t len;
+	int reversed;
+};
+
+/**
+ * A node of the merge tree: either a run (left and right are NO_NODE) or
+ * the merge of the nodes left and right, which are adjacent in the array.
+ */
+struct merge_node {
+	void *base;
+	size_t len;
+	size_t left;
+	size_t right;
+};
+
+struct parallel_sort;
+
+struct parallel_chunk {
+	struct parallel_sort *ps;
+	void *base;
+	size_t len;
+	struct parallel_run *runs;	// room for len / minRun + 1 runs
+	size_t nruns;
+	struct task task;
+};
+
+struct parallel_sort {
+	void *a;
+	size_t nel;
+	size_t width;
+	comparator c;
+	void *carg;
+	size_t minRun;
+	struct parallel_chunk *chunks;
+	size_t nchunks;
+	struct parallel_run *runs;
+	size_t nruns;
+	struct merge_node *nodes;	// room for 2 * nruns - 1 nodes
+	char *scratch;			// a copy of the array for split merges
+	atomic_int error;		// errno of the first failure, or 0
+};
+
+struct merge_node_args {
+	struct parallel_sort *ps;
+	size_t node;
+};
+
+struct parallel_merge_args {
+	struct parallel_sort *ps;
+	char *src1;
+	size_t len1;
+	char *src2;
+	size_t len2;
+	char *dst;
+};
+
+static void parallel_fail(struct parallel_sort *ps, int err)
+{
+	int expected = 0;
+	atomic_compare_exchange_strong(&ps->error, &expected, err ? err : EINVAL);
+}
+
+/**
+ * Sets up the state for a merge by mergeRuns of n elements, using the part
+ * of the scratch copy that corresponds to them as tmp.  The scratch memory
+ * of merges in different parts of the array doesn't overlap.
+ */
+static void parallelMergeState(struct timsort *ts, struct parallel_sort *ps,
+			       void *tmp, size_t n)
+{
+	ts->a = ps->a;
+	ts->a_length = ps->nel;
+	ts->c = ps->c;
+	ts->carg = ps->carg;
+	ts->minGallop = MIN_GALLOP;
+	ts->powersort = 0;
+	ts->tmp = tmp;
+	ts->tmp_length = n;	// enough for any merge, so it never grows
+	ts->ws = NULL;
+	ts->stackSize = 0;
+	ts->stackLen = 0;
+}
+
+static size_t mergeNode(struct merge_node *nodes, size_t *nnodes,
+			size_t left, size_t right)
+{
+	size_t node = (*nnodes)++;
+	nodes[node].base = nodes[left].base;
+	nodes[node].len = nodes[left].len + nodes[right].len;
+	nodes[node].left = left;
+	nodes[node].right = right;
+	return node;
+}
+
+/**
+ * Builds the tree of merges that timsort would do on the runs, by running
+ * mergeCollapse and mergeForceCollapse on the run lengths alone.  Merges
+ * in different subtrees are independent and can be done in parallel.
+ * Returns the root node.
+ */
+static size_t buildMergeTree(struct parallel_sort *ps)
+{
+	struct merge_node *nodes = ps->nodes;
+	size_t stack[MAX_STACK];
+	size_t stackSize = 0;
+	size_t nnodes = 0;
+	size_t r;
+
+	for (r = 0; r < ps->nruns; r++) {
+		assert(stackSize < MAX_STACK);
+		nodes[nnodes].base = ps->runs[r].base;
+		nodes[nnodes].len = ps->runs[r].len;
+		nodes[nnodes].left = NO_NODE;
+		nodes[nnodes].right = NO_NODE;
+		stack[stackSize++] = nnodes++;
+
+		// mergeCollapse
+		while (stackSize > 1) {
+			size_t n = stackSize - 2;
+#define RUNLEN(i) (nodes[stack[i]].len)
+			if ((n > 0 && RUNLEN(n - 1) <= RUNLEN(n) + RUNLEN(n + 1))
+			    || (n > 1 && RUNLEN(n - 2) <= RUNLEN(n) + RUNLEN(n - 1))) {
+				if (RUNLEN(n - 1) < RUNLEN(n + 1))
+					n--;
+			} else if (RUNLEN(n) > RUNLEN(n + 1)) {
+				break;
+			}
+			stack[n] = mergeNode(nodes, &nnodes, stack[n], stack[n + 1]);
+			if (n == stackSize - 3)
+				stack[n + 1] = stack[n + 2];
+			stackSize--;
+		}
+	}
+
+	// mergeForceCollapse
+	while (stackSize > 1) {
+		size_t n = stackSize - 2;
+		if (n > 0 && RUNLEN(n - 1) < RUNLEN(n + 1))
+			n--;
+		stack[n] = mergeNode(nodes, &nnodes, stack[n], stack[n + 1]);
+		if (n == stackSize - 3)
+			stack[n + 1] = stack[n + 2];
+		stackSize--;
+	}
+#undef RUNLEN
+	return stack[0];
+}
+#endif /* IS_TIMSORT_R */
+
 #define WIDTH 4
 #include "timsort-impl.h"
 #undef WIDTH
@@ -404,16 +640,50 @@ static void *ensureCapacity(struct timsort *ts, size_t minCapacity,
 #undef WIDTH
 
 
+static int timsort_dispatch(void *a, size_t nel, size_t width, CMPPARAMS(c, carg),
+			    struct sort_workspace *ws, int powersort)
+{
+	switch (width) {
+	case 4:
+		return timsort_4(a, nel, width, CMPARGS(c, carg), ws, powersort);
+	case 8:
+		return timsort_8(a, nel, width, CMPARGS(c, carg), ws, powersort);
+	case 16:
+		return timsort_16(a, nel, width, CMPARGS(c, carg), ws, powersort);
+	default:
+		return timsort_width(a, nel, width, CMPARGS(c, carg), ws, powersort);
+	}
+}
+
 int TIMSORT(void *a, size_t nel, size_t width, CMPPARAMS(c, carg))
+{
+	return timsort_dispatch(a, nel, width, CMPARGS(c, carg), NULL, 0);
+}
+
+int TIMSORT_WS(void *a, size_t nel, size_t width, CMPPARAMS(c, carg),
+	       struct sort_workspace *ws)
+{
+	return timsort_dispatch(a, nel, width, CMPARGS(c, carg), ws, 0);
+}
+
+int TIMSORT_POWERSORT(void *a, size_t nel, size_t width, CMPPARAMS(c, carg))
+{
+	return timsort_dispatch(a, nel, width, CMPARGS(c, carg), NULL, 1);
+}
+
+#ifdef IS_TIMSORT_R
+int timsort_r_parallel(void *a, size_t nel, size_t width, CMPPARAMS(c, carg),
+		       unsigned nthreads)
 {
 	switch (width) {
 	case 4:
-		return timsort_4(a, nel, width, CMPARGS(c, carg));
+		return timsortParallel_4(a, nel, width, CMPARGS(c, carg), nthreads);
 	case 8:
-		return timsort_8(a, nel, width, CMPARGS(c, carg));
+		return timsortParallel_8(a, nel, width, CMPARGS(c, carg), nthreads);
 	case 16:
-		return timsort_16(a, nel, width, CMPARGS(c, carg));
+		return timsortParallel_16(a, nel, width, CMPARGS(c, carg), nthreads);
 	default:
-		return timsort_width(a, nel, width, CMPARGS(c, carg));
+		return timsortParallel_width(a, nel, width, CMPARGS(c, carg), nthreads);
 	}
 }
+#endif /* IS_TIMSORT_R */
@@ -62,4 +62,42 @@ int timsort_r(void *base, size_t nel, size_t width,
                 int (*compar) (const void *, const void *, void *),
 		void *context);
 
+/*
+ * Variants that take the temp storage from a reusable workspace (see
+ * src/sort_workspace.h) instead of allocating it on every call.
+ */
+struct sort_workspace;
+
+int timsort_ws(void *base, size_t nel, size_t width,
+	       int (*compar) (const void *, const void *),
+	       struct sort_workspace *ws);
+
+int timsort_r_ws(void *base, size_t nel, size_t width,
+		 int (*compar) (const void *, const void *, void *),
+		 void *context, struct sort_workspace *ws);
+
+/*
+ * Variants that merge runs by the Powersort policy (the node power based
+ * policy used by CPython since 3.11) instead of the TimSort stack
+ * invariants, which can make unbalanced merges on some run length
+ * distributions.
+ */
+int timsort_powersort(void *base, size_t nel, size_t width,
+		      int (*compar) (const void *, const void *));
+
+int timsort_r_powersort(void *base, size_t nel, size_t width,
+			int (*compar) (const void *, const void *, void *),
+			void *context);
+
+/*
+ * Parallel variant using nthreads threads (0 for one per hardware thread).
+ * Chunks of the array are divided into runs concurrently, and independent
+ * merges run in parallel with the largest merges split between threads.
+ * It needs temp storage for n elements rather than n/2.  Small arrays, or
+ * one thread, are sorted by timsort_r.
+ */
+int timsort_r_parallel(void *base, size_t nel, size_t width,
+		       int (*compar) (const void *, const void *, void *),
+		       void *context, unsigned nthreads);
+
 #endif /* TIMSORT_H */